@@ -209,6 +209,39 @@ bool Model::Build(const OPCODECREATE& create)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Builds a collision model from a no-leaf tree saved with AABBNoLeafTree::Export().
+ *	\param		create		[in] model creation structure
+ *	\param		nodes		[in] saved nodes
+ *	\param		nb_nodes	[in] number of saved nodes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Model::Build(const OPCODECREATE& create, const AABBNoLeafNodeData* nodes, udword nb_nodes)
+{
+	// Checkings
+	if(!create.mIMesh || !create.mIMesh->IsValid())	return false;
+	if(!create.mNoLeaf || create.mQuantized)	return SetIceError("OPCODE WARNING: saved trees must be non-quantized no-leaf trees.\n", null);
+
+	Release();
+
+	SetMeshInterface(create.mIMesh);
+
+	// A complete no-leaf tree has one node less than the number of triangles
+	udword NbTris = create.mIMesh->GetNbTriangles();
+	if(NbTris==1)
+	{
+		mModelCode |= OPC_SINGLE_NODE;
+		return true;
+	}
+	if(nb_nodes!=NbTris-1)	return false;
+
+	if(!CreateTree(create.mNoLeaf, create.mQuantized))	return false;
+
+	return static_cast<AABBNoLeafTree*>(mTree)->Import(nodes, nb_nodes, NbTris);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Gets the number of bytes used by the tree.
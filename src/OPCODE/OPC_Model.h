@@ -36,6 +36,17 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		override(BaseModel)	bool				Build(const OPCODECREATE& create);
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Builds a collision model from a no-leaf tree saved with AABBNoLeafTree::Export().
+		 *	\param		create		[in] model creation structure
+		 *	\param		nodes		[in] saved nodes
+		 *	\param		nb_nodes	[in] number of saved nodes
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool				Build(const OPCODECREATE& create, const AABBNoLeafNodeData* nodes, udword nb_nodes);
+
 #ifdef __MESHMERIZER_H__
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
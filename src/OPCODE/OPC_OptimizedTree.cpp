@@ -349,6 +349,76 @@ bool AABBNoLeafTree::Build(AABBTree* tree)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Copies the nodes to a flat array, child pointers become node indices.
+ *	\param		data			[out] array of GetNbNodes() node records
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBNoLeafTree::Export(AABBNoLeafNodeData* data) const
+{
+	if(!data)	return false;
+
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		const AABBNoLeafNode& Current = mNodes[i];
+		AABBNoLeafNodeData& Data = data[i];
+		Data.mCenter[0] = Current.mAABB.mCenter.x;
+		Data.mCenter[1] = Current.mAABB.mCenter.y;
+		Data.mCenter[2] = Current.mAABB.mCenter.z;
+		Data.mExtents[0] = Current.mAABB.mExtents.x;
+		Data.mExtents[1] = Current.mAABB.mExtents.y;
+		Data.mExtents[2] = Current.mAABB.mExtents.z;
+
+		// Leaves keep their primitive index, children store an index into the node array
+		Data.mPosData = Current.HasPosLeaf() ? udword(Current.mPosData) : udword((Current.GetPos() - mNodes)<<1);
+		Data.mNegData = Current.HasNegLeaf() ? udword(Current.mNegData) : udword((Current.GetNeg() - mNodes)<<1);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Rebuilds the nodes from a flat array written by Export().
+ *	\param		data			[in] node records
+ *	\param		nb_nodes		[in] number of node records
+ *	\param		nb_primitives	[in] number of primitives the leaves refer to
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBNoLeafTree::Import(const AABBNoLeafNodeData* data, udword nb_nodes, udword nb_primitives)
+{
+	if(!data || !nb_nodes)	return false;
+
+	if(mNbNodes!=nb_nodes)
+	{
+		mNbNodes = nb_nodes;
+		DELETEARRAY(mNodes);
+		mNodes = new AABBNoLeafNode[nb_nodes];
+		CHECKALLOC(mNodes);
+	}
+
+	for(udword i=0;i<nb_nodes;i++)
+	{
+		const AABBNoLeafNodeData& Data = data[i];
+		AABBNoLeafNode& Current = mNodes[i];
+		Current.mAABB.mCenter.Set(Data.mCenter);
+		Current.mAABB.mExtents.Set(Data.mExtents);
+
+		// Children must come after their parent, leaves must refer to an existing primitive
+		if(!(Data.mPosData&1) && ((Data.mPosData>>1)<=i || (Data.mPosData>>1)>=nb_nodes))	return false;
+		if(!(Data.mNegData&1) && ((Data.mNegData>>1)<=i || (Data.mNegData>>1)>=nb_nodes))	return false;
+		if((Data.mPosData&1) && (Data.mPosData>>1)>=nb_primitives)	return false;
+		if((Data.mNegData&1) && (Data.mNegData>>1)>=nb_primitives)	return false;
+		Current.mPosData = (Data.mPosData&1) ? size_t(Data.mPosData) : size_t(&mNodes[Data.mPosData>>1]);
+		Current.mNegData = (Data.mNegData&1) ? size_t(Data.mNegData) : size_t(&mNodes[Data.mNegData>>1]);
+	}
+
+	return true;
+}
+
 inline_ void ComputeMinMax(Point& min, Point& max, const VertexPointers& vp)
 {
 	// Compute triangle's AABB = a leaf box
@@ -180,9 +180,23 @@
 		IMPLEMENT_COLLISION_TREE(AABBCollisionTree, AABBCollisionNode)
 	};
 
+	//! Flat copy of a no-leaf node, children are stored as node indices instead of pointers
+	struct OPCODE_API AABBNoLeafNodeData
+	{
+						float				mCenter[3];
+						float				mExtents[3];
+						udword				mPosData;
+						udword				mNegData;
+	};
+
 	class OPCODE_API AABBNoLeafTree : public AABBOptimizedTree
 	{
 		IMPLEMENT_COLLISION_TREE(AABBNoLeafTree, AABBNoLeafNode)
+
+		public:
+		// Flat node storage
+						bool				Export(AABBNoLeafNodeData* data)	const;
+						bool				Import(const AABBNoLeafNodeData* data, udword nb_nodes, udword nb_primitives);
 	};
 
 	class OPCODE_API AABBQuantizedTree : public AABBOptimizedTree
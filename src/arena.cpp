@@ -0,0 +1,125 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <arena.h>
+#include <new>
+
+_ObjectArenas ObjectArenas;
+
+// Round sizes so every slot is suitably aligned
+static size_t GetSlotSize(size_t Size) {
+	const size_t Alignment = alignof(std::max_align_t);
+	return (Size + Alignment - 1) / Alignment * Alignment;
+}
+
+// Constructor
+_Arena::_Arena(size_t SlotSize) :
+	SlotSize(SlotSize),
+	FreeList(nullptr) {
+}
+
+// Destructor
+_Arena::~_Arena() {
+	for(auto Block : Blocks)
+		::operator delete(Block);
+}
+
+// Get a slot from the free list, adding a block when it's empty
+void *_Arena::Allocate(_ArenaStats &Stats) {
+	if(!FreeList) {
+		char *Block = (char *)::operator new(SlotSize * ARENA_SLOTS_PER_BLOCK);
+		Blocks.push_back(Block);
+		Stats.SystemAllocations++;
+
+		// Link slots in address order
+		for(size_t i = ARENA_SLOTS_PER_BLOCK; i-- > 0; ) {
+			_FreeSlot *Slot = (_FreeSlot *)(Block + i * SlotSize);
+			Slot->Next = FreeList;
+			FreeList = Slot;
+		}
+	}
+
+	_FreeSlot *Slot = FreeList;
+	FreeList = Slot->Next;
+
+	return Slot;
+}
+
+// Return a slot to the free list
+void _Arena::Free(void *Pointer) {
+	_FreeSlot *Slot = (_FreeSlot *)Pointer;
+	Slot->Next = FreeList;
+	FreeList = Slot;
+}
+
+// Constructor
+_ObjectArenas::_ObjectArenas() :
+	Enabled(true) {
+}
+
+// Destructor
+_ObjectArenas::~_ObjectArenas() {
+	for(auto Arena : Arenas)
+		delete Arena;
+}
+
+// Allocate memory for an object
+void *_ObjectArenas::Allocate(size_t Size) {
+	Stats.Allocations++;
+	if(!Enabled) {
+		Stats.SystemAllocations++;
+		return ::operator new(Size);
+	}
+
+	return GetArena(Size)->Allocate(Stats);
+}
+
+// Free memory for an object
+void _ObjectArenas::Free(void *Pointer, size_t Size) {
+	if(!Pointer)
+		return;
+
+	Stats.Frees++;
+	if(!Enabled) {
+		::operator delete(Pointer);
+		return;
+	}
+
+	GetArena(Size)->Free(Pointer);
+}
+
+// Get the number of blocks allocated by all arenas
+size_t _ObjectArenas::GetBlockCount() const {
+	size_t Count = 0;
+	for(auto Arena : Arenas)
+		Count += Arena->GetBlockCount();
+
+	return Count;
+}
+
+// Find the arena for a size, object types of the same size share one
+_Arena *_ObjectArenas::GetArena(size_t Size) {
+	size_t SlotSize = GetSlotSize(Size);
+	for(auto Arena : Arenas) {
+		if(Arena->GetSlotSize() == SlotSize)
+			return Arena;
+	}
+
+	Arenas.push_back(new _Arena(SlotSize));
+
+	return Arenas.back();
+}
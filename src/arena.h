@@ -0,0 +1,92 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Constants
+const size_t ARENA_SLOTS_PER_BLOCK = 64;
+
+// Allocation counters
+struct _ArenaStats {
+	_ArenaStats() : Allocations(0), Frees(0), SystemAllocations(0) { }
+
+	uint64_t Allocations;
+	uint64_t Frees;
+	uint64_t SystemAllocations;
+};
+
+// Fixed size slots carved from blocks, freed slots are reused before new blocks are allocated
+class _Arena {
+
+	public:
+
+		_Arena(size_t SlotSize);
+		~_Arena();
+
+		void *Allocate(_ArenaStats &Stats);
+		void Free(void *Pointer);
+
+		size_t GetSlotSize() const { return SlotSize; }
+		size_t GetBlockCount() const { return Blocks.size(); }
+
+	private:
+
+		struct _FreeSlot {
+			_FreeSlot *Next;
+		};
+
+		size_t SlotSize;
+		std::vector<char *> Blocks;
+		_FreeSlot *FreeList;
+
+};
+
+// Arenas for each object size
+class _ObjectArenas {
+
+	public:
+
+		_ObjectArenas();
+		~_ObjectArenas();
+
+		void *Allocate(size_t Size);
+		void Free(void *Pointer, size_t Size);
+
+		// Only change while no objects are allocated
+		void SetEnabled(bool Value) { Enabled = Value; }
+
+		void ResetStats() { Stats = _ArenaStats(); }
+		const _ArenaStats &GetStats() const { return Stats; }
+		size_t GetBlockCount() const;
+
+	private:
+
+		_Arena *GetArena(size_t Size);
+
+		std::vector<_Arena *> Arenas;
+		_ArenaStats Stats;
+		bool Enabled;
+
+};
+
+// Singletons
+extern _ObjectArenas ObjectArenas;
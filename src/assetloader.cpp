@@ -0,0 +1,379 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <assetloader.h>
+#include <globals.h>
+#include <log.h>
+#include <mappedfile.h>
+#include <irrb/CIrrBMeshFileLoader.h>
+#include <tinyxml2/tinyxml2.h>
+#include <IFileSystem.h>
+#include <IMeshCache.h>
+#include <ISceneManager.h>
+#include <IVideoDriver.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+
+using namespace irr;
+using namespace tinyxml2;
+
+// Read a whole file into memory, returns false if it's missing or empty
+static bool ReadFile(const std::string &Path, std::vector<char> &Data) {
+	FILE *File = fopen(Path.c_str(), "rb");
+	if(!File)
+		return false;
+
+	fseek(File, 0, SEEK_END);
+	long Size = ftell(File);
+	fseek(File, 0, SEEK_SET);
+
+	Data.clear();
+	if(Size > 0) {
+		Data.resize(Size);
+		if(fread(Data.data(), 1, Size, File) != (size_t)Size)
+			Data.clear();
+	}
+	fclose(File);
+
+	return !Data.empty();
+}
+
+// Check a file extension without irrlicht's string functions, which loader threads don't use
+static bool HasExtension(const std::string &Name, const std::string &Extension) {
+	if(Name.size() <= Extension.size() || Name[Name.size() - Extension.size() - 1] != '.')
+		return false;
+
+	return std::equal(Extension.begin(), Extension.end(), Name.end() - Extension.size(), [](char Left, char Right) {
+		return std::tolower((unsigned char)Left) == std::tolower((unsigned char)Right);
+	});
+}
+
+// Create an irrlicht image from decoded pixels, files that couldn't be decoded are loaded by irrlicht instead
+static video::IImage *CreateImage(_DecodedImage &Decoded, const std::string &Name) {
+	if(Decoded.Pixels) {
+		video::ECOLOR_FORMAT Format = Decoded.HasAlpha ? video::ECF_A8R8G8B8 : video::ECF_R8G8B8;
+		return irrDriver->createImageFromData(Format, core::dimension2du(Decoded.Width, Decoded.Height), Decoded.Pixels.release(), true, true);
+	}
+
+	if(Decoded.File.empty())
+		return nullptr;
+
+	io::IReadFile *File = irrFile->createMemoryReadFile(Decoded.File.data(), (s32)Decoded.File.size(), Name.c_str(), false);
+	video::IImage *Image = irrDriver->createImageFromFile(File);
+	File->drop();
+	std::vector<char>().swap(Decoded.File);
+
+	return Image;
+}
+
+// Find mesh and texture attributes in a scene file
+static void FindSceneFiles(XMLElement *Element, std::vector<std::string> &Meshes, std::vector<std::string> &Textures) {
+	for(XMLElement *Child = Element->FirstChildElement(); Child != nullptr; Child = Child->NextSiblingElement()) {
+		const char *Name = Child->Attribute("name");
+		const char *Value = Child->Attribute("value");
+		if(Name && Value && Value[0]) {
+			std::string Type = Child->Name();
+			if(Type == "string" && std::string(Name) == "Mesh")
+				Meshes.push_back(Value);
+			else if(Type == "texture")
+				Textures.push_back(Value);
+		}
+
+		FindSceneFiles(Child, Meshes, Textures);
+	}
+}
+
+// Constructor
+_AssetLoader::_AssetLoader() :
+	MeshTextureCount(0),
+	WaitTime(0.0),
+	Stopping(false) {
+
+	for(int i = 0; i < COUNT; i++) {
+		Remaining[i] = 0;
+		DecodeTimes[i] = 0.0;
+		UploadTimes[i] = 0.0;
+	}
+}
+
+// Upload remaining assets and stop threads
+_AssetLoader::~_AssetLoader() {
+	Finish();
+
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Stopping = true;
+	}
+	WorkCondition.notify_all();
+	for(auto &Thread : Threads)
+		Thread.join();
+}
+
+// Queue a texture unless it's already loaded
+void _AssetLoader::AddTexture(const std::string &Path) {
+
+	// Textures are cached by absolute path
+	std::string Name = irrFile->getAbsolutePath(Path.c_str()).c_str();
+	if(irrDriver->findTexture(Name.c_str()))
+		return;
+
+	Add(TEXTURE, Name, Name);
+}
+
+// Queue a mesh unless it's already loaded, its textures are found relative to the data path
+void _AssetLoader::AddMesh(const std::string &Name, const std::string &Path, const std::string &DataPath) {
+	if(irrScene->getMeshCache()->isMeshLoaded(Name.c_str()))
+		return;
+
+	Add(MESH, Name, Path, DataPath);
+}
+
+// Queue the meshes and textures used by a scene, which are named relative to the data path
+void _AssetLoader::AddScene(const std::string &ScenePath, const std::string &DataPath) {
+	XMLDocument Document;
+	if(Document.LoadFile(ScenePath.c_str()) != XML_SUCCESS)
+		return;
+
+	std::vector<std::string> Meshes, Textures;
+	FindSceneFiles(Document.RootElement(), Meshes, Textures);
+	for(const auto &Mesh : Meshes)
+		AddMesh(Mesh, DataPath + Mesh, DataPath);
+	for(const auto &Texture : Textures)
+		AddTexture(DataPath + Texture);
+}
+
+// Queue a sound from the sounds directory
+void _AssetLoader::AddSound(const std::string &File) {
+	if(!Audio.IsEnabled() || Audio.GetBuffer(File))
+		return;
+
+	Add(SOUND, File, irrFile->getAbsolutePath(("sounds/" + File).c_str()).c_str());
+}
+
+// Queue a collision mesh to be read into the page cache
+void _AssetLoader::AddCollision(const std::string &Path) {
+	Add(COLLISION, Path, Path);
+}
+
+// Queue an asset and start threads on first use
+void _AssetLoader::Add(int Type, const std::string &Name, const std::string &Path, const std::string &DataPath) {
+	if(!Names[Type].insert(Name).second)
+		return;
+
+	if(Threads.empty()) {
+		int ThreadCount = std::max(1, std::min((int)std::thread::hardware_concurrency(), ASSET_LOADER_MAX_THREADS));
+		for(int i = 0; i < ThreadCount; i++)
+			Threads.push_back(std::thread(&_AssetLoader::Work, this));
+	}
+
+	Assets.push_back(std::unique_ptr<_Asset>(new _Asset(Type, Name, Path, DataPath)));
+	Remaining[Type]++;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Pending.push_back(Assets.back().get());
+	}
+	WorkCondition.notify_one();
+}
+
+// Upload decoded assets until all assets of a type are done, or all assets for COUNT
+void _AssetLoader::Finish(int Type) {
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	double StartUploadTime = GetUploadTime();
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while(true) {
+
+		// Upload everything decoded so far
+		while(!Decoded.empty()) {
+			_Asset *Asset = Decoded.front();
+			Decoded.pop_front();
+
+			Lock.unlock();
+			auto UploadStartTime = std::chrono::high_resolution_clock::now();
+			Upload(*Asset);
+			std::chrono::duration<double, std::milli> Duration = std::chrono::high_resolution_clock::now() - UploadStartTime;
+			UploadTimes[Asset->Type] += Duration.count();
+			Remaining[Asset->Type]--;
+			Lock.lock();
+		}
+
+		// Check for remaining assets
+		int Count = 0;
+		if(Type == COUNT) {
+			for(int i = 0; i < COUNT; i++)
+				Count += Remaining[i];
+		}
+		else
+			Count = Remaining[Type];
+
+		if(!Count)
+			break;
+
+		DecodedCondition.wait(Lock, [this]() { return !Decoded.empty(); });
+	}
+
+	std::chrono::duration<double, std::milli> Duration = std::chrono::high_resolution_clock::now() - StartTime;
+	WaitTime += Duration.count() - (GetUploadTime() - StartUploadTime);
+}
+
+// Log counts and times for each type of asset
+void _AssetLoader::LogTimes() {
+	static const char *TypeNames[COUNT] = { "textures", "meshes", "sounds", "collision" };
+
+	std::string Line;
+	for(int i = 0; i < COUNT; i++) {
+		char Buffer[128];
+		int Count = (int)Names[i].size();
+		if(i == TEXTURE)
+			Count += MeshTextureCount;
+		snprintf(Buffer, sizeof(Buffer), "%s%s=%d (decode %.1fms, upload %.1fms)", i ? " " : "", TypeNames[i], Count, DecodeTimes[i], UploadTimes[i]);
+		Line += Buffer;
+	}
+
+	Log.Write("Level assets: %s threads=%d", Line.c_str(), GetThreadCount());
+}
+
+// Get the total time spent uploading
+double _AssetLoader::GetUploadTime() const {
+	double Time = 0.0;
+	for(int i = 0; i < COUNT; i++)
+		Time += UploadTimes[i];
+
+	return Time;
+}
+
+// Decode queued assets
+void _AssetLoader::Work() {
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while(true) {
+		WorkCondition.wait(Lock, [this]() { return Stopping || !Pending.empty(); });
+		if(Stopping)
+			break;
+
+		_Asset *Asset = Pending.front();
+		Pending.pop_front();
+
+		Lock.unlock();
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		Decode(*Asset);
+		std::chrono::duration<double, std::milli> Duration = std::chrono::high_resolution_clock::now() - StartTime;
+		Lock.lock();
+
+		DecodeTimes[Asset->Type] += Duration.count();
+		Decoded.push_back(Asset);
+		DecodedCondition.notify_one();
+	}
+}
+
+// Read and decode an asset without using irrlicht, the GPU or OpenAL
+void _AssetLoader::Decode(_Asset &Asset) {
+	switch(Asset.Type) {
+		case TEXTURE:
+		case MESH: {
+			if(!ReadFile(Asset.Path, Asset.File)) {
+				Log.Write("Could not read file %s", Asset.Path.c_str());
+				break;
+			}
+
+			if(Asset.Type == TEXTURE)
+				Asset.Image.Decode(std::move(Asset.File));
+			else if(HasExtension(Asset.Name, "irrbmesh"))
+				DecodeMeshTextures(Asset);
+		} break;
+		case SOUND:
+			Asset.Loaded = _Audio::DecodeBuffer(Asset.Path, Asset.AudioBuffer, Asset.AudioData);
+		break;
+		case COLLISION: {
+
+			// Touch each page of the mapped file so the trimesh maps it from the page cache
+			_MappedFile MappedFile;
+			if(MappedFile.Open(Asset.Path)) {
+				const char *Data = MappedFile.GetData();
+				volatile char Sum = 0;
+				for(size_t i = 0; i < MappedFile.GetSize(); i += 4096)
+					Sum += Data[i];
+			}
+		} break;
+	}
+}
+
+// Decode the textures a mesh loads by name, each texture is decoded by one thread
+void _AssetLoader::DecodeMeshTextures(_Asset &Asset) {
+	core::array<core::stringc> TextureNames;
+	scene::CIrrBMeshFileLoader::getTextureNames(Asset.File.data(), (u32)Asset.File.size(), TextureNames);
+
+	for(uint32_t i = 0; i < TextureNames.size(); i++) {
+		std::string Name = TextureNames[i].c_str();
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			if(!MeshTextureNames.insert(Name).second)
+				continue;
+		}
+
+		std::vector<char> Data;
+		std::string Path = Name[0] == '/' ? Name : Asset.DataPath + Name;
+		if(!ReadFile(Path, Data))
+			continue;
+
+		_DecodedImage Image;
+		Image.Decode(std::move(Data));
+		Asset.MeshTextures.push_back(std::make_pair(Name, std::move(Image)));
+	}
+}
+
+// Hand a decoded asset to irrlicht or OpenAL
+void _AssetLoader::Upload(_Asset &Asset) {
+	switch(Asset.Type) {
+		case TEXTURE: {
+			video::IImage *Image = CreateImage(Asset.Image, Asset.Name);
+			if(Image) {
+				irrDriver->addTexture(Asset.Name.c_str(), Image);
+				Image->drop();
+			}
+		} break;
+		case MESH:
+
+			// Add textures under the names the mesh loader looks for
+			for(auto &Texture : Asset.MeshTextures) {
+				if(!irrDriver->findTexture(Texture.first.c_str())) {
+					video::IImage *Image = CreateImage(Texture.second, Texture.first);
+					if(Image) {
+						irrDriver->addTexture(Texture.first.c_str(), Image);
+						Image->drop();
+					}
+				}
+				MeshTextureCount++;
+			}
+			Asset.MeshTextures.clear();
+
+			if(!Asset.File.empty()) {
+				io::IReadFile *File = irrFile->createMemoryReadFile(Asset.File.data(), (s32)Asset.File.size(), Asset.Name.c_str(), false);
+				irrScene->getMesh(File);
+				File->drop();
+				std::vector<char>().swap(Asset.File);
+			}
+		break;
+		case SOUND:
+			if(Asset.Loaded)
+				Audio.AddBuffer(Asset.Name, Asset.AudioBuffer, Asset.AudioData);
+			Asset.AudioData.clear();
+			Asset.AudioData.shrink_to_fit();
+		break;
+	}
+}
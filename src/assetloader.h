@@ -0,0 +1,114 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <audio.h>
+#include <imagedecoder.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Constants
+const int ASSET_LOADER_MAX_THREADS = 8;
+
+// A file read and decoded by a loader thread, then uploaded on the main thread
+struct _Asset {
+	_Asset(int Type, const std::string &Name, const std::string &Path, const std::string &DataPath) : Type(Type), Name(Name), Path(Path), DataPath(DataPath), Loaded(false) { }
+
+	int Type;
+	std::string Name;
+	std::string Path;
+	std::string DataPath;
+
+	// Decoded data, loader threads only fill these and never call into irrlicht
+	_DecodedImage Image;
+	std::vector<char> File;
+	std::vector<std::pair<std::string, _DecodedImage>> MeshTextures;
+	_AudioBuffer AudioBuffer;
+	std::vector<char> AudioData;
+	bool Loaded;
+};
+
+// Decodes level assets on a pool of threads while the main thread uploads them
+class _AssetLoader {
+
+	public:
+
+		enum AssetType {
+			TEXTURE,
+			MESH,
+			SOUND,
+			COLLISION,
+			COUNT,
+		};
+
+		_AssetLoader();
+		~_AssetLoader();
+
+		void AddTexture(const std::string &Path);
+		void AddMesh(const std::string &Name, const std::string &Path, const std::string &DataPath);
+		void AddScene(const std::string &ScenePath, const std::string &DataPath);
+		void AddSound(const std::string &File);
+		void AddCollision(const std::string &Path);
+
+		void Finish(int Type=COUNT);
+		void LogTimes();
+
+		int GetThreadCount() const { return (int)Threads.size(); }
+		double GetWaitTime() const { return WaitTime; }
+		double GetUploadTime() const;
+
+	private:
+
+		void Add(int Type, const std::string &Name, const std::string &Path, const std::string &DataPath="");
+		void Work();
+		void Decode(_Asset &Asset);
+		void DecodeMeshTextures(_Asset &Asset);
+		void Upload(_Asset &Asset);
+
+		// Assets
+		std::vector<std::unique_ptr<_Asset>> Assets;
+		std::unordered_set<std::string> Names[COUNT];
+		int Remaining[COUNT];
+		int MeshTextureCount;
+
+		// Queues guarded by Mutex
+		std::deque<_Asset *> Pending;
+		std::deque<_Asset *> Decoded;
+		std::unordered_set<std::string> MeshTextureNames;
+
+		// Times in milliseconds
+		double DecodeTimes[COUNT];
+		double UploadTimes[COUNT];
+		double WaitTime;
+
+		// Threads
+		std::vector<std::thread> Threads;
+		std::mutex Mutex;
+		std::condition_variable WorkCondition;
+		std::condition_variable DecodedCondition;
+		bool Stopping;
+
+};
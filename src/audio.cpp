@@ -16,11 +16,15 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <audio.h>
+#include <audiostream.h>
 #include <log.h>
 #include <config.h>
 #include <vorbis/vorbisfile.h>
 #include <vector>
 
+// Bytes requested from the decoder at a time
+static const size_t AUDIO_DECODE_SIZE = 4096;
+
 _Audio Audio;
 
 // Initializes the audio system
@@ -37,7 +41,7 @@ int _Audio::Init(bool Enabled) {
 	ALCdevice *Device = alcOpenDevice(nullptr);
 	if(Device == nullptr) {
 		Log.Write("Unable to create audio device");
-		Enabled = false;
+		this->Enabled = false;
 		return 0;
 	}
 
@@ -50,6 +54,19 @@ int _Audio::Init(bool Enabled) {
 	// Clear code
 	alGetError();
 
+	// Create voice pool, devices may allow fewer sources
+	for(int i = 0; i < AUDIO_MAX_VOICES; i++) {
+		_AudioVoice Voice = _AudioVoice();
+		alGenSources(1, &Voice.ID);
+		if(alGetError() != AL_NO_ERROR)
+			break;
+
+		FreeVoices.push_back((int)Voices.size());
+		Voices.push_back(Voice);
+	}
+	if(Voices.size() < AUDIO_MAX_VOICES)
+		Log.Write("Created %d of %d audio voices", (int)Voices.size(), AUDIO_MAX_VOICES);
+
 	return 1;
 }
 
@@ -59,9 +76,11 @@ int _Audio::Close() {
 		return 1;
 
 	// Remove playing sounds
-	for(auto &Iterator : Sources)
-		delete Iterator;
-	Sources.clear();
+	StopSounds();
+	for(auto &Voice : Voices)
+		alDeleteSources(1, &Voice.ID);
+	Voices.clear();
+	FreeVoices.clear();
 
 	// Free loaded sounds
 	FreeAllBuffers();
@@ -91,37 +110,152 @@ void _Audio::Update() {
 	if(!Enabled)
 		return;
 
-	// Update sources
-	for(auto Iterator = Sources.begin(); Iterator != Sources.end(); ) {
-		_AudioSource *Source = *Iterator;
-		bool NeedsDelete = false;
+	// Feed streaming sources
+	for(auto &Stream : Streams)
+		Stream->Update();
 
-		// Check conditions for deletion
-		if(!Source->IsPlaying()) {
-			NeedsDelete = true;
-		}
+	// Recycle finished voices
+	for(size_t i = 0; i < ActiveVoices.size(); ) {
+		_AudioVoice &Voice = Voices[ActiveVoices[i]];
 
-		// Delete source
-		if(NeedsDelete) {
-			delete Source;
-			Iterator = Sources.erase(Iterator);
+		bool Playing;
+		if(Voice.Stream) {
+			Voice.Stream->Update();
+			Playing = Voice.Stream->IsPlaying();
 		}
 		else {
-			++Iterator;
+			ALint State;
+			alGetSourcei(Voice.ID, AL_SOURCE_STATE, &State);
+			Playing = State == AL_PLAYING;
 		}
+
+		if(Playing)
+			i++;
+		else
+			ReleaseVoice(i);
 	}
 }
 
-// Stop all sounds from the audio manager and remove them
+// Stop all sounds started with Play and return their voices to the pool
 void _Audio::StopSounds() {
-	for(auto &Iterator : Sources) {
-		_AudioSource *Source = Iterator;
-		Source->Stop();
+	while(!ActiveVoices.empty())
+		ReleaseVoice(ActiveVoices.size() - 1);
+}
+
+// Play a sound on a pooled voice, returns a handle for Stop or 0 if no voice was free
+uint32_t _Audio::Play(const _AudioBuffer *Buffer, float X, float Y, float Z, bool Loop, float MinGain, float MaxGain, float ReferenceDistance, float RollOff, int Priority) {
+	if(!Enabled || !Buffer)
+		return 0;
 
-		delete Source;
+	int Index = GetVoice(Priority, X, Y, Z);
+	if(Index < 0)
+		return 0;
+
+	_AudioVoice &Voice = Voices[Index];
+	Voice.Position[0] = X;
+	Voice.Position[1] = Y;
+	Voice.Position[2] = Z;
+	Voice.Priority = Priority;
+	Voice.Generation++;
+	Voice.Active = true;
+	ActiveVoices.push_back(Index);
+
+	// Reset properties left over from the last sound
+	alSourcef(Voice.ID, AL_PITCH, 1.0f);
+	alSourcef(Voice.ID, AL_GAIN, 1.0f);
+	alSourcef(Voice.ID, AL_MIN_GAIN, MinGain);
+	alSourcef(Voice.ID, AL_MAX_GAIN, MaxGain);
+	alSourcef(Voice.ID, AL_REFERENCE_DISTANCE, ReferenceDistance);
+	alSourcef(Voice.ID, AL_ROLLOFF_FACTOR, RollOff);
+	alSource3f(Voice.ID, AL_POSITION, X, Y, -Z);
+
+	// Play sound
+	if(Buffer->Streamed) {
+		alSourcei(Voice.ID, AL_LOOPING, false);
+		Voice.Stream = new _AudioStream(Voice.ID, Buffer, Loop);
+		Voice.Stream->Play();
+	}
+	else {
+		alSourcei(Voice.ID, AL_BUFFER, Buffer->ID);
+		alSourcei(Voice.ID, AL_LOOPING, Loop);
+		alSourcePlay(Voice.ID);
 	}
 
-	Sources.clear();
+	return ((uint32_t)Voice.Generation << 16) | (uint32_t)(Index + 1);
+}
+
+// Stop a sound started with Play, ignores handles of recycled voices
+void _Audio::Stop(uint32_t Handle) {
+	int Index = (int)(Handle & 0xFFFF) - 1;
+	if(Index < 0 || Index >= (int)Voices.size())
+		return;
+
+	const _AudioVoice &Voice = Voices[Index];
+	if(!Voice.Active || Voice.Generation != (uint16_t)(Handle >> 16))
+		return;
+
+	for(size_t i = 0; i < ActiveVoices.size(); i++) {
+		if(ActiveVoices[i] == Index) {
+			ReleaseVoice(i);
+			return;
+		}
+	}
+}
+
+// Get a free voice, or steal the least important one. Returns -1 if every voice matters more.
+int _Audio::GetVoice(int Priority, float X, float Y, float Z) {
+
+	// Steal the lowest priority voice, then the one farthest from the listener
+	if(FreeVoices.empty()) {
+		int Steal = -1;
+		float StealDistance = 0.0f;
+		for(size_t i = 0; i < ActiveVoices.size(); i++) {
+			const _AudioVoice &Voice = Voices[ActiveVoices[i]];
+			float DeltaX = Voice.Position[0] - ListenerPosition[0];
+			float DeltaY = Voice.Position[1] - ListenerPosition[1];
+			float DeltaZ = Voice.Position[2] - ListenerPosition[2];
+			float Distance = DeltaX * DeltaX + DeltaY * DeltaY + DeltaZ * DeltaZ;
+
+			if(Steal == -1 || Voice.Priority < Voices[ActiveVoices[Steal]].Priority || (Voice.Priority == Voices[ActiveVoices[Steal]].Priority && Distance > StealDistance)) {
+				Steal = (int)i;
+				StealDistance = Distance;
+			}
+		}
+		if(Steal == -1)
+			return -1;
+
+		// Keep sounds that are more important than the new one
+		float DeltaX = X - ListenerPosition[0];
+		float DeltaY = Y - ListenerPosition[1];
+		float DeltaZ = Z - ListenerPosition[2];
+		float Distance = DeltaX * DeltaX + DeltaY * DeltaY + DeltaZ * DeltaZ;
+		int StealPriority = Voices[ActiveVoices[Steal]].Priority;
+		if(StealPriority > Priority || (StealPriority == Priority && StealDistance <= Distance))
+			return -1;
+
+		ReleaseVoice((size_t)Steal);
+	}
+
+	int Index = FreeVoices.back();
+	FreeVoices.pop_back();
+
+	return Index;
+}
+
+// Stop a voice and return it to the pool
+void _Audio::ReleaseVoice(size_t ActiveIndex) {
+	int Index = ActiveVoices[ActiveIndex];
+	_AudioVoice &Voice = Voices[Index];
+
+	delete Voice.Stream;
+	Voice.Stream = nullptr;
+	alSourceStop(Voice.ID);
+	alSourcei(Voice.ID, AL_BUFFER, 0);
+	Voice.Active = false;
+
+	ActiveVoices[ActiveIndex] = ActiveVoices.back();
+	ActiveVoices.pop_back();
+	FreeVoices.push_back(Index);
 }
 
 // Loads an ogg file into memory
@@ -129,13 +263,24 @@ bool _Audio::LoadBuffer(const std::string &File) {
 	if(!Enabled)
 		return true;
 
-	// Get path
-	std::string Path = std::string("sounds/") + File;
-
 	// Find existing buffer in map
-	if(Buffers.find(Path) != Buffers.end())
+	if(GetBuffer(File))
 		return true;
 
+	// Decode file
+	_AudioBuffer AudioBuffer;
+	std::vector<char> Data;
+	if(!DecodeBuffer(std::string("sounds/") + File, AudioBuffer, Data))
+		return false;
+
+	AddBuffer(File, AudioBuffer, Data);
+
+	return true;
+}
+
+// Decodes an ogg file without using OpenAL, so it can run on loader threads
+bool _Audio::DecodeBuffer(const std::string &Path, _AudioBuffer &AudioBuffer, std::vector<char> &Data) {
+
 	// Open vorbis stream
 	OggVorbis_File VorbisStream;
 	int ReturnCode = ov_fopen(Path.c_str(), &VorbisStream);
@@ -147,8 +292,7 @@ bool _Audio::LoadBuffer(const std::string &File) {
 	// Get vorbis file info
 	vorbis_info *Info = ov_info(&VorbisStream, -1);
 
-	// Create new buffer
-	_AudioBuffer AudioBuffer;
+	// Get format
 	switch(Info->channels) {
 		case 1:
 			AudioBuffer.Format = AL_FORMAT_MONO16;
@@ -157,45 +301,61 @@ bool _Audio::LoadBuffer(const std::string &File) {
 			AudioBuffer.Format = AL_FORMAT_STEREO16;
 		break;
 		default:
-			Log.Write("Unsupported # of channels %d for %s", Path.c_str());
+			Log.Write("Unsupported # of channels %d for %s", Info->channels, Path.c_str());
+			ov_clear(&VorbisStream);
 			return false;
 		break;
 	}
+	AudioBuffer.ID = 0;
+	AudioBuffer.Rate = (ALsizei)Info->rate;
+	AudioBuffer.Path = Path;
+
+	// Get decoded size, unseekable streams report an error instead
+	ogg_int64_t Samples = ov_pcm_total(&VorbisStream, -1);
+	AudioBuffer.Size = Samples > 0 ? (size_t)Samples * Info->channels * 2 : 0;
+
+	// Long sounds are decoded while they play
+	AudioBuffer.Streamed = AudioBuffer.Size > AUDIO_STREAM_THRESHOLD;
+	if(AudioBuffer.Streamed) {
+		ov_clear(&VorbisStream);
+		return true;
+	}
 
-	// Alloc some memory for the samples
-	std::vector<char> Data;
-
-	// Decode vorbis file
+	// Decode into memory sized from the stream, growing only when the size is unknown
+	Data.resize(AudioBuffer.Size + AUDIO_DECODE_SIZE);
+	size_t DataSize = 0;
 	long BytesRead;
-	char Buffer[4096];
 	int BitStream;
 	do {
-		BytesRead = ov_read(&VorbisStream, Buffer, 4096, 0, 2, 1, &BitStream);
-		Data.insert(Data.end(), Buffer, Buffer + BytesRead);
-	} while(BytesRead > 0);
+		if(Data.size() - DataSize < AUDIO_DECODE_SIZE)
+			Data.resize(Data.size() * 2);
 
-	// Create buffer
-	alGenBuffers(1, &AudioBuffer.ID);
-	alBufferData(AudioBuffer.ID, AudioBuffer.Format, &Data[0], (ALsizei)Data.size(), Info->rate);
+		BytesRead = ov_read(&VorbisStream, &Data[DataSize], (int)AUDIO_DECODE_SIZE, 0, 2, 1, &BitStream);
+		if(BytesRead > 0)
+			DataSize += BytesRead;
+	} while(BytesRead > 0);
+	Data.resize(DataSize);
+	AudioBuffer.Size = DataSize;
 
 	// Close vorbis file
 	ov_clear(&VorbisStream);
 
-	// Add to map
-	Buffers[Path] = AudioBuffer;
-
 	return true;
 }
 
-// Play an audio source and add it to the audio manager
-void _Audio::Play(_AudioSource *AudioSource, float X, float Y, float Z) {
-	if(!Enabled)
+// Uploads decoded data to a new buffer
+void _Audio::AddBuffer(const std::string &File, _AudioBuffer &AudioBuffer, const std::vector<char> &Data) {
+	if(!Enabled || GetBuffer(File))
 		return;
 
-	AudioSource->SetPosition(X, Y, Z);
-	Sources.push_back(AudioSource);
+	// Create buffer
+	if(!AudioBuffer.Streamed) {
+		alGenBuffers(1, &AudioBuffer.ID);
+		alBufferData(AudioBuffer.ID, AudioBuffer.Format, Data.data(), (ALsizei)Data.size(), AudioBuffer.Rate);
+	}
 
-	AudioSource->Play();
+	// Add to map
+	Buffers[std::string("sounds/") + File] = AudioBuffer;
 }
 
 // Get a loaded buffer
@@ -228,7 +388,8 @@ void _Audio::CloseBuffer(const std::string &File) {
 		return;
 
 	_AudioBuffer &Buffer = BuffersIterator->second;
-	alDeleteBuffers(1, &Buffer.ID);
+	if(!Buffer.Streamed)
+		alDeleteBuffers(1, &Buffer.ID);
 	Buffers.erase(BuffersIterator);
 }
 
@@ -241,7 +402,8 @@ void _Audio::FreeAllBuffers() {
 	for(auto BuffersIterator : Buffers) {
 		_AudioBuffer &Buffer = BuffersIterator.second;
 
-		alDeleteBuffers(1, &Buffer.ID);
+		if(!Buffer.Streamed)
+			alDeleteBuffers(1, &Buffer.ID);
 	}
 
 	Buffers.clear();
@@ -253,6 +415,9 @@ void _Audio::SetPosition(float X, float Y, float Z) {
 		return;
 
 	alListener3f(AL_POSITION, X, Y, -Z);
+	ListenerPosition[0] = X;
+	ListenerPosition[1] = Y;
+	ListenerPosition[2] = Z;
 }
 
 // Sets the listener direction
@@ -275,18 +440,25 @@ void _Audio::SetGain(float Value) {
 // Create an audio source
 _AudioSource::_AudioSource(const _AudioBuffer *Buffer, bool Loop, float MinGain, float MaxGain, float ReferenceDistance, float RollOff) {
 	Loaded = false;
+	Stream = nullptr;
 	if(Buffer) {
 
 		// Create source
 		alGenSources(1, &ID);
-
-		// Assign buffer to source
-		alSourcei(ID, AL_BUFFER, Buffer->ID);
 		alSourcef(ID, AL_MIN_GAIN, MinGain);
 		alSourcef(ID, AL_MAX_GAIN, MaxGain);
 		alSourcef(ID, AL_REFERENCE_DISTANCE, ReferenceDistance);
 		alSourcef(ID, AL_ROLLOFF_FACTOR, RollOff);
-		alSourcei(ID, AL_LOOPING, Loop);
+
+		// Streams queue their own buffers and handle looping in the decoder
+		if(Buffer->Streamed) {
+			Stream = new _AudioStream(ID, Buffer, Loop);
+			Audio.AddStream(Stream);
+		}
+		else {
+			alSourcei(ID, AL_BUFFER, Buffer->ID);
+			alSourcei(ID, AL_LOOPING, Loop);
+		}
 		Loaded = true;
 	}
 }
@@ -295,7 +467,13 @@ _AudioSource::_AudioSource(const _AudioBuffer *Buffer, bool Loop, float MinGain,
 _AudioSource::~_AudioSource() {
 	if(Loaded) {
 
-		// Create source
+		// Stop stream
+		if(Stream) {
+			Audio.RemoveStream(Stream);
+			delete Stream;
+		}
+
+		// Delete source
 		alDeleteSources(1, &ID);
 		Loaded = false;
 	}
@@ -303,7 +481,10 @@ _AudioSource::~_AudioSource() {
 
 // Play
 void _AudioSource::Play() {
-	if(Loaded) {
+	if(Stream) {
+		Stream->Play();
+	}
+	else if(Loaded) {
 
 		// Get state
 		ALint State;
@@ -320,13 +501,19 @@ void _AudioSource::Play() {
 
 // Stop
 void _AudioSource::Stop() {
-	if(Loaded) {
+	if(Stream) {
+		Stream->Stop();
+	}
+	else if(Loaded) {
 		alSourceStop(ID);
 	}
 }
 
 // Returns true if the source is playing
 bool _AudioSource::IsPlaying() {
+	if(Stream)
+		return Stream->IsPlaying();
+
 	ALenum State;
 
 	alGetSourcei(ID, AL_SOURCE_STATE, &State);
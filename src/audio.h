@@ -18,17 +18,41 @@
 #pragma once
 #include <al.h>
 #include <alc.h>
+#include <cstdint>
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 
-// Struct for OpenAL buffers
+// Forward declarations
+class _AudioStream;
+
+// Constants
+
+// Number of OpenAL sources kept for sounds started with _Audio::Play
+const int AUDIO_MAX_VOICES = 32;
+
+// Struct for OpenAL buffers, long sounds are streamed from Path instead of loaded into ID
 struct _AudioBuffer {
 	ALuint ID;
 	ALenum Format;
+	ALsizei Rate;
+	size_t Size;
+	bool Streamed;
+	std::string Path;
 };
 
-// Class for OpenAL sources
+// Pooled OpenAL source for fire and forget sounds
+struct _AudioVoice {
+	ALuint ID;
+	_AudioStream *Stream;
+	float Position[3];
+	int Priority;
+	uint16_t Generation;
+	bool Active;
+};
+
+// Class for OpenAL sources owned by objects
 class _AudioSource {
 
 	public:
@@ -43,11 +67,13 @@ class _AudioSource {
 		void SetPosition(float X, float Y, float Z);
 
 		bool IsPlaying();
+		bool IsStreamed() { return Stream != nullptr; }
 
 	private:
 
 		bool Loaded;
 		ALuint ID;
+		_AudioStream *Stream;
 };
 
 // Classes
@@ -62,11 +88,20 @@ class _Audio {
 
 		// Manager
 		void Update();
-		void Play(_AudioSource *AudioSource, float X, float Y, float Z);
 		void StopSounds();
+		void AddStream(_AudioStream *Stream) { Streams.push_back(Stream); }
+		void RemoveStream(_AudioStream *Stream) { Streams.remove(Stream); }
+
+		// Voices, handles stay valid until the voice is recycled
+		uint32_t Play(const _AudioBuffer *Buffer, float X, float Y, float Z, bool Loop=false, float MinGain=0.0f, float MaxGain=1.0f, float ReferenceDistance=1.0f, float RollOff=1.0f, int Priority=0);
+		void Stop(uint32_t Handle);
+		int GetVoiceCount() { return (int)Voices.size(); }
+		int GetActiveVoiceCount() { return (int)ActiveVoices.size(); }
 
 		// Buffers
 		bool LoadBuffer(const std::string &File);
+		static bool DecodeBuffer(const std::string &Path, _AudioBuffer &AudioBuffer, std::vector<char> &Data);
+		void AddBuffer(const std::string &File, _AudioBuffer &AudioBuffer, const std::vector<char> &Data);
 		const _AudioBuffer *GetBuffer(const std::string &File);
 		void CloseBuffer(const std::string &File);
 		void FreeAllBuffers();
@@ -78,14 +113,23 @@ class _Audio {
 
 	private:
 
+		int GetVoice(int Priority, float X, float Y, float Z);
+		void ReleaseVoice(size_t ActiveIndex);
+
 		// State
 		bool Enabled;
+		float ListenerPosition[3];
 
 		// Buffers
 		std::map<std::string, _AudioBuffer> Buffers;
 
-		// Sources
-		std::list<_AudioSource *> Sources;
+		// Voices
+		std::vector<_AudioVoice> Voices;
+		std::vector<int> FreeVoices;
+		std::vector<int> ActiveVoices;
+
+		// Streams of owned sources
+		std::list<_AudioStream *> Streams;
 };
 
 // Singletons
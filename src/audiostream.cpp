@@ -0,0 +1,219 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <audiostream.h>
+#include <audio.h>
+#include <log.h>
+
+// Open the sound's file and start decoding
+_AudioStream::_AudioStream(ALuint Source, const _AudioBuffer *Buffer, bool Loop) :
+	Source(Source),
+	Format(Buffer->Format),
+	Rate(Buffer->Rate),
+	FreeCount(AUDIO_STREAM_BUFFERS),
+	Playing(false),
+	Opened(false),
+	Loop(Loop),
+	ReadIndex(0),
+	WriteIndex(0),
+	ReadyCount(0),
+	Generation(0),
+	RewindRequested(false),
+	EndOfStream(true),
+	Stopping(false) {
+
+	alGenBuffers(AUDIO_STREAM_BUFFERS, Buffers);
+	for(int i = 0; i < AUDIO_STREAM_BUFFERS; i++)
+		FreeBuffers[i] = Buffers[i];
+
+	// Each stream has its own decoder
+	int ReturnCode = ov_fopen(Buffer->Path.c_str(), &VorbisStream);
+	if(ReturnCode != 0) {
+		Log.Write("ov_fopen failed on file %s with code %d", Buffer->Path.c_str(), ReturnCode);
+		return;
+	}
+
+	Opened = true;
+	EndOfStream = false;
+	DecodeThread = std::thread(&_AudioStream::Decode, this);
+}
+
+// Stop the decoder thread and free buffers
+_AudioStream::~_AudioStream() {
+	Stop();
+
+	if(Opened) {
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Stopping = true;
+		}
+		Condition.notify_one();
+		DecodeThread.join();
+
+		ov_clear(&VorbisStream);
+	}
+
+	alDeleteBuffers(AUDIO_STREAM_BUFFERS, Buffers);
+}
+
+// Queue decoded chunks on the source and restart it after an underrun
+void _AudioStream::Update() {
+	if(!Playing)
+		return;
+
+	// Reclaim buffers the source has finished with
+	ALint Processed = 0;
+	alGetSourcei(Source, AL_BUFFERS_PROCESSED, &Processed);
+	for(; Processed > 0 && FreeCount < AUDIO_STREAM_BUFFERS; Processed--)
+		alSourceUnqueueBuffers(Source, 1, &FreeBuffers[FreeCount++]);
+
+	// Upload decoded chunks into free buffers
+	bool Uploaded = false;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		while(FreeCount && ReadyCount) {
+			ALuint Buffer = FreeBuffers[--FreeCount];
+			alBufferData(Buffer, Format, Chunks[ReadIndex], (ALsizei)ChunkSizes[ReadIndex], Rate);
+			alSourceQueueBuffers(Source, 1, &Buffer);
+
+			ReadIndex = (ReadIndex + 1) % AUDIO_STREAM_BUFFERS;
+			ReadyCount--;
+			Uploaded = true;
+		}
+	}
+	if(Uploaded)
+		Condition.notify_one();
+
+	// The source stops when it runs out of queued data
+	ALint State, Queued;
+	alGetSourcei(Source, AL_SOURCE_STATE, &State);
+	alGetSourcei(Source, AL_BUFFERS_QUEUED, &Queued);
+	if(State != AL_PLAYING && Queued > 0)
+		alSourcePlay(Source);
+}
+
+// Start playing from the beginning
+void _AudioStream::Play() {
+	if(Playing)
+		Stop();
+
+	Playing = true;
+	Update();
+	alSourcePlay(Source);
+}
+
+// Stop playing and rewind the decoder
+void _AudioStream::Stop() {
+	if(!Playing)
+		return;
+
+	// Stopped sources have processed all of their buffers
+	alSourceStop(Source);
+	ALint Queued = 0;
+	alGetSourcei(Source, AL_BUFFERS_QUEUED, &Queued);
+	for(; Queued > 0 && FreeCount < AUDIO_STREAM_BUFFERS; Queued--)
+		alSourceUnqueueBuffers(Source, 1, &FreeBuffers[FreeCount++]);
+
+	Playing = false;
+
+	// Drop decoded chunks, including one being decoded now
+	if(Opened) {
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			ReadIndex = WriteIndex = ReadyCount = 0;
+			Generation++;
+			RewindRequested = true;
+			EndOfStream = false;
+		}
+		Condition.notify_one();
+	}
+}
+
+// Returns true until the stream has stopped or played all of its data
+bool _AudioStream::IsPlaying() {
+	if(!Playing)
+		return false;
+
+	ALint State;
+	alGetSourcei(Source, AL_SOURCE_STATE, &State);
+	if(State == AL_PLAYING)
+		return true;
+
+	// Stopped by an underrun
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return !EndOfStream || ReadyCount > 0;
+}
+
+// Keep the ring of decoded chunks full
+void _AudioStream::Decode() {
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while(true) {
+		Condition.wait(Lock, [this]() { return Stopping || RewindRequested || (!EndOfStream && ReadyCount < AUDIO_STREAM_BUFFERS); });
+		if(Stopping)
+			break;
+
+		if(RewindRequested) {
+			ov_pcm_seek(&VorbisStream, 0);
+			RewindRequested = false;
+			continue;
+		}
+
+		// Decode into the next free chunk without holding the lock
+		int Index = WriteIndex;
+		int CurrentGeneration = Generation;
+		size_t Size;
+		Lock.unlock();
+		bool More = DecodeChunk(Chunks[Index], Size);
+		Lock.lock();
+
+		// Discard the chunk if the stream was rewound while decoding
+		if(Generation != CurrentGeneration)
+			continue;
+
+		if(Size) {
+			ChunkSizes[Index] = Size;
+			WriteIndex = (WriteIndex + 1) % AUDIO_STREAM_BUFFERS;
+			ReadyCount++;
+		}
+		if(!More)
+			EndOfStream = true;
+	}
+}
+
+// Fill a chunk with PCM data, returns false at the end of a sound that doesn't loop
+bool _AudioStream::DecodeChunk(char *Data, size_t &Size) {
+	Size = 0;
+	bool Rewound = false;
+	while(Size < AUDIO_STREAM_CHUNK_SIZE) {
+		int BitStream;
+		long BytesRead = ov_read(&VorbisStream, Data + Size, (int)(AUDIO_STREAM_CHUNK_SIZE - Size), 0, 2, 1, &BitStream);
+		if(BytesRead > 0) {
+			Size += BytesRead;
+			Rewound = false;
+		}
+		else if(BytesRead == OV_HOLE) {
+			continue;
+		}
+		else if(BytesRead == 0 && Loop && !Rewound && ov_pcm_seek(&VorbisStream, 0) == 0) {
+			Rewound = true;
+		}
+		else
+			return false;
+	}
+
+	return true;
+}
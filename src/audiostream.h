@@ -0,0 +1,92 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <al.h>
+#include <vorbis/vorbisfile.h>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+// Constants
+
+// Sounds that decode to more than this many bytes are streamed instead of loaded into one buffer
+const size_t AUDIO_STREAM_THRESHOLD = 2 * 1024 * 1024;
+
+// Number of OpenAL buffers queued on a streaming source, and decoded chunks waiting for them
+const int AUDIO_STREAM_BUFFERS = 4;
+
+// Bytes of PCM data in each chunk, about 0.37 seconds of 44.1kHz stereo
+const size_t AUDIO_STREAM_CHUNK_SIZE = 64 * 1024;
+
+// Forward declarations
+struct _AudioBuffer;
+
+// Plays an ogg file through a small ring of OpenAL buffers fed by a decoder thread
+class _AudioStream {
+
+	public:
+
+		_AudioStream(ALuint Source, const _AudioBuffer *Buffer, bool Loop);
+		~_AudioStream();
+
+		void Update();
+		void Play();
+		void Stop();
+		bool IsPlaying();
+
+		static size_t GetResidentSize() { return AUDIO_STREAM_BUFFERS * AUDIO_STREAM_CHUNK_SIZE * 2; }
+
+	private:
+
+		void Decode();
+		bool DecodeChunk(char *Data, size_t &Size);
+
+		// OpenAL
+		ALuint Source;
+		ALenum Format;
+		ALsizei Rate;
+		ALuint Buffers[AUDIO_STREAM_BUFFERS];
+		ALuint FreeBuffers[AUDIO_STREAM_BUFFERS];
+		int FreeCount;
+		bool Playing;
+
+		// Decoder
+		OggVorbis_File VorbisStream;
+		bool Opened;
+		bool Loop;
+
+		// Ring of decoded chunks, guarded by Mutex
+		char Chunks[AUDIO_STREAM_BUFFERS][AUDIO_STREAM_CHUNK_SIZE];
+		size_t ChunkSizes[AUDIO_STREAM_BUFFERS];
+		int ReadIndex;
+		int WriteIndex;
+		int ReadyCount;
+		int Generation;
+		bool RewindRequested;
+		bool EndOfStream;
+		bool Stopping;
+
+		// Decoder thread
+		std::thread DecodeThread;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+
+};
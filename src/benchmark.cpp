@@ -0,0 +1,1665 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <benchmark.h>
+#include <arena.h>
+#include <audio.h>
+#include <audiostream.h>
+#include <replay.h>
+#include <save.h>
+#include <config.h>
+#include <globals.h>
+#include <level.h>
+#include <objectmanager.h>
+#include <camera.h>
+#include <physics.h>
+#include <scripting.h>
+#include <framework.h>
+#include <mappedfile.h>
+#include <colmesh.h>
+#include <scheduler.h>
+#include <states/play.h>
+#include <objects/object.h>
+#include <objects/player.h>
+#include <objects/template.h>
+#include <objects/terrain.h>
+#include <ode/collision.h>
+#include <ISceneManager.h>
+#include <IFileSystem.h>
+#include <vorbis/vorbisfile.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+	#include <malloc.h>
+#endif
+
+// Number of physics steps recorded by the replay benchmark
+static const int BENCHMARK_REPLAY_STEPS = 50000;
+
+// Number of moving objects written each step
+static const int BENCHMARK_REPLAY_OBJECTS = 50;
+
+// Number of physics steps run on each level by the physics benchmark
+static const int BENCHMARK_PHYSICS_STEPS = 2500;
+
+// Levels with the slowest physics steps
+static const char *BENCHMARK_PHYSICS_LEVELS[] = { "plane", "caves_6", "c_seesaw0", "caves_4", "c_cubism0" };
+
+// Largest collision meshes
+static const char *BENCHMARK_COLMESH_FILES[] = { "caves_0/caves_0.col", "caves_1/caves_1.col", "house/house.col", "c_sinkhole0/c_sinkhole0.col", "caves_4/caves_4a.col" };
+
+// Number of times each collision mesh is loaded
+static const int BENCHMARK_COLMESH_LOADS = 20;
+
+// Levels with heightmap terrain
+static const char *BENCHMARK_TERRAIN_LEVELS[] = { "caves_3", "caves_5" };
+
+// Number of probes along each side of a terrain
+static const int BENCHMARK_TERRAIN_PROBES = 64;
+
+// Fractions of the probe spacing to start at, chosen so probes don't land on terrain vertices, or on cell diagonals when they differ
+static const double BENCHMARK_TERRAIN_PROBE_OFFSET[2] = { 0.371, 0.613 };
+
+// Radius of the spheres used to probe terrain
+static const float BENCHMARK_TERRAIN_PROBE_RADIUS = 0.5f;
+
+// Largest differences between trimesh and heightfield probes before the heightfield benchmark fails
+static const double BENCHMARK_HEIGHTFIELD_MAX_HEIGHT_ERROR = 0.001;
+static const double BENCHMARK_HEIGHTFIELD_MAX_NORMAL_ERROR = 0.5;
+static const double BENCHMARK_HEIGHTFIELD_MAX_DEPTH_ERROR = 0.001;
+
+// Number of objects created by the object lookup benchmark
+static const int BENCHMARK_OBJECTS = 10000;
+
+// Number of lookups of each kind
+static const int BENCHMARK_OBJECT_LOOKUPS = 100000;
+
+// Number of level resets timed on each level
+static const int BENCHMARK_RESETS = 50;
+
+// Number of physics steps run before each reset
+static const int BENCHMARK_RESET_STEPS = 60;
+
+// Levels with the most objects
+static const char *BENCHMARK_RESET_LEVELS[] = { "bench_stack", "c_cubism0", "c_seesaw0" };
+
+// Number of dynamic bodies interpolated by the transform benchmark
+static const int BENCHMARK_TRANSFORM_OBJECTS = 4096;
+
+// Number of physics steps run by the transform benchmark
+static const int BENCHMARK_TRANSFORM_STEPS = 20;
+
+// Number of rendered frames between physics steps
+static const int BENCHMARK_TRANSFORM_FRAMES = 4;
+
+// Number of physics steps run on each level by the sleep benchmark
+static const int BENCHMARK_SLEEP_STEPS = 1500;
+
+// Number of steps sampled at the start and end of the sleep benchmark
+static const int BENCHMARK_SLEEP_WINDOW = 100;
+
+// Levels with stacks that settle
+static const char *BENCHMARK_SLEEP_LEVELS[] = { "bench_stack", "c_cubism0", "c_seesaw0" };
+
+// Number of physics steps run on the callback level
+static const int BENCHMARK_CALLBACK_STEPS = 1000;
+
+// Number of calls made through each way of finding a collision handler
+static const int BENCHMARK_CALLBACK_CALLS = 1000000;
+
+// Numbers of pending timers scheduled by the timer benchmark
+static const int BENCHMARK_TIMER_COUNTS[] = { 100, 1000, 10000 };
+
+// Longest delay of a benchmark timer in seconds
+static const int BENCHMARK_TIMER_RANGE = 60;
+
+// Largest sounds
+static const char *BENCHMARK_AUDIO_FILES[] = { "tower.ogg", "jazztown.ogg", "howl.ogg", "player.ogg", "furnace.ogg" };
+
+// Number of times each sound is loaded
+static const int BENCHMARK_AUDIO_LOADS = 5;
+
+// Frames of impact sounds played by the voice benchmark, and sounds started each frame
+static const int BENCHMARK_VOICE_FRAMES = 1000;
+static const int BENCHMARK_VOICE_BURST = 8;
+
+// Levels with the most resting contacts
+static const char *BENCHMARK_COLLISION_LEVELS[] = { "bench_stack", "c_seesaw0", "c_cubism0" };
+
+// Seconds of simulation run on each level by the level suite
+static const float BENCHMARK_LEVEL_TIME = 10.0f;
+
+// Seconds between changes of the synthesized input, and how often a change also jumps
+static const float BENCHMARK_LEVEL_INPUT_INTERVAL = 0.5f;
+static const int BENCHMARK_LEVEL_JUMP_CHANCE = 4;
+
+// Steps between samples of resident memory while a level runs
+static const int BENCHMARK_LEVEL_RSS_INTERVAL = 60;
+
+_Benchmark Benchmark;
+
+// Player input applied at a time
+struct _BenchmarkInput {
+	float Time;
+	_ReplayInputEvent Input;
+};
+
+// Result of running one level
+struct _LevelResult {
+	std::string Name;
+	std::string Error;
+	std::string Input;
+	int Objects;
+	int Steps;
+	bool Ended;
+	double LoadTime;
+	double StepsPerSecond;
+	double P50, P99, MaxStep;
+	_CollisionStats Collisions;
+	long BaseRSS;
+	long LevelRSS;
+};
+
+// Write one physics step of replay events in the same order as the game
+template<typename T> static void WriteStep(T &Output, float Time) {
+	float Values[6] = { 1.0f, 2.0f, 3.0f, 45.0f, 10.0f, 5.0f };
+	char Jumped = 0;
+	int16_t Count = BENCHMARK_REPLAY_OBJECTS;
+
+	// Input, player speed and camera
+	Output.write("\x85", 1);
+	Output.write((char *)&Time, sizeof(Time));
+	Output.write((char *)&Values[0], sizeof(float));
+	Output.write((char *)&Values[1], sizeof(float));
+	Output.write((char *)&Values[2], sizeof(float));
+	Output.write((char *)&Values[3], sizeof(float));
+	Output.write(&Jumped, 1);
+	Output.write("\x86", 1);
+	Output.write((char *)&Time, sizeof(Time));
+	Output.write((char *)&Values[0], sizeof(float));
+	Output.write("\x80", 1);
+	Output.write((char *)&Time, sizeof(Time));
+	Output.write((char *)&Values[0], sizeof(float) * 3);
+	Output.write((char *)&Values[3], sizeof(float) * 3);
+
+	// Movement
+	Output.write("\x81", 1);
+	Output.write((char *)&Time, sizeof(Time));
+	Output.write((char *)&Count, sizeof(Count));
+	for(uint16_t i = 0; i < BENCHMARK_REPLAY_OBJECTS; i++) {
+		Output.write((char *)&i, sizeof(i));
+		Output.write((char *)&Values[0], sizeof(float) * 3);
+		Output.write((char *)&Values[3], sizeof(float) * 3);
+	}
+}
+
+// Adapts _ReplayWriter to the stream write signature
+struct _WriterAdapter {
+	void write(const char *Data, std::streamsize Size) { Writer.Write(Data, (size_t)Size); }
+	_ReplayWriter Writer;
+};
+
+// Constructor
+_Benchmark::_Benchmark() :
+	LevelTime(BENCHMARK_LEVEL_TIME),
+	LevelOutputPath("bench.json"),
+	Running(false),
+	LevelEnded(false) {
+}
+
+// Run a benchmark by name
+int _Benchmark::Run(const std::string &Name) {
+	Running = true;
+	int Result = RunSuite(Name);
+	Running = false;
+
+	return Result;
+}
+
+// Record a win or loss from a level script, returns true if a benchmark owns the level
+bool _Benchmark::EndLevel() {
+	if(!Running)
+		return false;
+
+	LevelEnded = true;
+	return true;
+}
+
+// Dispatch a benchmark by name
+int _Benchmark::RunSuite(const std::string &Name) {
+	if(Name == "replaywriter")
+		RunReplayWriter();
+	else if(Name == "physics")
+		return RunPhysics();
+	else if(Name == "broadphase")
+		return RunBroadphase();
+	else if(Name == "collision")
+		return RunCollision();
+	else if(Name == "colmesh")
+		return RunColMesh();
+	else if(Name == "terrain")
+		return RunTerrain();
+	else if(Name == "heightfield")
+		return RunHeightField();
+	else if(Name == "objects")
+		RunObjects();
+	else if(Name == "reset")
+		return RunReset();
+	else if(Name == "transforms")
+		return RunTransforms();
+	else if(Name == "sleep")
+		return RunSleep();
+	else if(Name == "callbacks")
+		return RunCallbacks();
+	else if(Name == "timers")
+		return RunTimers();
+	else if(Name == "audio")
+		return RunAudio();
+	else if(Name == "voices")
+		return RunVoices();
+	else if(Name == "levels")
+		return RunLevels();
+	else {
+		std::cout << "Unknown benchmark: " << Name << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+// Measure the cost of recording one physics step of replay events
+void _Benchmark::RunReplayWriter() {
+	std::string Path = Save.ReplayPath + "benchmark.dat";
+	float TimeStep = 1.0f / 500.0f;
+
+	// Per field stream writes
+	std::fstream File(Path.c_str(), std::ios::out | std::ios::binary);
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	float Time = 0.0f;
+	for(int i = 0; i < BENCHMARK_REPLAY_STEPS; i++) {
+		WriteStep(File, Time);
+		Time += TimeStep;
+	}
+	File.close();
+	std::chrono::duration<double, std::nano> StreamTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+	// Buffered writer
+	_WriterAdapter Adapter;
+	Adapter.Writer.Open(Path);
+	StartTime = std::chrono::high_resolution_clock::now();
+	Time = 0.0f;
+	for(int i = 0; i < BENCHMARK_REPLAY_STEPS; i++) {
+		WriteStep(Adapter, Time);
+		Time += TimeStep;
+	}
+	std::chrono::duration<double, std::nano> WriterTime = std::chrono::high_resolution_clock::now() - StartTime;
+	uint32_t Size = Adapter.Writer.GetSize();
+	Adapter.Writer.Close();
+	remove(Path.c_str());
+
+	std::cout << "replaywriter steps=" << BENCHMARK_REPLAY_STEPS << " objects=" << BENCHMARK_REPLAY_OBJECTS << " bytes=" << Size << std::endl;
+	std::cout << "  fstream " << StreamTime.count() / BENCHMARK_REPLAY_STEPS << " ns/step" << std::endl;
+	std::cout << "  writer  " << WriterTime.count() / BENCHMARK_REPLAY_STEPS << " ns/step" << std::endl;
+}
+
+// Step a level with and without the physics thread pool, returns 1 if the results differ
+int _Benchmark::RunPhysics() {
+	int SavedThreads = Config.PhysicsThreads;
+	int Threads = SavedThreads > 1 ? SavedThreads : std::max(2u, std::thread::hardware_concurrency());
+	int Result = 0;
+
+	std::cout << "physics steps=" << BENCHMARK_PHYSICS_STEPS << " threads=" << Threads << std::endl;
+	for(const char *LevelName : BENCHMARK_PHYSICS_LEVELS) {
+		uint64_t SingleHash = 0;
+		double SingleRate = 0.0;
+		for(int ThreadCount : { 1, Threads }) {
+			Config.PhysicsThreads = ThreadCount;
+			if(!LoadLevel(LevelName, nullptr)) {
+				Result = 1;
+				break;
+			}
+
+			// Run physics
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCHMARK_PHYSICS_STEPS; i++)
+				StepLevel();
+			std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+
+			int ObjectCount;
+			uint64_t Hash = HashBodies(ObjectCount);
+			CloseLevel();
+
+			double Rate = BENCHMARK_PHYSICS_STEPS / Elapsed.count();
+			if(ThreadCount == 1) {
+				SingleHash = Hash;
+				SingleRate = Rate;
+				printf("  %-12s objects=%-4d 1 thread  %8.0f steps/s %016llx\n", LevelName, ObjectCount, Rate, (unsigned long long)Hash);
+			}
+			else {
+				bool Match = Hash == SingleHash;
+				printf("  %-12s objects=%-4d %d threads %8.0f steps/s x%.2f %s\n", LevelName, ObjectCount, ThreadCount, Rate, Rate / SingleRate, Match ? "deterministic" : "MISMATCH");
+				if(!Match)
+					Result = 1;
+			}
+		}
+	}
+	Config.PhysicsThreads = SavedThreads;
+
+	return Result;
+}
+
+// Count the pairs reported by the broadphase
+static void CountPairsCallback(void *Data, dGeomID Geometry, dGeomID OtherGeometry) {
+	(*(uint64_t *)Data)++;
+}
+
+// Compare collision pairs and collide time for each broadphase
+int _Benchmark::RunBroadphase() {
+
+	// Broadphases to compare
+	std::vector<std::pair<std::string, _Broadphase>> Broadphases;
+	_Broadphase Broadphase;
+	Broadphase.SplitStatic = false;
+	Broadphases.push_back(std::make_pair("hash 1 space", Broadphase));
+	Broadphase.SplitStatic = true;
+	Broadphases.push_back(std::make_pair("hash", Broadphase));
+	Broadphase.MinLevel = -1;
+	Broadphase.MaxLevel = 6;
+	Broadphases.push_back(std::make_pair("hash -1..6", Broadphase));
+	Broadphase.Type = _Broadphase::BROADPHASE_SAP;
+	Broadphases.push_back(std::make_pair("sap", Broadphase));
+	Broadphase.Type = _Broadphase::BROADPHASE_QUADTREE;
+	Broadphase.Extents = glm::vec3(200.0f);
+	Broadphase.Depth = 6;
+	Broadphases.push_back(std::make_pair("quadtree", Broadphase));
+
+	std::cout << "broadphase steps=" << BENCHMARK_PHYSICS_STEPS << std::endl;
+	for(const char *LevelName : BENCHMARK_PHYSICS_LEVELS) {
+		for(const auto &Entry : Broadphases) {
+			if(!LoadLevel(LevelName, &Entry.second))
+				return 1;
+
+			// Time a pair counting collide before each step
+			uint64_t Pairs = 0;
+			std::chrono::duration<double, std::micro> CollideTime(0);
+			Physics.ResetCollisionStats();
+			for(int i = 0; i < BENCHMARK_PHYSICS_STEPS; i++) {
+				auto StartTime = std::chrono::high_resolution_clock::now();
+				dSpaceCollide(Physics.GetSpace(), &Pairs, &CountPairsCallback);
+				if(Physics.GetStaticSpace())
+					dSpaceCollide2((dGeomID)Physics.GetSpace(), (dGeomID)Physics.GetStaticSpace(), &Pairs, &CountPairsCallback);
+				CollideTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+				StepLevel();
+			}
+			const _CollisionStats &Stats = Physics.GetCollisionStats();
+			CloseLevel();
+
+			printf("  %-12s %-12s pairs/step=%8.1f narrowphase/step=%8.1f contacts/step=%8.1f collide=%7.2f us\n",
+				LevelName,
+				Entry.first.c_str(),
+				(double)Pairs / BENCHMARK_PHYSICS_STEPS,
+				(double)Stats.NearCalls / BENCHMARK_PHYSICS_STEPS,
+				(double)Stats.Contacts / BENCHMARK_PHYSICS_STEPS,
+				CollideTime.count() / BENCHMARK_PHYSICS_STEPS);
+		}
+	}
+
+	return 0;
+}
+
+// Measure the cost of contact generation and collision callbacks
+int _Benchmark::RunCollision() {
+
+	std::cout << "collision steps=" << BENCHMARK_PHYSICS_STEPS << std::endl;
+	for(const char *LevelName : BENCHMARK_COLLISION_LEVELS) {
+		if(!LoadLevel(LevelName, nullptr))
+			return 1;
+
+		// Step the level
+		Physics.ResetCollisionStats();
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		for(int i = 0; i < BENCHMARK_PHYSICS_STEPS; i++)
+			StepLevel();
+		std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+
+		int ObjectCount;
+		HashBodies(ObjectCount);
+		const _CollisionStats &Stats = Physics.GetCollisionStats();
+		CloseLevel();
+
+		printf("  %-12s objects=%-4d narrowphase/step=%8.1f contacts/step=%8.1f events/step=%8.1f %8.0f steps/s\n",
+			LevelName,
+			ObjectCount,
+			(double)Stats.NearCalls / BENCHMARK_PHYSICS_STEPS,
+			(double)Stats.Contacts / BENCHMARK_PHYSICS_STEPS,
+			(double)Stats.Events / BENCHMARK_PHYSICS_STEPS,
+			BENCHMARK_PHYSICS_STEPS / Elapsed.count());
+	}
+
+	return 0;
+}
+
+// Compare precooked collision trees against building them at load time
+int _Benchmark::RunColMesh() {
+
+	std::cout << "colmesh loads=" << BENCHMARK_COLMESH_LOADS << std::endl;
+	for(const char *File : BENCHMARK_COLMESH_FILES) {
+		_MappedFile MappedFile;
+		std::string Path = Framework.GetWorkingPath() + "levels/" + File;
+		if(!MappedFile.Open(Path) || !_ColMesh::IsColMesh(MappedFile)) {
+			std::cout << "Not a precooked collision mesh: " << Path << std::endl;
+			return 1;
+		}
+
+		// Get lists
+		_ColMeshHeader Header;
+		memcpy(&Header, MappedFile.GetData(), sizeof(Header));
+		const char *Vertices = MappedFile.GetData() + Header.VertexOffset;
+		const char *Faces = MappedFile.GetData() + Header.FaceOffset;
+		const char *Nodes = MappedFile.GetData() + Header.NodeOffset;
+
+		// Time building the tree and using the saved one
+		std::chrono::duration<double, std::milli> BuildTime(0), PrecookedTime(0);
+		std::vector<char> BuiltTree, PrecookedTree;
+		for(int i = 0; i < BENCHMARK_COLMESH_LOADS; i++) {
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			dTriMeshDataID TriMeshData = dGeomTriMeshDataCreate();
+			dGeomTriMeshDataBuildSingle1(TriMeshData, Vertices, 3 * sizeof(float), Header.VertexCount, Faces, Header.FaceCount * 3, 3 * sizeof(dTriIndex), nullptr);
+			BuildTime += std::chrono::high_resolution_clock::now() - StartTime;
+			BuiltTree.resize(dGeomTriMeshDataGetTree(TriMeshData, nullptr) * COLMESH_NODE_SIZE);
+			dGeomTriMeshDataGetTree(TriMeshData, BuiltTree.data());
+			dGeomTriMeshDataDestroy(TriMeshData);
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			TriMeshData = dGeomTriMeshDataCreate();
+			dGeomTriMeshDataBuildSingleTree(TriMeshData, Vertices, 3 * sizeof(float), Header.VertexCount, Faces, Header.FaceCount * 3, 3 * sizeof(dTriIndex), Nodes, Header.NodeCount);
+			PrecookedTime += std::chrono::high_resolution_clock::now() - StartTime;
+			PrecookedTree.resize(dGeomTriMeshDataGetTree(TriMeshData, nullptr) * COLMESH_NODE_SIZE);
+			dGeomTriMeshDataGetTree(TriMeshData, PrecookedTree.data());
+			dGeomTriMeshDataDestroy(TriMeshData);
+		}
+
+		printf("  %-28s faces=%-6u build=%7.3f ms precooked=%7.3f ms x%.1f %s\n",
+			File,
+			Header.FaceCount,
+			BuildTime.count() / BENCHMARK_COLMESH_LOADS,
+			PrecookedTime.count() / BENCHMARK_COLMESH_LOADS,
+			BuildTime.count() / PrecookedTime.count(),
+			BuiltTree == PrecookedTree ? "identical" : "MISMATCH");
+	}
+
+	return 0;
+}
+
+// Compare loading terrain levels with and without baked collision meshes
+int _Benchmark::RunTerrain() {
+
+	std::cout << "terrain" << std::endl;
+	for(const char *LevelName : BENCHMARK_TERRAIN_LEVELS) {
+
+		// Load once so textures are cached, then load without and with baked meshes
+		std::chrono::duration<double, std::milli> LoadTime[3];
+		for(int i = 0; i < 3; i++) {
+			if(i == 1)
+				ClearTerrainCache(LevelName);
+
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			if(!LoadLevel(LevelName, nullptr))
+				return 1;
+			LoadTime[i] = std::chrono::high_resolution_clock::now() - StartTime;
+			CloseLevel();
+		}
+
+		printf("  %-12s cold=%8.2f ms warm=%8.2f ms x%.1f\n", LevelName, LoadTime[1].count(), LoadTime[2].count(), LoadTime[1].count() / LoadTime[2].count());
+	}
+
+	return 0;
+}
+
+// Remove baked terrain meshes for a level
+void _Benchmark::ClearTerrainCache(const std::string &LevelName) {
+	std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
+	irrFile->changeWorkingDirectoryTo(Save.CachePath.c_str());
+	irr::io::IFileList *FileList = irrFile->createFileList();
+	irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+
+	std::string Prefix = LevelName + "_";
+	for(uint32_t i = 0; i < FileList->getFileCount(); i++) {
+		std::string File = FileList->getFileName(i).c_str();
+		if(!FileList->isDirectory(i) && File.compare(0, Prefix.size(), Prefix) == 0 && File.find(".cache") != std::string::npos)
+			remove((Save.CachePath + File).c_str());
+	}
+	FileList->drop();
+}
+
+// Result of probing terrain at one point
+struct _TerrainProbe {
+	bool Hit;
+	float Height;
+	glm::vec3 Normal;
+	float Depth;
+	int Contacts;
+};
+
+// Cast a grid of rays down onto terrain and push spheres into each hit
+static void ProbeTerrain(dGeomID Terrain, const dReal *Bounds, std::vector<_TerrainProbe> &Probes, std::chrono::duration<double, std::micro> &SphereTime) {
+	dContactGeom Contacts[32];
+	dReal Length = Bounds[3] - Bounds[2] + 2.0;
+	dGeomID Ray = dCreateRay(0, Length);
+	dGeomID Sphere = dCreateSphere(0, BENCHMARK_TERRAIN_PROBE_RADIUS);
+
+	Probes.resize(BENCHMARK_TERRAIN_PROBES * BENCHMARK_TERRAIN_PROBES);
+	for(int j = 0; j < BENCHMARK_TERRAIN_PROBES; j++) {
+		for(int i = 0; i < BENCHMARK_TERRAIN_PROBES; i++) {
+			_TerrainProbe &Probe = Probes[j * BENCHMARK_TERRAIN_PROBES + i];
+			Probe.Hit = false;
+			Probe.Depth = 0.0f;
+			Probe.Contacts = 0;
+
+			// Cast ray down from above the terrain
+			dReal X = Bounds[0] + (Bounds[1] - Bounds[0]) * (i + BENCHMARK_TERRAIN_PROBE_OFFSET[0]) / BENCHMARK_TERRAIN_PROBES;
+			dReal Z = Bounds[4] + (Bounds[5] - Bounds[4]) * (j + BENCHMARK_TERRAIN_PROBE_OFFSET[1]) / BENCHMARK_TERRAIN_PROBES;
+			dGeomRaySet(Ray, X, Bounds[3] + 1.0, Z, 0, -1, 0);
+			int Count = dCollide(Ray, Terrain, 32, Contacts, sizeof(dContactGeom));
+			if(!Count)
+				continue;
+
+			// Use the nearest hit
+			int Nearest = 0;
+			for(int k = 1; k < Count; k++) {
+				if(Contacts[k].depth < Contacts[Nearest].depth)
+					Nearest = k;
+			}
+			const dContactGeom &Hit = Contacts[Nearest];
+			Probe.Hit = true;
+			Probe.Height = (float)Hit.pos[1];
+			Probe.Normal = glm::normalize(glm::vec3(Hit.normal[0], Hit.normal[1], Hit.normal[2]));
+			if(Probe.Normal.y < 0.0f)
+				Probe.Normal = -Probe.Normal;
+
+			// Push a sphere halfway into the surface
+			glm::vec3 Center = glm::vec3(Hit.pos[0], Hit.pos[1], Hit.pos[2]) + Probe.Normal * (BENCHMARK_TERRAIN_PROBE_RADIUS * 0.5f);
+			dGeomSetPosition(Sphere, Center.x, Center.y, Center.z);
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			Probe.Contacts = dCollide(Sphere, Terrain, 32, Contacts, sizeof(dContactGeom));
+			SphereTime += std::chrono::high_resolution_clock::now() - StartTime;
+			for(int k = 0; k < Probe.Contacts; k++)
+				Probe.Depth = std::max(Probe.Depth, (float)Contacts[k].depth);
+		}
+	}
+
+	dGeomDestroy(Sphere);
+	dGeomDestroy(Ray);
+}
+
+// Compare contacts, memory and step time of trimesh and heightfield terrain
+int _Benchmark::RunHeightField() {
+	const char *ModeNames[2] = { "trimesh", "heightfield" };
+	int Result = 0;
+
+	std::cout << "heightfield probes=" << BENCHMARK_TERRAIN_PROBES * BENCHMARK_TERRAIN_PROBES << " steps=" << BENCHMARK_PHYSICS_STEPS << std::endl;
+	for(const char *LevelName : BENCHMARK_TERRAIN_LEVELS) {
+		std::vector<_TerrainProbe> Probes[2];
+		dReal Bounds[6];
+		for(int Mode = 0; Mode < 2; Mode++) {
+			if(!LoadLevel(LevelName, nullptr, Mode))
+				return 1;
+
+			// Find terrain
+			_Terrain *Terrain = nullptr;
+			for(const auto &Object : ObjectManager.GetObjects()) {
+				if(Object->GetType() == _Object::TERRAIN)
+					Terrain = (_Terrain *)Object;
+			}
+			if(!Terrain || !Terrain->GetGeometry()) {
+				std::cout << "  " << LevelName << " has no terrain" << std::endl;
+				CloseLevel();
+				return 1;
+			}
+
+			// Probe the area covered by the trimesh
+			if(Mode == 0)
+				dGeomGetAABB(Terrain->GetGeometry(), Bounds);
+			std::chrono::duration<double, std::micro> SphereTime(0);
+			ProbeTerrain(Terrain->GetGeometry(), Bounds, Probes[Mode], SphereTime);
+			size_t CollisionSize = Terrain->GetCollisionSize();
+
+			// Step the level
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCHMARK_PHYSICS_STEPS; i++)
+				StepLevel();
+			std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+			CloseLevel();
+
+			printf("  %-12s %-11s memory=%8.1f KiB sphere=%6.2f us %8.0f steps/s\n",
+				LevelName,
+				ModeNames[Mode],
+				CollisionSize / 1024.0,
+				SphereTime.count() / Probes[Mode].size(),
+				BENCHMARK_PHYSICS_STEPS / Elapsed.count());
+		}
+
+		// Compare probes
+		int Hits = 0, Mismatched = 0, SphereMisses = 0;
+		double HeightError = 0.0, MaxHeightError = 0.0, NormalError = 0.0, MaxNormalError = 0.0, MaxDepthError = 0.0;
+		for(size_t i = 0; i < Probes[0].size(); i++) {
+			const _TerrainProbe &Mesh = Probes[0][i];
+			const _TerrainProbe &Field = Probes[1][i];
+			if(Mesh.Hit != Field.Hit) {
+				Mismatched++;
+				continue;
+			}
+			if(!Mesh.Hit)
+				continue;
+
+			double Error = std::abs(Mesh.Height - Field.Height);
+			double Angle = std::acos(std::min(1.0f, glm::dot(Mesh.Normal, Field.Normal))) * irr::core::RADTODEG64;
+			HeightError += Error;
+			NormalError += Angle;
+			MaxHeightError = std::max(MaxHeightError, Error);
+			MaxNormalError = std::max(MaxNormalError, Angle);
+			Hits++;
+
+			// Compare sphere depths when both generate contacts
+			if(!Mesh.Contacts != !Field.Contacts)
+				SphereMisses++;
+			else
+				MaxDepthError = std::max(MaxDepthError, (double)std::abs(Mesh.Depth - Field.Depth));
+		}
+
+		// Both modes must describe the same surface
+		bool Match = !Mismatched && !SphereMisses
+			&& MaxHeightError <= BENCHMARK_HEIGHTFIELD_MAX_HEIGHT_ERROR
+			&& MaxNormalError <= BENCHMARK_HEIGHTFIELD_MAX_NORMAL_ERROR
+			&& MaxDepthError <= BENCHMARK_HEIGHTFIELD_MAX_DEPTH_ERROR;
+		if(!Match)
+			Result = 1;
+
+		if(!Hits)
+			Hits = 1;
+		printf("  %-12s rays mismatched=%d height error=%.5f/%.5f normal error=%.3f/%.3f deg spheres mismatched=%d depth error max=%.5f %s\n",
+			LevelName,
+			Mismatched,
+			HeightError / Hits,
+			MaxHeightError,
+			NormalError / Hits,
+			MaxNormalError,
+			SphereMisses,
+			MaxDepthError,
+			Match ? "match" : "MISMATCH");
+	}
+
+	return Result;
+}
+
+// Object with only a name and ID
+class _BenchmarkObject : public _Object {
+
+	public:
+
+		_BenchmarkObject(const std::string &ObjectName) : _Object(nullptr) { Name = ObjectName; }
+
+};
+
+// Compare scanning the object list against the lookup indexes
+void _Benchmark::RunObjects() {
+	ObjectManager.ClearObjects();
+	for(int i = 0; i < BENCHMARK_OBJECTS; i++)
+		ObjectManager.AddObject(new _BenchmarkObject("object" + std::to_string(i)));
+
+	// Pick objects to find
+	std::vector<std::string> Names(BENCHMARK_OBJECT_LOOKUPS);
+	std::vector<int> IDs(BENCHMARK_OBJECT_LOOKUPS);
+	uint32_t Random = 1;
+	for(int i = 0; i < BENCHMARK_OBJECT_LOOKUPS; i++) {
+		Random = Random * 1664525 + 1013904223;
+		IDs[i] = Random % BENCHMARK_OBJECTS;
+		Names[i] = "object" + std::to_string(IDs[i]);
+	}
+
+	std::cout << "objects count=" << BENCHMARK_OBJECTS << " lookups=" << BENCHMARK_OBJECT_LOOKUPS << std::endl;
+	for(int Lookup = 0; Lookup < 2; Lookup++) {
+		std::chrono::duration<double, std::nano> ScanTime(0), IndexTime(0);
+		size_t Found = 0;
+		for(int Indexed = 0; Indexed < 2; Indexed++) {
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCHMARK_OBJECT_LOOKUPS; i++) {
+				_Object *Object = nullptr;
+				if(Indexed)
+					Object = Lookup ? ObjectManager.GetObjectByID(IDs[i]) : ObjectManager.GetObjectByName(Names[i]);
+				else {
+					for(auto &Iterator : ObjectManager.GetObjects()) {
+						if(Lookup ? Iterator->GetID() == IDs[i] : Iterator->GetName() == Names[i]) {
+							Object = Iterator;
+							break;
+						}
+					}
+				}
+				Found += Object != nullptr;
+			}
+
+			auto Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+			if(Indexed)
+				IndexTime = Elapsed;
+			else
+				ScanTime = Elapsed;
+		}
+
+		printf("  %-4s scan=%10.1f ns index=%6.1f ns x%.0f found=%zu\n",
+			Lookup ? "id" : "name",
+			ScanTime.count() / BENCHMARK_OBJECT_LOOKUPS,
+			IndexTime.count() / BENCHMARK_OBJECT_LOOKUPS,
+			ScanTime.count() / IndexTime.count(),
+			Found);
+	}
+
+	ObjectManager.ClearObjects();
+}
+
+// Measure level reset time and allocations with and without object arenas
+int _Benchmark::RunReset() {
+	const char *ModeNames[2] = { "new", "arena" };
+	int Result = 0;
+
+	std::cout << "reset resets=" << BENCHMARK_RESETS << std::endl;
+	for(const char *LevelName : BENCHMARK_RESET_LEVELS) {
+		for(int Pooled = 0; Pooled < 2 && !Result; Pooled++) {
+
+			// Arenas can only be toggled while no objects exist
+			ObjectManager.ClearObjects();
+			ObjectArenas.SetEnabled(Pooled);
+			if(!LoadLevel(LevelName, nullptr)) {
+				Result = 1;
+				break;
+			}
+
+			// Reset the level the same way the play state does
+			std::chrono::duration<double, std::micro> ResetTime(0);
+			uint64_t Allocations = 0;
+			uint64_t SystemAllocations = 0;
+			for(int i = 0; i < BENCHMARK_RESETS; i++) {
+				for(int j = 0; j < BENCHMARK_RESET_STEPS; j++)
+					StepLevel();
+
+				_ArenaStats Stats = ObjectArenas.GetStats();
+				auto StartTime = std::chrono::high_resolution_clock::now();
+				ObjectManager.ClearObjects();
+				Physics.Reset();
+				Level.SpawnEntities();
+				Level.RunScripts();
+				ResetTime += std::chrono::high_resolution_clock::now() - StartTime;
+				Allocations += ObjectArenas.GetStats().Allocations - Stats.Allocations;
+				SystemAllocations += ObjectArenas.GetStats().SystemAllocations - Stats.SystemAllocations;
+			}
+
+			size_t ObjectCount = ObjectManager.GetObjectCount();
+			CloseLevel();
+
+			printf("  %-12s %-5s objects=%-4zu reset=%8.1f us objects/reset=%6.1f system allocations/reset=%6.1f\n",
+				LevelName,
+				ModeNames[Pooled],
+				ObjectCount,
+				ResetTime.count() / BENCHMARK_RESETS,
+				(double)Allocations / BENCHMARK_RESETS,
+				(double)SystemAllocations / BENCHMARK_RESETS);
+		}
+	}
+	ObjectArenas.SetEnabled(true);
+
+	return Result;
+}
+
+// Compare per-object interpolation against the packed transform buffer
+int _Benchmark::RunTransforms() {
+	if(!LoadLevel("bench_stack", nullptr))
+		return 1;
+
+	// Drop spinning boxes above the towers
+	_TransformBuffer &Transforms = ObjectManager.GetTransforms();
+	_ObjectSpawn Spawn;
+	Spawn.Template = Level.GetTemplate("box");
+	uint32_t Random = 1;
+	for(int i = 0; (int)Transforms.GetCount() < BENCHMARK_TRANSFORM_OBJECTS; i++) {
+		Spawn.Name = "box" + std::to_string(i);
+		Spawn.Position = glm::vec3((i % 16) * 2.0f - 16.0f, 30.0f + (i / 256) * 2.0f, ((i / 16) % 16) * 2.0f);
+		for(int j = 0; j < 3; j++) {
+			Random = Random * 1664525 + 1013904223;
+			Spawn.Rotation[j] = (Random >> 8) % 360;
+			Spawn.AngularVelocity[j] = ((Random >> 8) % 1000) / 100.0f - 5.0f;
+		}
+		Level.CreateObject(Spawn);
+	}
+
+	// Objects the old path interpolated, with their last orientation
+	std::vector<_Object *> Objects;
+	for(auto &Object : ObjectManager.GetObjects()) {
+		if(Object->GetNode() && Object->GetBody())
+			Objects.push_back(Object);
+	}
+	std::vector<glm::vec3> LastPositions(Objects.size());
+	std::vector<glm::quat> LastRotations(Objects.size());
+
+	std::chrono::duration<double, std::micro> OldSnapshotTime(0), OldInterpolateTime(0);
+	std::chrono::duration<double, std::micro> BeginTime(0), GatherTime(0), InterpolateTime(0), ScatterTime(0);
+	double MaxPositionError = 0.0, MaxRotationError = 0.0;
+	for(int Step = 0; Step < BENCHMARK_TRANSFORM_STEPS; Step++) {
+
+		// Snapshot one object at a time
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		for(size_t i = 0; i < Objects.size(); i++) {
+			LastPositions[i] = Objects[i]->GetPosition();
+			LastRotations[i] = Objects[i]->GetQuaternion();
+		}
+		OldSnapshotTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		Transforms.BeginStep();
+		BeginTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+		Physics.Update(PHYSICS_TIMESTEP);
+		ObjectManager.Update(PHYSICS_TIMESTEP);
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		Transforms.EndStep();
+		GatherTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+		for(int Frame = 0; Frame < BENCHMARK_TRANSFORM_FRAMES; Frame++) {
+			float BlendFactor = (Frame + 0.5f) / BENCHMARK_TRANSFORM_FRAMES;
+
+			// Read bodies and blend one object at a time
+			std::vector<glm::vec3> OldPositions(Objects.size());
+			std::vector<glm::quat> OldRotations(Objects.size());
+			StartTime = std::chrono::high_resolution_clock::now();
+			for(size_t i = 0; i < Objects.size(); i++) {
+				glm::vec3 Position = Objects[i]->GetPosition() * BlendFactor + LastPositions[i] * (1.0f - BlendFactor);
+				glm::quat Rotation = glm::mix(LastRotations[i], Objects[i]->GetQuaternion(), BlendFactor);
+				glm::vec3 EulerRotation = Physics.QuaternionToEuler(Rotation);
+				Objects[i]->GetNode()->setPosition(irr::core::vector3df(Position[0], Position[1], Position[2]));
+				Objects[i]->GetNode()->setRotation(irr::core::vector3df(EulerRotation[0], EulerRotation[1], EulerRotation[2]));
+				OldPositions[i] = Position;
+				OldRotations[i] = Rotation;
+			}
+			OldInterpolateTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+			// Blend the packed arrays, then write nodes
+			StartTime = std::chrono::high_resolution_clock::now();
+			Transforms.Interpolate(BlendFactor);
+			InterpolateTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			Transforms.Scatter();
+			ScatterTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+			// Compare results of objects that are still awake
+			for(size_t i = 0; i < Objects.size(); i++) {
+				int Index = Objects[i]->GetTransformIndex();
+				if(Index >= (int)Transforms.GetActiveCount())
+					continue;
+
+				glm::quat Rotation(
+					Transforms.GetDraw(_TransformBuffer::ROTATION_W)[Index],
+					Transforms.GetDraw(_TransformBuffer::ROTATION_X)[Index],
+					Transforms.GetDraw(_TransformBuffer::ROTATION_Y)[Index],
+					Transforms.GetDraw(_TransformBuffer::ROTATION_Z)[Index]
+				);
+				double Dot = std::min(1.0f, std::abs(glm::dot(Rotation, glm::normalize(OldRotations[i]))));
+				MaxPositionError = std::max(MaxPositionError, (double)glm::length(Objects[i]->GetDrawPosition() - OldPositions[i]));
+				MaxRotationError = std::max(MaxRotationError, 2.0 * std::acos(Dot) * irr::core::RADTODEG64);
+			}
+		}
+
+		ObjectManager.EndFrame();
+	}
+
+	double Steps = BENCHMARK_TRANSFORM_STEPS;
+	double Frames = BENCHMARK_TRANSFORM_STEPS * BENCHMARK_TRANSFORM_FRAMES;
+	std::cout << "transforms objects=" << Objects.size() << " steps=" << BENCHMARK_TRANSFORM_STEPS << " frames=" << (int)Frames << std::endl;
+	printf("  per object  snapshot=%7.1f us interpolate=%7.1f us\n", OldSnapshotTime.count() / Steps, OldInterpolateTime.count() / Frames);
+	printf("  packed      snapshot=%7.1f us gather=%7.1f us interpolate=%7.1f us scatter=%7.1f us\n",
+		BeginTime.count() / Steps,
+		GatherTime.count() / Steps,
+		InterpolateTime.count() / Frames,
+		ScatterTime.count() / Frames);
+	printf("  max error   position=%.6f rotation=%.4f deg\n", MaxPositionError, MaxRotationError);
+
+	CloseLevel();
+
+	return 0;
+}
+
+// Measure render sync cost as objects settle and fall asleep
+int _Benchmark::RunSleep() {
+	std::cout << "sleep steps=" << BENCHMARK_SLEEP_STEPS << " window=" << BENCHMARK_SLEEP_WINDOW << std::endl;
+	for(const char *LevelName : BENCHMARK_SLEEP_LEVELS) {
+		if(!LoadLevel(LevelName, nullptr))
+			return 1;
+
+		// Time frame sync outside the physics step, the median keeps preemption spikes out of sub-microsecond times
+		std::vector<double> SyncTimes[2];
+		double ActiveCount[2] = { 0.0, 0.0 };
+		for(int i = 0; i < BENCHMARK_SLEEP_STEPS; i++) {
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			ObjectManager.BeginFrame();
+			auto Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+
+			Physics.Update(PHYSICS_TIMESTEP);
+			ObjectManager.Update(PHYSICS_TIMESTEP);
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			ObjectManager.EndFrame();
+			ObjectManager.InterpolateOrientations(0.5f);
+			Elapsed += std::chrono::high_resolution_clock::now() - StartTime;
+
+			int Window = -1;
+			if(i < BENCHMARK_SLEEP_WINDOW)
+				Window = 0;
+			else if(i >= BENCHMARK_SLEEP_STEPS - BENCHMARK_SLEEP_WINDOW)
+				Window = 1;
+
+			if(Window != -1) {
+				SyncTimes[Window].push_back(std::chrono::duration<double, std::micro>(Elapsed).count());
+				ActiveCount[Window] += ObjectManager.GetActiveCount();
+			}
+		}
+
+		double SyncTime[2];
+		for(int i = 0; i < 2; i++) {
+			std::vector<double> &Times = SyncTimes[i];
+			std::nth_element(Times.begin(), Times.begin() + Times.size() / 2, Times.end());
+			SyncTime[i] = Times[Times.size() / 2];
+		}
+
+		printf("  %-12s objects=%-4zu start active=%6.1f sync=%7.2f us end active=%6.1f sync=%7.2f us\n",
+			LevelName,
+			ObjectManager.GetObjectCount(),
+			ActiveCount[0] / BENCHMARK_SLEEP_WINDOW,
+			SyncTime[0],
+			ActiveCount[1] / BENCHMARK_SLEEP_WINDOW,
+			SyncTime[1]);
+
+		CloseLevel();
+	}
+
+	return 0;
+}
+
+// Measure collision handler dispatch on a level full of colliding objects with callbacks
+int _Benchmark::RunCallbacks() {
+	std::cout << "callbacks steps=" << BENCHMARK_CALLBACK_STEPS << " calls=" << BENCHMARK_CALLBACK_CALLS << std::endl;
+	for(int Batched = 0; Batched < 2; Batched++) {
+		if(!LoadLevel("bench_callback", nullptr))
+			return 1;
+
+		// Handle every event in one call
+		if(Batched)
+			Scripting.RunString("function OnCollisions(List) for i = 1, #List do if List[i].Contacts > 0 then Hits = Hits + 1 end end end");
+
+		// Run the level
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		for(int i = 0; i < BENCHMARK_CALLBACK_STEPS; i++)
+			StepLevel();
+		std::chrono::duration<double, std::micro> StepTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+		// Get handler call count
+		lua_State *State = Scripting.GetState();
+		lua_getglobal(State, "Hits");
+		double Hits = (double)lua_tointeger(State, -1);
+		lua_pop(State, 1);
+
+		printf("  %-12s objects=%-4zu events/step=%6.1f step=%7.1f us\n",
+			Batched ? "OnCollisions" : "OnHitBall",
+			ObjectManager.GetObjectCount(),
+			Hits / BENCHMARK_CALLBACK_STEPS,
+			StepTime.count() / BENCHMARK_CALLBACK_STEPS);
+
+		if(Batched) {
+			CloseLevel();
+			break;
+		}
+
+		// Compare looking up handlers by name against cached references
+		const char *Names[2] = { "OnHitBall", "OnHitPlayer" };
+		for(int Missing = 0; Missing < 2; Missing++) {
+			const char *Name = Names[Missing];
+			int Callback = Scripting.GetCallback(Name);
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCHMARK_CALLBACK_CALLS; i++) {
+				lua_getglobal(State, Name);
+				if(!lua_isfunction(State, -1)) {
+					lua_pop(State, 1);
+					continue;
+				}
+
+				lua_pushlightuserdata(State, nullptr);
+				lua_pushlightuserdata(State, nullptr);
+				lua_call(State, 2, 0);
+			}
+			std::chrono::duration<double, std::nano> NameTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCHMARK_CALLBACK_CALLS; i++)
+				Scripting.CallCollisionHandler(Callback, nullptr, nullptr);
+			std::chrono::duration<double, std::nano> ReferenceTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+			printf("  %-12s name=%6.1f ns reference=%6.1f ns x%.1f\n",
+				Name,
+				NameTime.count() / BENCHMARK_CALLBACK_CALLS,
+				ReferenceTime.count() / BENCHMARK_CALLBACK_CALLS,
+				NameTime.count() / ReferenceTime.count());
+		}
+
+		CloseLevel();
+	}
+
+	return 0;
+}
+
+// Compare a sorted list of timers against the scheduler's heap
+int _Benchmark::RunTimers() {
+	std::cout << "timers range=" << BENCHMARK_TIMER_RANGE << "s" << std::endl;
+	for(int Count : BENCHMARK_TIMER_COUNTS) {
+
+		// Timestamps on the physics step grid so many timers share a timestamp
+		std::vector<float> Timestamps(Count);
+		uint32_t Random = 1;
+		for(int i = 0; i < Count; i++) {
+			Random = Random * 1664525 + 1013904223;
+			Timestamps[i] = ((Random >> 8) % (int)(BENCHMARK_TIMER_RANGE / PHYSICS_TIMESTEP)) * PHYSICS_TIMESTEP;
+		}
+
+		// Insert into a sorted list, after timers with the same timestamp
+		std::list<_ScheduledEvent> List;
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		for(int i = 0; i < Count; i++) {
+			_ScheduledEvent Event;
+			Event.Timestamp = Timestamps[i];
+			Event.Callback = i;
+
+			auto Iterator = List.begin();
+			for(; Iterator != List.end(); ++Iterator) {
+				if(Event.Timestamp < Iterator->Timestamp)
+					break;
+			}
+			List.insert(Iterator, Event);
+		}
+		std::chrono::duration<double, std::nano> ListAddTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+		_Scheduler Scheduler;
+		StartTime = std::chrono::high_resolution_clock::now();
+		for(int i = 0; i < Count; i++)
+			Scheduler.Add(i, Timestamps[i]);
+		std::chrono::duration<double, std::nano> HeapAddTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+		// Fire timers step by step and check both fire in the same order
+		std::vector<int> ListOrder, HeapOrder;
+		std::chrono::duration<double, std::nano> ListUpdateTime(0), HeapUpdateTime(0);
+		for(float Time = 0.0f; Time <= BENCHMARK_TIMER_RANGE; Time += PHYSICS_TIMESTEP) {
+			StartTime = std::chrono::high_resolution_clock::now();
+			while(!List.empty() && Time >= List.front().Timestamp) {
+				ListOrder.push_back(List.front().Callback);
+				List.pop_front();
+			}
+			ListUpdateTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+			StartTime = std::chrono::high_resolution_clock::now();
+			int Callback;
+			while(Scheduler.GetNext(Time, Callback))
+				HeapOrder.push_back(Callback);
+			HeapUpdateTime += std::chrono::high_resolution_clock::now() - StartTime;
+		}
+
+		printf("  count=%-6d add list=%8.1f ns heap=%6.1f ns fire list=%6.1f ns heap=%6.1f ns order=%s\n",
+			Count,
+			ListAddTime.count() / Count,
+			HeapAddTime.count() / Count,
+			ListUpdateTime.count() / Count,
+			HeapUpdateTime.count() / Count,
+			ListOrder == HeapOrder && (int)HeapOrder.size() == Count ? "same" : "different");
+	}
+
+	return 0;
+}
+
+// Compare decoding whole sounds into one buffer against the audio system's loader
+int _Benchmark::RunAudio() {
+	if(!Audio.IsEnabled())
+		Audio.Init(true);
+	if(!Audio.IsEnabled()) {
+		std::cout << "Audio device unavailable" << std::endl;
+		return 1;
+	}
+
+	std::cout << "audio loads=" << BENCHMARK_AUDIO_LOADS << " threshold=" << AUDIO_STREAM_THRESHOLD / 1024 << "KB ring=" << _AudioStream::GetResidentSize() / 1024 << "KB" << std::endl;
+	for(const char *File : BENCHMARK_AUDIO_FILES) {
+		std::string Path = std::string("sounds/") + File;
+
+		// Decode the whole file through a growing vector and upload it
+		std::chrono::duration<double, std::milli> WholeTime(0);
+		size_t WholeSize = 0;
+		for(int i = 0; i < BENCHMARK_AUDIO_LOADS; i++) {
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			OggVorbis_File VorbisStream;
+			if(ov_fopen(Path.c_str(), &VorbisStream) != 0) {
+				std::cout << "Could not open " << Path << std::endl;
+				return 1;
+			}
+			vorbis_info *Info = ov_info(&VorbisStream, -1);
+
+			std::vector<char> Data;
+			long BytesRead;
+			char Buffer[4096];
+			int BitStream;
+			do {
+				BytesRead = ov_read(&VorbisStream, Buffer, 4096, 0, 2, 1, &BitStream);
+				if(BytesRead > 0)
+					Data.insert(Data.end(), Buffer, Buffer + BytesRead);
+			} while(BytesRead > 0);
+
+			ALuint ID;
+			alGenBuffers(1, &ID);
+			alBufferData(ID, Info->channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16, &Data[0], (ALsizei)Data.size(), (ALsizei)Info->rate);
+			ov_clear(&VorbisStream);
+			WholeTime += std::chrono::high_resolution_clock::now() - StartTime;
+
+			alDeleteBuffers(1, &ID);
+			WholeSize = Data.size();
+		}
+
+		// Load through the audio system, which streams long sounds
+		std::chrono::duration<double, std::milli> LoadTime(0);
+		for(int i = 0; i < BENCHMARK_AUDIO_LOADS; i++) {
+			Audio.CloseBuffer(File);
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			if(!Audio.LoadBuffer(File))
+				return 1;
+			LoadTime += std::chrono::high_resolution_clock::now() - StartTime;
+		}
+
+		const _AudioBuffer *Buffer = Audio.GetBuffer(File);
+		size_t Resident = Buffer->Streamed ? _AudioStream::GetResidentSize() : Buffer->Size;
+
+		printf("  %-12s pcm=%7.1f KB before load=%7.2f ms resident=%7.1f KB after load=%7.2f ms resident=%7.1f KB %s\n",
+			File,
+			WholeSize / 1024.0,
+			WholeTime.count() / BENCHMARK_AUDIO_LOADS,
+			WholeSize / 1024.0,
+			LoadTime.count() / BENCHMARK_AUDIO_LOADS,
+			Resident / 1024.0,
+			Buffer->Streamed ? "streamed" : "loaded");
+	}
+
+	return 0;
+}
+
+// Spam short sounds through a source per sound and through the voice pool
+int _Benchmark::RunVoices() {
+	if(!Audio.IsEnabled())
+		Audio.Init(true);
+	if(!Audio.IsEnabled()) {
+		std::cout << "Audio device unavailable" << std::endl;
+		return 1;
+	}
+
+	const char *File = "pop.ogg";
+	if(!Audio.LoadBuffer(File))
+		return 1;
+	const _AudioBuffer *Buffer = Audio.GetBuffer(File);
+	int Count = BENCHMARK_VOICE_FRAMES * BENCHMARK_VOICE_BURST;
+
+	// Create a source for each sound and delete it when it finishes
+	std::list<_AudioSource *> Sources;
+	size_t PeakSources = 0;
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < BENCHMARK_VOICE_FRAMES; i++) {
+		for(int j = 0; j < BENCHMARK_VOICE_BURST; j++) {
+			_AudioSource *Source = new _AudioSource(Buffer, false, 0.0f, 0.5f, 1.0f, 2.0f);
+			Source->SetPosition((float)j, 0.0f, (float)i);
+			Source->Play();
+			Sources.push_back(Source);
+		}
+		PeakSources = std::max(PeakSources, Sources.size());
+
+		for(auto Iterator = Sources.begin(); Iterator != Sources.end(); ) {
+			if(!(*Iterator)->IsPlaying()) {
+				delete *Iterator;
+				Iterator = Sources.erase(Iterator);
+			}
+			else
+				++Iterator;
+		}
+	}
+	std::chrono::duration<double, std::micro> SourceTime = std::chrono::high_resolution_clock::now() - StartTime;
+	for(auto &Source : Sources)
+		delete Source;
+
+	// Play through the pool
+	int Dropped = 0;
+	StartTime = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < BENCHMARK_VOICE_FRAMES; i++) {
+		for(int j = 0; j < BENCHMARK_VOICE_BURST; j++) {
+			if(!Audio.Play(Buffer, (float)j, 0.0f, (float)i, false, 0.0f, 0.5f, 1.0f, 2.0f))
+				Dropped++;
+		}
+		Audio.Update();
+	}
+	std::chrono::duration<double, std::micro> PoolTime = std::chrono::high_resolution_clock::now() - StartTime;
+	Audio.StopSounds();
+
+	// Update with nothing playing
+	StartTime = std::chrono::high_resolution_clock::now();
+	for(int i = 0; i < BENCHMARK_VOICE_FRAMES; i++)
+		Audio.Update();
+	std::chrono::duration<double, std::nano> IdleTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+	std::cout << "voices sounds=" << Count << " frames=" << BENCHMARK_VOICE_FRAMES << " pool=" << Audio.GetVoiceCount() << std::endl;
+	printf("  per source %8.2f us/sound peak sources=%d\n", SourceTime.count() / Count, (int)PeakSources);
+	printf("  pool       %8.2f us/sound dropped=%d\n", PoolTime.count() / Count, Dropped);
+	printf("  idle update %7.1f ns/frame\n", IdleTime.count() / BENCHMARK_VOICE_FRAMES);
+
+	return 0;
+}
+
+// Get the peak resident set size of the process in kilobytes
+static long GetPeakRSS() {
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage Usage;
+	if(getrusage(RUSAGE_SELF, &Usage) != 0)
+		return 0;
+
+	return Usage.ru_maxrss;
+#endif
+}
+
+// Get the current resident set size of the process in kilobytes, 0 where /proc isn't available
+static long GetCurrentRSS() {
+#ifdef _WIN32
+	return 0;
+#else
+	FILE *File = fopen("/proc/self/statm", "r");
+	if(!File)
+		return 0;
+
+	long Size = 0, Resident = 0;
+	if(fscanf(File, "%ld %ld", &Size, &Resident) != 2)
+		Resident = 0;
+	fclose(File);
+
+	return Resident * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+}
+
+// Get the value below which a fraction of the sorted samples fall
+static double GetPercentile(const std::vector<double> &Sorted, double Fraction) {
+	if(Sorted.empty())
+		return 0.0;
+
+	size_t Index = (size_t)(Fraction * (Sorted.size() - 1) + 0.5);
+	return Sorted[std::min(Index, Sorted.size() - 1)];
+}
+
+// Build a deterministic input stream that rolls in random directions and jumps
+static void SynthesizeInputs(int Steps, std::vector<_BenchmarkInput> &Inputs) {
+	static const float Directions[9][2] = { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, 0 } };
+	int StepsPerChange = std::max(1, (int)(BENCHMARK_LEVEL_INPUT_INTERVAL / PHYSICS_TIMESTEP + 0.5f));
+	uint32_t Seed = 1;
+	_BenchmarkInput Event = { 0.0f, { 0.0f, 0.0f, 0.0f, 30.0f, false } };
+
+	Inputs.clear();
+	Inputs.reserve(Steps);
+	for(int i = 0; i < Steps; i++) {
+		Event.Time = (i + 1) * PHYSICS_TIMESTEP;
+		Event.Input.Jumped = false;
+
+		// Pick a new direction and camera angle
+		if(i % StepsPerChange == 0) {
+			Seed = Seed * 1103515245 + 12345;
+			uint32_t Random = Seed >> 16;
+			const float *Direction = Directions[Random % 9];
+			float Length = std::sqrt(Direction[0] * Direction[0] + Direction[1] * Direction[1]);
+			Event.Input.PushX = Length > 0.0f ? Direction[0] / Length : 0.0f;
+			Event.Input.PushZ = Length > 0.0f ? Direction[1] / Length : 0.0f;
+			Event.Input.Yaw += (float)((Random >> 4) % 91) - 45.0f;
+			Event.Input.Jumped = (Random >> 11) % BENCHMARK_LEVEL_JUMP_CHANCE == 0;
+		}
+
+		Inputs.push_back(Event);
+	}
+}
+
+// Read the recorded input events from a replay
+static bool LoadReplayInputs(const std::string &Path, std::vector<_BenchmarkInput> &Inputs) {
+	_Replay InputReplay;
+	if(!InputReplay.LoadReplay(Path))
+		return false;
+
+	Inputs.clear();
+	_ReplayEventView Event;
+	InputReplay.ReadEvent(Event);
+	while(!InputReplay.ReplayStopped()) {
+		if(Event.Type == _Replay::PACKET_INPUT) {
+			_BenchmarkInput Input;
+			Input.Time = Event.Timestamp;
+			Event.GetInput(Input.Input);
+			Inputs.push_back(Input);
+		}
+
+		InputReplay.ReadEvent(Event);
+	}
+
+	return true;
+}
+
+// Get the file names in a directory relative to the working path
+static void GetDirectoryList(const std::string &Path, bool Directories, std::vector<std::string> &Files) {
+	std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
+	if(!irrFile->changeWorkingDirectoryTo(Path.c_str()))
+		return;
+
+	irr::io::IFileList *FileList = irrFile->createFileList();
+	irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+
+	for(uint32_t i = 0; i < FileList->getFileCount(); i++) {
+		std::string File = FileList->getFileName(i).c_str();
+		if(FileList->isDirectory(i) == Directories && File != "." && File != "..")
+			Files.push_back(File);
+	}
+	FileList->drop();
+
+	std::sort(Files.begin(), Files.end());
+}
+
+// Load every level and simulate it with recorded input, results are written as JSON
+int _Benchmark::RunLevels() {
+	int Steps = std::max(1, (int)(LevelTime / PHYSICS_TIMESTEP + 0.5f));
+	int Result = 0;
+
+	// Find a replay for each level
+	std::map<std::string, std::string> LevelReplays;
+	if(LevelReplayPath != "") {
+		std::vector<std::string> Files;
+		GetDirectoryList(LevelReplayPath, false, Files);
+		for(const auto &File : Files) {
+			if(File.find(".replay") == std::string::npos)
+				continue;
+
+			_Replay HeaderReplay;
+			std::string Path = LevelReplayPath + "/" + File;
+			if(HeaderReplay.LoadReplay(Path, true) && !LevelReplays.count(HeaderReplay.GetLevelName()))
+				LevelReplays[HeaderReplay.GetLevelName()] = Path;
+		}
+	}
+
+	// Get levels
+	std::vector<std::string> LevelNames;
+	GetDirectoryList(Framework.GetWorkingPath() + "levels", true, LevelNames);
+
+	std::vector<_BenchmarkInput> SynthesizedInputs;
+	SynthesizeInputs(Steps, SynthesizedInputs);
+
+	std::cout << "levels count=" << LevelNames.size() << " steps=" << Steps << " replays=" << LevelReplays.size() << std::endl;
+	std::vector<_LevelResult> Results;
+	std::vector<double> StepTimes;
+	StepTimes.reserve(Steps);
+	for(const auto &LevelName : LevelNames) {
+		_LevelResult LevelResult;
+		LevelResult.Name = LevelName;
+		LevelResult.Objects = 0;
+		LevelResult.Steps = 0;
+		LevelResult.Ended = false;
+		LevelResult.LoadTime = LevelResult.StepsPerSecond = 0.0;
+		LevelResult.P50 = LevelResult.P99 = LevelResult.MaxStep = 0.0;
+
+		// Give memory freed by the last level back to the system so the baseline only holds what levels share
+#ifdef __GLIBC__
+		malloc_trim(0);
+#endif
+		LevelResult.BaseRSS = GetCurrentRSS();
+		LevelResult.LevelRSS = 0;
+
+		// Get input stream
+		std::vector<_BenchmarkInput> ReplayInputs;
+		const std::vector<_BenchmarkInput> *Inputs = &SynthesizedInputs;
+		LevelResult.Input = "synthesized";
+		auto ReplayIterator = LevelReplays.find(LevelName);
+		if(ReplayIterator != LevelReplays.end() && LoadReplayInputs(ReplayIterator->second, ReplayInputs)) {
+			Inputs = &ReplayInputs;
+			LevelResult.Input = ReplayIterator->second;
+		}
+
+		PlayState.SetTimer(0.0f);
+
+		// Load level
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		if(!LoadLevel(LevelName, nullptr)) {
+			LevelResult.Error = "load failed";
+			Results.push_back(LevelResult);
+			Level.Close();
+			Result = 1;
+			continue;
+		}
+		std::chrono::duration<double, std::milli> LoadTime = std::chrono::high_resolution_clock::now() - StartTime;
+		LevelResult.LoadTime = LoadTime.count();
+		long LevelPeakRSS = GetCurrentRSS();
+
+		// Attach a camera to the player for push directions
+		_Camera *Camera = new _Camera();
+		_Player *Player = static_cast<_Player *>(ObjectManager.GetObjectByType(_Object::PLAYER));
+		if(Player)
+			Player->SetCamera(Camera);
+
+		// Step the level the same way as the play state
+		StepTimes.clear();
+		Physics.ResetCollisionStats();
+		size_t NextInput = 0;
+		float Timer = 0.0f;
+		for(int i = 0; i < Steps; i++) {
+			auto StepStart = std::chrono::high_resolution_clock::now();
+			Timer += PHYSICS_TIMESTEP;
+			PlayState.SetTimer(Timer);
+			ObjectManager.BeginFrame();
+
+			// Apply input
+			for(; NextInput < Inputs->size() && Timer >= (*Inputs)[NextInput].Time; NextInput++) {
+				const _ReplayInputEvent &Input = (*Inputs)[NextInput].Input;
+				if(!Player)
+					continue;
+
+				irr::core::vector3df Push(Input.PushX, 0.0f, Input.PushZ);
+				Camera->SetYaw(Input.Yaw);
+				Camera->SetPitch(Input.Pitch);
+				Player->HandlePush(Push);
+				if(Input.Jumped)
+					Player->Jump();
+			}
+
+			Physics.Update(PHYSICS_TIMESTEP);
+			ObjectManager.Update(PHYSICS_TIMESTEP);
+			Scripting.UpdateTimedCallbacks();
+			ObjectManager.EndFrame();
+
+			std::chrono::duration<double, std::micro> StepTime = std::chrono::high_resolution_clock::now() - StepStart;
+			StepTimes.push_back(StepTime.count());
+
+			// Sample memory outside the timed step
+			if(i % BENCHMARK_LEVEL_RSS_INTERVAL == 0)
+				LevelPeakRSS = std::max(LevelPeakRSS, GetCurrentRSS());
+
+			// Stop when the level is won or lost, like the play state does
+			if(LevelEnded)
+				break;
+		}
+		LevelResult.Ended = LevelEnded;
+
+		// Get stats
+		double Total = 0.0;
+		for(double Time : StepTimes)
+			Total += Time;
+		std::sort(StepTimes.begin(), StepTimes.end());
+		LevelResult.Steps = (int)StepTimes.size();
+		LevelResult.StepsPerSecond = Total > 0.0 ? LevelResult.Steps / (Total / 1000000.0) : 0.0;
+		LevelResult.P50 = GetPercentile(StepTimes, 0.50);
+		LevelResult.P99 = GetPercentile(StepTimes, 0.99);
+		LevelResult.MaxStep = StepTimes.back();
+		LevelResult.Collisions = Physics.GetCollisionStats();
+		HashBodies(LevelResult.Objects);
+		LevelPeakRSS = std::max(LevelPeakRSS, GetCurrentRSS());
+		LevelResult.LevelRSS = std::max(0L, LevelPeakRSS - LevelResult.BaseRSS);
+
+		// The camera node must be removed before the scene is cleared
+		delete Camera;
+		CloseLevel();
+		Results.push_back(LevelResult);
+
+		printf("  %-14s load=%8.2fms %8.0f steps/s p50=%7.1fus p99=%7.1fus contacts/step=%7.1f rss=+%ldKB\n",
+			LevelName.c_str(),
+			LevelResult.LoadTime,
+			LevelResult.StepsPerSecond,
+			LevelResult.P50,
+			LevelResult.P99,
+			(double)LevelResult.Collisions.Contacts / LevelResult.Steps,
+			LevelResult.LevelRSS);
+	}
+	PlayState.SetTimer(0.0f);
+
+	// Write results
+	FILE *File = LevelOutputPath == "-" ? stdout : fopen(LevelOutputPath.c_str(), "w");
+	if(!File) {
+		std::cout << "Cannot open " << LevelOutputPath << std::endl;
+		return 1;
+	}
+
+	fprintf(File, "{\n");
+	fprintf(File, "\t\"version\": \"%s\",\n", GAME_VERSION);
+	fprintf(File, "\t\"time\": %g,\n", LevelTime);
+	fprintf(File, "\t\"timestep\": %g,\n", PHYSICS_TIMESTEP);
+	fprintf(File, "\t\"physics_threads\": %d,\n", Config.PhysicsThreads);
+	fprintf(File, "\t\"peak_rss_kb\": %ld,\n", GetPeakRSS());
+	fprintf(File, "\t\"levels\": [\n");
+	for(size_t i = 0; i < Results.size(); i++) {
+		const _LevelResult &LevelResult = Results[i];
+		fprintf(File, "\t\t{\n");
+		fprintf(File, "\t\t\t\"name\": \"%s\",\n", LevelResult.Name.c_str());
+		if(LevelResult.Error != "")
+			fprintf(File, "\t\t\t\"error\": \"%s\",\n", LevelResult.Error.c_str());
+		fprintf(File, "\t\t\t\"input\": \"%s\",\n", LevelResult.Input.c_str());
+		fprintf(File, "\t\t\t\"objects\": %d,\n", LevelResult.Objects);
+		fprintf(File, "\t\t\t\"steps\": %d,\n", LevelResult.Steps);
+		fprintf(File, "\t\t\t\"ended\": %s,\n", LevelResult.Ended ? "true" : "false");
+		fprintf(File, "\t\t\t\"load_ms\": %.3f,\n", LevelResult.LoadTime);
+		fprintf(File, "\t\t\t\"steps_per_second\": %.1f,\n", LevelResult.StepsPerSecond);
+		fprintf(File, "\t\t\t\"step_p50_us\": %.2f,\n", LevelResult.P50);
+		fprintf(File, "\t\t\t\"step_p99_us\": %.2f,\n", LevelResult.P99);
+		fprintf(File, "\t\t\t\"step_max_us\": %.2f,\n", LevelResult.MaxStep);
+		fprintf(File, "\t\t\t\"narrowphase_calls\": %llu,\n", (unsigned long long)LevelResult.Collisions.NearCalls);
+		fprintf(File, "\t\t\t\"contacts\": %llu,\n", (unsigned long long)LevelResult.Collisions.Contacts);
+		fprintf(File, "\t\t\t\"collision_events\": %llu,\n", (unsigned long long)LevelResult.Collisions.Events);
+		fprintf(File, "\t\t\t\"base_rss_kb\": %ld,\n", LevelResult.BaseRSS);
+		fprintf(File, "\t\t\t\"level_rss_kb\": %ld\n", LevelResult.LevelRSS);
+		fprintf(File, "\t\t}%s\n", i + 1 < Results.size() ? "," : "");
+	}
+	fprintf(File, "\t]\n");
+	fprintf(File, "}\n");
+
+	if(File != stdout) {
+		fclose(File);
+		std::cout << "Wrote " << LevelOutputPath << std::endl;
+	}
+
+	return Result;
+}
+
+// Load a level and spawn its objects, optionally overriding its broadphase and terrain collision
+bool _Benchmark::LoadLevel(const std::string &LevelName, const _Broadphase *Broadphase, int HeightField) {
+	LevelEnded = false;
+	if(!Level.Init(LevelName))
+		return false;
+
+	if(Broadphase)
+		Physics.SetBroadphase(*Broadphase);
+
+	if(HeightField != -1) {
+		for(auto &Template : Level.GetTemplates()) {
+			if(Template->Type == _Object::TERRAIN)
+				Template->HeightField = HeightField;
+		}
+	}
+
+	ObjectManager.ClearObjects();
+	Physics.Reset();
+	Level.SpawnEntities();
+	Level.RunScripts();
+
+	return true;
+}
+
+// Run one physics step of the loaded level
+void _Benchmark::StepLevel() {
+	ObjectManager.BeginFrame();
+	Physics.Update(PHYSICS_TIMESTEP);
+	ObjectManager.Update(PHYSICS_TIMESTEP);
+	ObjectManager.EndFrame();
+}
+
+// Unload the current level
+void _Benchmark::CloseLevel() {
+	Level.Close();
+	ObjectManager.ClearObjects();
+	irrScene->clear();
+	Physics.Close();
+}
+
+// Hash the state of all bodies with FNV-1a
+uint64_t _Benchmark::HashBodies(int &ObjectCount) {
+	ObjectCount = 0;
+	uint64_t Hash = 14695981039346656037ULL;
+	for(const auto &Object : ObjectManager.GetObjects()) {
+		if(!Object->GetBody())
+			continue;
+
+		float State[7];
+		glm::vec3 Position = Object->GetPosition();
+		glm::quat Quaternion = Object->GetQuaternion();
+		memcpy(&State[0], &Position[0], sizeof(float) * 3);
+		memcpy(&State[3], &Quaternion[0], sizeof(float) * 4);
+
+		const unsigned char *Bytes = (const unsigned char *)State;
+		for(size_t i = 0; i < sizeof(State); i++)
+			Hash = (Hash ^ Bytes[i]) * 1099511628211ULL;
+
+		ObjectCount++;
+	}
+
+	return Hash;
+}
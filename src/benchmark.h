@@ -0,0 +1,74 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstdint>
+#include <string>
+
+// Forward Declarations
+struct _Broadphase;
+
+// Microbenchmarks for engine subsystems
+class _Benchmark {
+
+	public:
+
+		_Benchmark();
+
+		int Run(const std::string &Name);
+		bool EndLevel();
+
+		// Options for the level suite
+		float LevelTime;
+		std::string LevelReplayPath;
+		std::string LevelOutputPath;
+
+	private:
+
+		int RunSuite(const std::string &Name);
+		void RunReplayWriter();
+		int RunPhysics();
+		int RunBroadphase();
+		int RunCollision();
+		int RunColMesh();
+		int RunTerrain();
+		int RunHeightField();
+		void RunObjects();
+		int RunReset();
+		int RunTransforms();
+		int RunSleep();
+		int RunCallbacks();
+		int RunTimers();
+		int RunAudio();
+		int RunVoices();
+		int RunLevels();
+
+		bool LoadLevel(const std::string &LevelName, const _Broadphase *Broadphase, int HeightField=-1);
+		void StepLevel();
+		void CloseLevel();
+		void ClearTerrainCache(const std::string &LevelName);
+		uint64_t HashBodies(int &ObjectCount);
+
+		bool Running;
+		bool LevelEnded;
+
+};
+
+// Singletons
+extern _Benchmark Benchmark;
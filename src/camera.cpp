@@ -119,9 +119,9 @@ void _Camera::RecordReplay() {
 		MovementChanged = false;
 
 		// Write replay information
-		std::fstream &ReplayFile = Replay.GetFile();
+		_ReplayWriter &ReplayWriter = Replay.GetWriter();
 		Replay.WriteEvent(_Replay::PACKET_CAMERA);
-		ReplayFile.write((char *)&Node->getPosition(), sizeof(core::vector3df));
-		ReplayFile.write((char *)&Node->getTarget(), sizeof(core::vector3df));
+		ReplayWriter.Write((char *)&Node->getPosition(), sizeof(core::vector3df));
+		ReplayWriter.Write((char *)&Node->getTarget(), sizeof(core::vector3df));
 	}
 }
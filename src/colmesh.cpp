@@ -0,0 +1,144 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <colmesh.h>
+#include <mappedfile.h>
+#include <log.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <unistd.h>
+#endif
+
+static_assert(sizeof(dTriIndex) == sizeof(uint32_t), "Precooked collision meshes need 32-bit indices");
+
+// Check that a section of a precooked mesh lies inside the file
+static bool CheckSection(uint32_t Offset, uint64_t Size, size_t FileSize) {
+	return Offset % sizeof(uint32_t) == 0 && Offset + Size <= FileSize;
+}
+
+// Get the next aligned offset
+static uint32_t Align(uint64_t Offset) {
+	return (uint32_t)((Offset + COLMESH_ALIGNMENT - 1) / COLMESH_ALIGNMENT * COLMESH_ALIGNMENT);
+}
+
+// Determine if a mapped file is a precooked collision mesh
+bool _ColMesh::IsColMesh(const _MappedFile &File) {
+	return File.GetSize() >= sizeof(_ColMeshHeader) && !memcmp(File.GetData(), COLMESH_MAGIC, sizeof(COLMESH_MAGIC));
+}
+
+// Create trimesh data that uses the lists in a mapped file, which must stay open
+dTriMeshDataID _ColMesh::Load(const _MappedFile &File) {
+	if(!IsColMesh(File))
+		return nullptr;
+
+	const char *Data = File.GetData();
+	size_t Size = File.GetSize();
+
+	// Read header
+	_ColMeshHeader Header;
+	memcpy(&Header, Data, sizeof(Header));
+	if(Header.Version != COLMESH_VERSION)
+		return nullptr;
+
+	// Check sections
+	if(!CheckSection(Header.VertexOffset, (uint64_t)Header.VertexCount * 3 * sizeof(float), Size)
+	|| !CheckSection(Header.FaceOffset, (uint64_t)Header.FaceCount * 3 * sizeof(dTriIndex), Size)
+	|| !CheckSection(Header.NodeOffset, (uint64_t)Header.NodeCount * COLMESH_NODE_SIZE, Size))
+		return nullptr;
+
+	// Vertices and faces are already in engine order
+	const float *Vertices = (const float *)(Data + Header.VertexOffset);
+	const dTriIndex *Faces = (const dTriIndex *)(Data + Header.FaceOffset);
+
+	// Faces must only refer to stored vertices
+	for(uint64_t i = 0; i < (uint64_t)Header.FaceCount * 3; i++) {
+		if(Faces[i] >= Header.VertexCount)
+			return nullptr;
+	}
+
+	dTriMeshDataID TriMeshData = dGeomTriMeshDataCreate();
+	if(!dGeomTriMeshDataBuildSingleTree(TriMeshData, Vertices, 3 * sizeof(float), Header.VertexCount, Faces, Header.FaceCount * 3, 3 * sizeof(dTriIndex), Data + Header.NodeOffset, Header.NodeCount)) {
+
+		// Build the tree again if the saved one doesn't match the mesh
+		Log.Write("Rebuilding collision tree");
+		dGeomTriMeshDataBuildSingle1(TriMeshData, Vertices, 3 * sizeof(float), Header.VertexCount, Faces, Header.FaceCount * 3, 3 * sizeof(dTriIndex), nullptr);
+	}
+
+	return TriMeshData;
+}
+
+// Write lists and the tree of built trimesh data to a precooked file
+bool _ColMesh::Save(const std::string &Path, const float *Vertices, uint32_t VertexCount, const dTriIndex *Faces, uint32_t FaceCount, dTriMeshDataID TriMeshData) {
+
+	// Get tree nodes, single triangle meshes don't have a tree
+	std::vector<char> Nodes(dGeomTriMeshDataGetTree(TriMeshData, nullptr) * COLMESH_NODE_SIZE);
+	if(Nodes.size())
+		dGeomTriMeshDataGetTree(TriMeshData, Nodes.data());
+
+	// Build header
+	_ColMeshHeader Header;
+	memcpy(Header.Magic, COLMESH_MAGIC, sizeof(Header.Magic));
+	Header.Version = COLMESH_VERSION;
+	Header.VertexCount = VertexCount;
+	Header.FaceCount = FaceCount;
+	Header.NodeCount = (uint32_t)(Nodes.size() / COLMESH_NODE_SIZE);
+	Header.VertexOffset = Align(sizeof(Header));
+	Header.FaceOffset = Align(Header.VertexOffset + (uint64_t)VertexCount * 3 * sizeof(float));
+	Header.NodeOffset = Nodes.size() ? Align(Header.FaceOffset + (uint64_t)FaceCount * 3 * sizeof(dTriIndex)) : 0;
+
+	// Write to a temporary file first so other processes never map a partial mesh
+#ifdef _WIN32
+	std::string TempPath = Path + "." + std::to_string(_getpid()) + ".tmp";
+#else
+	std::string TempPath = Path + "." + std::to_string(getpid()) + ".tmp";
+#endif
+	std::ofstream File(TempPath.c_str(), std::ios::out | std::ios::binary);
+	if(!File)
+		return false;
+
+	// Write sections
+	File.write((const char *)&Header, sizeof(Header));
+	File.seekp(Header.VertexOffset);
+	File.write((const char *)Vertices, VertexCount * 3 * sizeof(float));
+	File.seekp(Header.FaceOffset);
+	File.write((const char *)Faces, FaceCount * 3 * sizeof(dTriIndex));
+	if(Nodes.size()) {
+		File.seekp(Header.NodeOffset);
+		File.write(Nodes.data(), Nodes.size());
+	}
+	File.close();
+
+	// Replace the old file
+#ifdef _WIN32
+	bool Moved = File && MoveFileExA(TempPath.c_str(), Path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+	bool Moved = File && rename(TempPath.c_str(), Path.c_str()) == 0;
+#endif
+	if(!Moved)
+		remove(TempPath.c_str());
+
+	return Moved;
+}
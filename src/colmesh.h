@@ -0,0 +1,57 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <ode/common.h>
+#include <ode/collision_trimesh.h>
+#include <cstdint>
+#include <string>
+
+// Forward Declarations
+class _MappedFile;
+
+// Precooked collision meshes are written by tools/colmesh. Vertices, faces and
+// the OPCODE tree nodes each start on a page boundary and are used in place.
+const char COLMESH_MAGIC[4] = { 'I', 'C', 'O', 'L' };
+const uint32_t COLMESH_VERSION = 1;
+const uint32_t COLMESH_ALIGNMENT = 4096;
+const uint32_t COLMESH_NODE_SIZE = 32;
+
+// File header
+struct _ColMeshHeader {
+	char Magic[4];
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t FaceCount;
+	uint32_t NodeCount;
+	uint32_t VertexOffset;
+	uint32_t FaceOffset;
+	uint32_t NodeOffset;
+};
+
+// Reads and writes precooked collision meshes
+class _ColMesh {
+
+	public:
+
+		static bool IsColMesh(const _MappedFile &File);
+		static dTriMeshDataID Load(const _MappedFile &File);
+		static bool Save(const std::string &Path, const float *Vertices, uint32_t VertexCount, const dTriIndex *Faces, uint32_t FaceCount, dTriMeshDataID TriMeshData);
+
+};
@@ -78,6 +78,10 @@ void _Config::Reset() {
 
 	// Replays
 	AutosaveNewRecords = true;
+	CompressReplays = false;
+
+	// Physics
+	PhysicsThreads = 0;
 
 #ifdef PANDORA
 	DriverType = EDT_OGLES1;
@@ -271,6 +275,13 @@ int _Config::ReadConfig() {
 	XMLElement *ReplayElement = ConfigElement->FirstChildElement("replay");
 	if(ReplayElement) {
 		ReplayElement->QueryBoolAttribute("autosave", &AutosaveNewRecords);
+		ReplayElement->QueryBoolAttribute("compress", &CompressReplays);
+	}
+
+	// Check for the physics tag
+	XMLElement *PhysicsElement = ConfigElement->FirstChildElement("physics");
+	if(PhysicsElement) {
+		PhysicsElement->QueryIntAttribute("threads", &PhysicsThreads);
 	}
 
 	// Get input element
@@ -359,8 +370,14 @@ int _Config::WriteConfig() {
 	// Create replay element
 	XMLElement *ReplayElement = Document.NewElement("replay");
 	ReplayElement->SetAttribute("autosave", AutosaveNewRecords);
+	ReplayElement->SetAttribute("compress", CompressReplays);
 	ConfigElement->LinkEndChild(ReplayElement);
 
+	// Create physics element
+	XMLElement *PhysicsElement = Document.NewElement("physics");
+	PhysicsElement->SetAttribute("threads", PhysicsThreads);
+	ConfigElement->LinkEndChild(PhysicsElement);
+
 	// Input
 	XMLElement *InputElement = Document.NewElement("input");
 	InputElement->SetAttribute("mouse_sensitivity", MouseSensitivity);
@@ -64,6 +64,10 @@ class _Config {
 
 		// Replays
 		bool AutosaveNewRecords;
+		bool CompressReplays;
+
+		// Physics
+		int PhysicsThreads;
 
 	private:
 
@@ -160,6 +160,12 @@ int _Database::GetInt(int ColumnIndex, int Handle) {
 	return sqlite3_column_int(QueryHandle[Handle], ColumnIndex);
 }
 
+// Returns a 64-bit integer column
+sqlite3_int64 _Database::GetInt64(int ColumnIndex, int Handle) {
+
+	return sqlite3_column_int64(QueryHandle[Handle], ColumnIndex);
+}
+
 // Returns a float column
 float _Database::GetFloat(int ColumnIndex, int Handle) {
 
@@ -37,6 +37,7 @@ class _Database {
 		sqlite3_int64 GetLastInsertID();
 
 		int GetInt(int ColumnIndex, int Handle=0);
+		sqlite3_int64 GetInt64(int ColumnIndex, int Handle=0);
 		float GetFloat(int ColumnIndex, int Handle=0);
 		const char *GetString(int ColumnIndex, int Handle=0);
 
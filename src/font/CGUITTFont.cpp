@@ -173,6 +173,14 @@ void SGUITTGlyph::preload(u32 char_index, FT_Face face, video::IVideoDriver* dri
 
 	glyph_page = parent->getLastGlyphPageIndex();
 	u32 texture_side_length = page->texture->getOriginalSize().Width;
+
+	// The null driver creates empty textures, so there is nothing to pack the glyph into.
+	if (texture_side_length < font_size)
+	{
+		isLoaded = true;
+		return;
+	}
+
 	core::vector2di page_position(
 		(page->used_slots % (texture_side_length / font_size)) * font_size,
 		(page->used_slots / (texture_side_length / font_size)) * font_size
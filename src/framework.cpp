@@ -34,6 +34,10 @@
 #include <states/viewreplay.h>
 #include <states/null.h>
 #include <menu.h>
+#include <validator.h>
+#include <benchmark.h>
+#include <replay.h>
+#include <profiler.h>
 #include <IFileSystem.h>
 #include <iostream>
 #include <sstream>
@@ -52,9 +56,16 @@ int _Framework::Init(int Count, char **Arguments) {
 	WindowActive = true;
 	MouseWasLocked = false;
 	Done = false;
+	Headless = false;
+	ExitCode = 0;
 	_State *FirstState = &NullState;
 	video::E_DRIVER_TYPE DriverType = video::EDT_NULL;
 	bool AudioEnabled = true;
+	std::string ValidatePath;
+	int ValidateJobs = 0;
+	float ValidateTimeout = VALIDATE_TIMEOUT;
+	std::string ConvertInput, ConvertOutput;
+	std::string BenchmarkName;
 	PlayState.SetCampaign(-1);
 	PlayState.SetCampaignLevel(-1);
 
@@ -95,6 +106,42 @@ int _Framework::Init(int Count, char **Arguments) {
 			PlayState.SetValidateReplay(Arguments[++i]);
 			FirstState = &PlayState;
 		}
+		else if(Token == "-validatedir" && TokensRemaining > 0) {
+			ValidatePath = Arguments[++i];
+		}
+		else if(Token == "-jobs" && TokensRemaining > 0) {
+			ValidateJobs = atoi(Arguments[++i]);
+		}
+		else if(Token == "-validatetimeout" && TokensRemaining > 0) {
+			ValidateTimeout = (float)atof(Arguments[++i]);
+		}
+		else if(Token == "-convertreplay" && TokensRemaining > 1) {
+			ConvertInput = Arguments[++i];
+			ConvertOutput = Arguments[++i];
+		}
+		else if(Token == "-benchmark" && TokensRemaining > 0) {
+			BenchmarkName = Arguments[++i];
+			Headless = true;
+		}
+		else if(Token == "-benchtime" && TokensRemaining > 0) {
+			Benchmark.LevelTime = (float)atof(Arguments[++i]);
+		}
+		else if(Token == "-benchreplays" && TokensRemaining > 0) {
+			Benchmark.LevelReplayPath = Arguments[++i];
+		}
+		else if(Token == "-benchoutput" && TokensRemaining > 0) {
+			Benchmark.LevelOutputPath = Arguments[++i];
+		}
+		else if(Token == "-profile" && TokensRemaining > 0) {
+			ProfilePath = Arguments[++i];
+			Profiler.SetEnabled(true);
+		}
+		else if(Token == "-physicsthreads" && TokensRemaining > 0) {
+			Config.PhysicsThreads = atoi(Arguments[++i]);
+		}
+		else if(Token == "-headless") {
+			Headless = true;
+		}
 		else if(Token == "-resolution" && TokensRemaining > 1) {
 			std::stringstream Buffer(std::string(Arguments[i+1]) + " " + std::string(Arguments[i+2]));
 			Buffer >> Config.ScreenWidth >> Config.ScreenHeight;
@@ -108,8 +155,27 @@ int _Framework::Init(int Count, char **Arguments) {
 		}
 	}
 
-	// Set up the graphics
+	// Validate a directory of replays in worker processes
+	if(ValidatePath != "") {
+		ExitCode = Validator.RunBatch(Arguments[0], ValidatePath, ValidateJobs, ValidateTimeout);
+		return 0;
+	}
+
+	// Convert a replay to the compressed format
+	if(ConvertInput != "") {
+		ExitCode = !Replay.ConvertReplay(ConvertInput, ConvertOutput);
+		return 0;
+	}
+
+	// Run without a window or audio
 	DriverType = (video::E_DRIVER_TYPE)Config.DriverType;
+	if(Headless) {
+		DriverType = video::EDT_NULL;
+		AudioEnabled = false;
+		HasConfigFile = 1;
+	}
+
+	// Set up the graphics
 	if(!Graphics.Init(!HasConfigFile, Config.ScreenWidth, Config.ScreenHeight, Config.Fullscreen, DriverType, &Input))
 		return 0;
 
@@ -180,6 +246,12 @@ int _Framework::Init(int Count, char **Arguments) {
 	ManagerState = STATE_INIT;
 	Fader.Start(FADE_SPEED);
 
+	// Run a benchmark after the engine is up
+	if(BenchmarkName != "") {
+		ExitCode = Benchmark.Run(BenchmarkName);
+		Done = true;
+	}
+
 	return 1;
 }
 
@@ -195,13 +267,19 @@ void _Framework::ChangeState(_State *State) {
 // Updates the current state and runs the game engine
 void _Framework::Update() {
 
+	// Finish the last frame's profile and time this one
+	Profiler.EndFrame();
+	_ProfileScope Scope(_Profiler::FRAME);
+
 	// Run irrlicht engine
 	if(!irrDevice->run())
 		Done = true;
 
-	// Get time difference from last frame
+	// Get time difference from last frame, headless mode runs one step per frame
 	LastFrameTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - Timestamp);
 	Timestamp = std::chrono::high_resolution_clock::now();
+	if(Headless)
+		LastFrameTime = std::chrono::duration<float>(TimeStep);
 
 	// Check for window activity
 	PreviousWindowActive = WindowActive;
@@ -222,7 +300,8 @@ void _Framework::Update() {
 
 	// Update fader
 	Fader.Update(LastFrameTime.count() * TimeScale);
-	Graphics.BeginFrame();
+	if(!Headless)
+		Graphics.BeginFrame();
 
 	// Update the current state
 	switch(ManagerState) {
@@ -245,7 +324,8 @@ void _Framework::Update() {
 				TimeStepAccumulator -= TimeStep;
 			}
 
-			State->UpdateRender(TimeStepAccumulator / TimeStep);
+			if(!Headless)
+				State->UpdateRender(TimeStepAccumulator / TimeStep);
 		break;
 		case STATE_CLOSE:
 			if(Fader.IsDoneFading()) {
@@ -256,6 +336,10 @@ void _Framework::Update() {
 		break;
 	}
 
+	// Skip rendering and frame limiting when headless
+	if(Headless)
+		return;
+
 	Audio.Update();
 	State->Draw();
 	Graphics.EndFrame();
@@ -277,6 +361,10 @@ void _Framework::Close() {
 	// Close the state
 	State->Close();
 
+	// Write profile
+	if(ProfilePath != "")
+		Profiler.ExportTrace(ProfilePath);
+
 	// Shut down the system
 	DisableAudio();
 	Campaign.Close();
@@ -43,6 +43,9 @@ class _Framework {
 
 		bool IsDone() { return Done; }
 		void SetDone(bool Value) { Done = Value; }
+		bool IsHeadless() { return Headless; }
+		int GetExitCode() { return ExitCode; }
+		void SetExitCode(int Value) { ExitCode = Value; }
 
 		ManagerStateType GetManagerState() { return ManagerState; }
 		void ChangeState(_State *State);
@@ -71,7 +74,8 @@ class _Framework {
 		bool PreviousWindowActive, WindowActive;
 
 		// Flags
-		bool Done, MouseWasLocked;
+		bool Done, MouseWasLocked, Headless;
+		int ExitCode;
 
 		// Time
 		std::chrono::high_resolution_clock::time_point Timestamp;
@@ -83,6 +87,7 @@ class _Framework {
 
 		// Misc
 		std::string WorkingPath;
+		std::string ProfilePath;
 };
 
 // Singletons
@@ -21,6 +21,7 @@
 #include <interface.h>
 #include <input.h>
 #include <log.h>
+#include <profiler.h>
 #include <fader.h>
 #include <config.h>
 #include <irrlicht.h>
@@ -175,8 +176,10 @@ void _Graphics::LoadShaders() {
 void _Graphics::BeginFrame() {
 	irrDriver->beginScene(true, true, ClearColor);
 
-	if(DrawScene)
+	if(DrawScene) {
+		_ProfileScope Scope(_Profiler::SCENE_DRAW);
 		irrScene->drawAll();
+	}
 }
 
 // Draws the buffer to the screen
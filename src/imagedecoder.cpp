@@ -0,0 +1,227 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <imagedecoder.h>
+#include <png.h>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <jpeglib.h>
+
+// Png data being read from memory
+struct _PNGSource {
+	const uint8_t *Data;
+	size_t Size;
+	size_t Offset;
+};
+
+// Jpeg error handler that returns to the decoder instead of exiting
+struct _JPEGError {
+	jpeg_error_mgr Manager;
+	jmp_buf JumpBuffer;
+};
+
+// Read png data from memory
+static void ReadPNGData(png_structp PNG, png_bytep Output, png_size_t Length) {
+	_PNGSource *Source = (_PNGSource *)png_get_io_ptr(PNG);
+	if(Length > Source->Size - Source->Offset)
+		png_error(PNG, "Unexpected end of file");
+
+	memcpy(Output, Source->Data + Source->Offset, Length);
+	Source->Offset += Length;
+}
+
+// Stop decoding a png, failed images are loaded again by irrlicht which reports the error
+static void HandlePNGError(png_structp PNG, png_const_charp Message) {
+	png_longjmp(PNG, 1);
+}
+
+// Ignore png warnings
+static void HandlePNGWarning(png_structp PNG, png_const_charp Message) {
+}
+
+// Stop decoding a jpeg
+static void HandleJPEGError(j_common_ptr Info) {
+	longjmp(((_JPEGError *)Info->err)->JumpBuffer, 1);
+}
+
+// Ignore jpeg warnings
+static void HandleJPEGMessage(j_common_ptr Info) {
+}
+
+// Decode a png or jpeg file, keeps the file data if the format isn't supported
+bool _DecodedImage::Decode(std::vector<char> &&Data) {
+	const uint8_t *Bytes = (const uint8_t *)Data.data();
+	size_t Size = Data.size();
+
+	// Check signatures
+	bool Decoded = false;
+	if(Size >= 8 && !png_sig_cmp(Bytes, 0, 8))
+		Decoded = DecodePNG(Bytes, Size);
+	else if(Size >= 3 && Bytes[0] == 0xFF && Bytes[1] == 0xD8 && Bytes[2] == 0xFF)
+		Decoded = DecodeJPEG(Bytes, Size);
+
+	if(!Decoded)
+		File = std::move(Data);
+
+	return Decoded;
+}
+
+// Decode a png with the same transformations as irrlicht's png loader
+bool _DecodedImage::DecodePNG(const uint8_t *Data, size_t Size) {
+	png_structp PNG = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, HandlePNGError, HandlePNGWarning);
+	if(!PNG)
+		return false;
+
+	png_infop Info = png_create_info_struct(PNG);
+	if(!Info) {
+		png_destroy_read_struct(&PNG, nullptr, nullptr);
+		return false;
+	}
+
+	if(setjmp(png_jmpbuf(PNG))) {
+		png_destroy_read_struct(&PNG, &Info, nullptr);
+		return false;
+	}
+
+	_PNGSource Source = { Data, Size, 0 };
+	png_set_read_fn(PNG, &Source, ReadPNGData);
+	png_read_info(PNG, Info);
+
+	// Expand everything to 8 bit RGB or RGBA
+	png_uint_32 ImageWidth, ImageHeight;
+	int BitDepth, ColorType;
+	png_get_IHDR(PNG, Info, &ImageWidth, &ImageHeight, &BitDepth, &ColorType, nullptr, nullptr, nullptr);
+	if(ColorType == PNG_COLOR_TYPE_PALETTE)
+		png_set_palette_to_rgb(PNG);
+	if(BitDepth < 8) {
+		if(ColorType == PNG_COLOR_TYPE_GRAY || ColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_expand_gray_1_2_4_to_8(PNG);
+		else
+			png_set_packing(PNG);
+	}
+	if(png_get_valid(PNG, Info, PNG_INFO_tRNS))
+		png_set_tRNS_to_alpha(PNG);
+	if(BitDepth == 16)
+		png_set_strip_16(PNG);
+	if(ColorType == PNG_COLOR_TYPE_GRAY || ColorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+		png_set_gray_to_rgb(PNG);
+
+	// Gamma correct for a 2.2 screen
+	int Intent;
+	double ImageGamma;
+	if(png_get_sRGB(PNG, Info, &Intent) || !png_get_gAMA(PNG, Info, &ImageGamma))
+		ImageGamma = 0.45455;
+	png_set_gamma(PNG, 2.2, ImageGamma);
+
+	png_read_update_info(PNG, Info);
+	png_get_IHDR(PNG, Info, &ImageWidth, &ImageHeight, &BitDepth, &ColorType, nullptr, nullptr, nullptr);
+
+	// Alpha images are stored as BGRA
+	bool Alpha = ColorType == PNG_COLOR_TYPE_RGB_ALPHA;
+	if(Alpha) {
+#ifdef __BIG_ENDIAN__
+		png_set_swap_alpha(PNG);
+#else
+		png_set_bgr(PNG);
+#endif
+	}
+
+	// Allocate pixels
+	size_t Pitch = (size_t)ImageWidth * (Alpha ? 4 : 3);
+	std::unique_ptr<uint8_t[]> ImagePixels(new uint8_t[Pitch * ImageHeight]);
+	std::vector<png_bytep> Rows(ImageHeight);
+	for(png_uint_32 i = 0; i < ImageHeight; i++)
+		Rows[i] = ImagePixels.get() + i * Pitch;
+
+	if(setjmp(png_jmpbuf(PNG))) {
+		png_destroy_read_struct(&PNG, &Info, nullptr);
+		return false;
+	}
+
+	png_read_image(PNG, Rows.data());
+	png_read_end(PNG, nullptr);
+	png_destroy_read_struct(&PNG, &Info, nullptr);
+
+	Width = ImageWidth;
+	Height = ImageHeight;
+	HasAlpha = Alpha;
+	Pixels = std::move(ImagePixels);
+
+	return true;
+}
+
+// Decode a jpeg with the same settings as irrlicht's jpeg loader
+bool _DecodedImage::DecodeJPEG(const uint8_t *Data, size_t Size) {
+	jpeg_decompress_struct Info;
+	_JPEGError Error;
+	Info.err = jpeg_std_error(&Error.Manager);
+	Error.Manager.error_exit = HandleJPEGError;
+	Error.Manager.output_message = HandleJPEGMessage;
+
+	if(setjmp(Error.JumpBuffer)) {
+		jpeg_destroy_decompress(&Info);
+		return false;
+	}
+
+	jpeg_create_decompress(&Info);
+	jpeg_mem_src(&Info, (unsigned char *)Data, (unsigned long)Size);
+	jpeg_read_header(&Info, TRUE);
+
+	// Decode CMYK images as is and convert them below
+	bool CMYK = Info.jpeg_color_space == JCS_CMYK;
+	Info.out_color_space = CMYK ? JCS_CMYK : JCS_RGB;
+	Info.out_color_components = CMYK ? 4 : 3;
+	Info.output_gamma = 2.2;
+	Info.do_fancy_upsampling = FALSE;
+	jpeg_start_decompress(&Info);
+
+	// Allocate pixels
+	size_t Pitch = (size_t)Info.output_width * Info.out_color_components;
+	std::unique_ptr<uint8_t[]> ImagePixels(new uint8_t[Pitch * Info.output_height]);
+
+	if(setjmp(Error.JumpBuffer)) {
+		jpeg_destroy_decompress(&Info);
+		return false;
+	}
+
+	while(Info.output_scanline < Info.output_height) {
+		JSAMPROW Row = ImagePixels.get() + Info.output_scanline * Pitch;
+		jpeg_read_scanlines(&Info, &Row, 1);
+	}
+
+	Width = Info.output_width;
+	Height = Info.output_height;
+	HasAlpha = false;
+	jpeg_finish_decompress(&Info);
+	jpeg_destroy_decompress(&Info);
+
+	// Multiply CMYK by K into RGB like irrlicht
+	if(CMYK) {
+		std::unique_ptr<uint8_t[]> RGBPixels(new uint8_t[(size_t)Width * Height * 3]);
+		for(size_t i = 0, j = 0; i < (size_t)Width * Height * 3; i += 3, j += 4) {
+			RGBPixels[i + 0] = (uint8_t)(ImagePixels[j + 2] * (ImagePixels[j + 3] / 255.0f));
+			RGBPixels[i + 1] = (uint8_t)(ImagePixels[j + 1] * (ImagePixels[j + 3] / 255.0f));
+			RGBPixels[i + 2] = (uint8_t)(ImagePixels[j + 0] * (ImagePixels[j + 3] / 255.0f));
+		}
+		ImagePixels = std::move(RGBPixels);
+	}
+
+	Pixels = std::move(ImagePixels);
+
+	return true;
+}
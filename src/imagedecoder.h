@@ -0,0 +1,50 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// An image file decoded with libpng or libjpeg instead of irrlicht, so loader threads don't touch engine state.
+// Pixels use the same layout and color conversions as irrlicht's loaders: A8R8G8B8 with alpha, R8G8B8 without.
+class _DecodedImage {
+
+	public:
+
+		_DecodedImage() : Width(0), Height(0), HasAlpha(false) { }
+
+		bool Decode(std::vector<char> &&Data);
+
+		// Decoded pixels, allocated with new[] so an irrlicht image can take ownership
+		uint32_t Width;
+		uint32_t Height;
+		bool HasAlpha;
+		std::unique_ptr<uint8_t[]> Pixels;
+
+		// File data that couldn't be decoded, left for irrlicht to load on the main thread
+		std::vector<char> File;
+
+	private:
+
+		bool DecodePNG(const uint8_t *Data, size_t Size);
+		bool DecodeJPEG(const uint8_t *Data, size_t Size);
+
+};
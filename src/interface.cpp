@@ -21,6 +21,8 @@
 #include <log.h>
 #include <audio.h>
 #include <level.h>
+#include <objectmanager.h>
+#include <profiler.h>
 #include <font/CGUITTFont.h>
 #include <menu.h>
 
@@ -405,6 +407,45 @@ void _Interface::RenderFPS(int PositionX, int PositionY) {
 	//Interface.RenderText(Buffer, PositionX, PositionY + 25, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
 }
 
+// Draws the number of moving objects out of all objects
+void _Interface::RenderObjectCount(int PositionX, int PositionY) {
+	if(!DrawHUD)
+		return;
+
+	char Buffer[32];
+	sprintf(Buffer, "%d/%d active", (int)ObjectManager.GetActiveCount(), (int)ObjectManager.GetObjectCount());
+	Interface.RenderText(Buffer, PositionX, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+}
+
+// Draws the rolling time per frame of each profiled section
+void _Interface::RenderProfiler(int PositionX, int PositionY) {
+	if(!Profiler.ShowOverlay)
+		return;
+
+	int LineHeight = 20 * GetUIScale();
+	int ColumnWidth = 70 * GetUIScale();
+	int NameWidth = 110 * GetUIScale();
+	RenderText("ms", PositionX, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+	RenderText("min", PositionX + NameWidth, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+	RenderText("avg", PositionX + NameWidth + ColumnWidth, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+	RenderText("max", PositionX + NameWidth + ColumnWidth * 2, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+
+	char Buffer[32];
+	for(int i = 0; i < _Profiler::COUNT; i++) {
+		double Minimum, Average, Maximum;
+		Profiler.GetStats(i, Minimum, Average, Maximum);
+
+		PositionY += LineHeight;
+		RenderText(_Profiler::GetSectionName(i), PositionX, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+		sprintf(Buffer, "%.2f", Minimum);
+		RenderText(Buffer, PositionX + NameWidth, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+		sprintf(Buffer, "%.2f", Average);
+		RenderText(Buffer, PositionX + NameWidth + ColumnWidth, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+		sprintf(Buffer, "%.2f", Maximum);
+		RenderText(Buffer, PositionX + NameWidth + ColumnWidth * 2, PositionY, _Interface::ALIGN_LEFT, _Interface::FONT_SMALL);
+	}
+}
+
 // Draws an interface image centered around a position
 void _Interface::DrawImage(ImageType Type, int PositionX, int PositionY, int Width, int Height, const video::SColor &Color) {
 
@@ -148,6 +148,8 @@ class _Interface {
 		void FadeScreen(float Amount);
 		void RenderText(const char *Text, int PositionX, int PositionY, AlignType AlignType, FontType FontType=FONT_SMALL, const irr::video::SColor &Color=irr::video::SColor(255, 255, 255, 255));
 		void RenderFPS(int PositionX, int PositionY);
+		void RenderObjectCount(int PositionX, int PositionY);
+		void RenderProfiler(int PositionX, int PositionY);
 		void DrawImage(ImageType Type, int PositionX, int PositionY, int Width, int Height, const irr::video::SColor &Color=irr::video::SColor(255, 255, 255, 255));
 		void DrawTextBox(int PositionX, int PositionY, int Width, int Height, const irr::video::SColor &Color=irr::video::SColor(255, 255, 255, 255));
 		void DrawShortMessage();
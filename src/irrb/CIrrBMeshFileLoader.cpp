@@ -110,6 +110,77 @@ IAnimatedMesh* CIrrBMeshFileLoader::readMesh(io::IReadFile* reader)
 	return animatedmesh;
 }
 
+//! copies bytes out of a memory buffer, returns false at the end of the data
+static bool readData(const c8* data, u32 size, u64& pos, void* buffer, u32 length)
+{
+	if(pos > size || length > size - pos)
+		return false;
+
+	memcpy(buffer, data + pos, length);
+	pos += length;
+	return true;
+}
+
+//! walks the mesh sections like readMesh, only reading texture name chunks
+void CIrrBMeshFileLoader::getTextureNames(const void* fileData, u32 size, core::array<core::stringc>& names)
+{
+	const c8* data = (const c8*)fileData;
+	struct irr::scene::IrrbHeader ih;
+
+	u64 pos = 0;
+	if(!readData(data, size, pos, &ih, sizeof(ih)))
+		return;
+
+	if(ih.hSigCheck != MAKE_IRR_ID('i','r','r','b'))
+		return;
+
+	u64 next = sizeof(struct IrrbHeader);
+	for(u32 i=0; i<ih.hMeshCount; i++)
+	{
+		struct IrrbChunkInfo ci;
+		struct IrrbMeshInfo mi;
+
+		pos = next;
+		if(!readData(data, size, pos, &ci, sizeof(ci)) || ci.iId != CID_MESH)
+			return;
+		next = pos + ci.iSize;
+
+		// skip vertex & index data
+		if(!readData(data, size, pos, &mi, sizeof(mi)))
+			return;
+		pos += (u64)sizeof(struct IrrbVertex) * mi.iVertexCount + (u64)sizeof(u32) * mi.iIndexCount;
+
+		for(u32 j=0; j<mi.iMaterialCount; j++)
+		{
+			struct IrrbMaterial mat;
+			if(!readData(data, size, pos, &mat, sizeof(mat)))
+				return;
+
+			for(u32 k=0; k<mat.mLayerCount; k++)
+			{
+				c8 buf[256];
+				struct IrrbChunkInfo chunk;
+				if(!readData(data, size, pos, &chunk, sizeof(chunk)))
+					return;
+
+				if(chunk.iId == CID_STRING)
+				{
+					if(chunk.iSize >= sizeof(buf))
+						return;
+
+					memset(buf,0,sizeof(buf));
+					if(!readData(data, size, pos, buf, chunk.iSize))
+						return;
+					if(buf[0])
+						names.push_back(buf);
+				}
+
+				pos += sizeof(struct IrrbMaterialLayer);
+			}
+		}
+	}
+}
+
 u32 CIrrBMeshFileLoader::readChunk(struct IrrbChunkInfo& chunk)
 {
 	return Reader->read(&chunk, sizeof(chunk));
@@ -42,6 +42,10 @@ public:
 	//! See IReferenceCounted::drop() for more information.
 	virtual IAnimatedMesh* createMesh(io::IReadFile* file);
 
+	//! finds the texture names used by a mesh file in memory without loading it, so the
+	//! textures can be decoded ahead of time. Only reads the buffer, safe on any thread.
+	static void getTextureNames(const void* data, u32 size, core::array<core::stringc>& names);
+
 private:
 
 	//! reads a mesh sections and creates a mesh from it
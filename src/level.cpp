@@ -27,6 +27,7 @@
 #include <physics.h>
 #include <input.h>
 #include <audio.h>
+#include <assetloader.h>
 #include <config.h>
 #include <objects/template.h>
 #include <objects/player.h>
@@ -42,6 +43,7 @@
 #include <tinyxml2/tinyxml2.h>
 #include <ISceneManager.h>
 #include <IFileSystem.h>
+#include <chrono>
 
 _Level Level;
 
@@ -67,6 +69,7 @@ void _UserDataLoader::OnReadUserData(irr::scene::ISceneNode *ForSceneNode, irr::
 int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 	if(!HeaderOnly)
 		Log.Write("Loading level: %s", LevelName.c_str());
+	auto StartTime = std::chrono::high_resolution_clock::now();
 
 	// Get fastest time
 	FastestTime = 0.0f;
@@ -138,6 +141,8 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 		Close();
 		return true;
 	}
+	std::chrono::duration<double, std::milli> XMLTime = std::chrono::high_resolution_clock::now() - StartTime;
+	_AssetLoader AssetLoader;
 
 	// Load default lua script
 	Scripts.clear();
@@ -150,6 +155,8 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 	irrScene->setAmbientLight(video::SColorf(0.3, 0.3, 0.3, 1));
 	irrDriver->setFog(video::SColor(0), irr::video::EFT_FOG_EXP, 0, 0, 0);
 
+	_Broadphase Broadphase;
+
 	// Load options
 	XMLElement *OptionsElement = LevelElement->FirstChildElement("options");
 	if(OptionsElement) {
@@ -159,13 +166,37 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 		if(EmitLightElement) {
 			EmitLightElement->QueryBoolAttribute("enabled", &EmitLight);
 		}
+
+		// Collision space
+		XMLElement *BroadphaseElement = OptionsElement->FirstChildElement("broadphase");
+		if(BroadphaseElement && !GetBroadphaseProperties(BroadphaseElement, Broadphase)) {
+			Close();
+			return 0;
+		}
 	}
+	Physics.SetBroadphase(Broadphase);
 
 	// Load world
 	XMLElement *ResourcesElement = LevelElement->FirstChildElement("resources");
+	std::chrono::duration<double, std::milli> SceneTime(0);
 	if(ResourcesElement) {
 
+		// Start reading scene files, sounds and collision files on loader threads
+		for(XMLElement *SceneElement = ResourcesElement->FirstChildElement("scene"); SceneElement != 0; SceneElement = SceneElement->NextSiblingElement("scene")) {
+			if(SceneElement->Attribute("file"))
+				AssetLoader.AddScene(CustomDataPath + SceneElement->Attribute("file"), IsCustomLevel ? CustomDataPath : Framework.GetWorkingPath());
+		}
+		for(XMLElement *SoundElement = ResourcesElement->FirstChildElement("sound"); SoundElement != 0; SoundElement = SoundElement->NextSiblingElement("sound")) {
+			if(SoundElement->Attribute("file"))
+				AssetLoader.AddSound(SoundElement->Attribute("file"));
+		}
+		for(XMLElement *CollisionElement = ResourcesElement->FirstChildElement("collision"); CollisionElement != 0; CollisionElement = CollisionElement->NextSiblingElement("collision")) {
+			if(CollisionElement->Attribute("file"))
+				AssetLoader.AddCollision(CustomDataPath + CollisionElement->Attribute("file"));
+		}
+
 		// Load scenes
+		auto SceneStartTime = std::chrono::high_resolution_clock::now();
 		for(XMLElement *SceneElement = ResourcesElement->FirstChildElement("scene"); SceneElement != 0; SceneElement = SceneElement->NextSiblingElement("scene")) {
 
 			// Get file
@@ -179,13 +210,17 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 			// Reset fog
 			irrDriver->setFog(video::SColor(0, 0, 0, 0), video::EFT_FOG_EXP, 0, 0, 0.0f);
 
-			// Load scene
+			// Load scene, meshes find their textures relative to the working directory
 			if(IsCustomLevel) {
 				irrFile->changeWorkingDirectoryTo(CustomDataPath.c_str());
+				AssetLoader.Finish(_AssetLoader::MESH);
+				AssetLoader.Finish(_AssetLoader::TEXTURE);
 				irrScene->loadScene(File.c_str(), &UserDataLoader);
 				irrFile->changeWorkingDirectoryTo(Framework.GetWorkingPath().c_str());
 			}
 			else {
+				AssetLoader.Finish(_AssetLoader::MESH);
+				AssetLoader.Finish(_AssetLoader::TEXTURE);
 				irrScene->loadScene((CustomDataPath + File).c_str(), &UserDataLoader);
 			}
 
@@ -214,6 +249,8 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 			}
 		}
 
+		SceneTime = std::chrono::high_resolution_clock::now() - SceneStartTime;
+
 		// Load collision
 		for(XMLElement *CollisionElement = ResourcesElement->FirstChildElement("collision"); CollisionElement != 0; CollisionElement = CollisionElement->NextSiblingElement("collision")) {
 
@@ -272,9 +309,7 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 				return 0;
 			}
 
-			// Attempt to load sound
-			if(Audio.LoadBuffer(File))
-				Sounds.push_back(File);
+			Sounds.push_back(File);
 		}
 	}
 
@@ -292,6 +327,14 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 			if(!GetTemplateProperties(TemplateElement, *Template))
 				return 0;
 
+			// Start loading its files
+			if(Template->Mesh != "")
+				AssetLoader.AddMesh(Template->Mesh, Template->Mesh, Framework.GetWorkingPath());
+			for(int i = 0; i < 4; i++) {
+				if(Template->Textures[i] != "")
+					AssetLoader.AddTexture(Template->Textures[i]);
+			}
+
 			// Assign options
 			Template->TemplateID = TemplateID;
 			if(EmitLight) {
@@ -373,6 +416,29 @@ int _Level::Init(const std::string &LevelName, bool HeaderOnly) {
 		}
 	}
 
+	// Upload the rest of the assets
+	auto AssetStartTime = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> ParseTime = AssetStartTime - StartTime - XMLTime - SceneTime;
+	AssetLoader.Finish();
+
+	// Keep sounds that loaded
+	for(auto Iterator = Sounds.begin(); Iterator != Sounds.end(); ) {
+		if(Audio.IsEnabled() && !Audio.GetBuffer(*Iterator))
+			Iterator = Sounds.erase(Iterator);
+		else
+			++Iterator;
+	}
+
+	// Build contact surfaces for template pairs
+	Physics.SetMaterials(Templates);
+
+	// Log load times
+	auto EndTime = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> AssetTime = EndTime - AssetStartTime;
+	std::chrono::duration<double, std::milli> TotalTime = EndTime - StartTime;
+	Log.Write("Level times: xml=%.1fms scenes=%.1fms parse=%.1fms assets=%.1fms total=%.1fms wait=%.1fms", XMLTime.count(), SceneTime.count(), ParseTime.count(), AssetTime.count(), TotalTime.count(), AssetLoader.GetWaitTime());
+	AssetLoader.LogTimes();
+
 	return 1;
 }
 
@@ -409,6 +475,80 @@ int _Level::Close() {
 	return 1;
 }
 
+// Processes the broadphase option
+int _Level::GetBroadphaseProperties(XMLElement *BroadphaseElement, _Broadphase &Broadphase) {
+	XMLElement *Element;
+
+	// Get type
+	std::string Type = "hash";
+	if(BroadphaseElement->Attribute("type"))
+		Type = BroadphaseElement->Attribute("type");
+
+	if(Type == "hash") {
+		Broadphase.Type = _Broadphase::BROADPHASE_HASH;
+		BroadphaseElement->QueryIntAttribute("minlevel", &Broadphase.MinLevel);
+		BroadphaseElement->QueryIntAttribute("maxlevel", &Broadphase.MaxLevel);
+		if(Broadphase.MinLevel > Broadphase.MaxLevel) {
+			Log.Write("Broadphase minlevel is greater than maxlevel");
+			return 0;
+		}
+	}
+	else if(Type == "sap") {
+		Broadphase.Type = _Broadphase::BROADPHASE_SAP;
+
+		// Get axis order
+		std::string Axes = "xzy";
+		if(BroadphaseElement->Attribute("axes"))
+			Axes = BroadphaseElement->Attribute("axes");
+
+		if(Axes == "xyz")
+			Broadphase.AxisOrder = dSAP_AXES_XYZ;
+		else if(Axes == "xzy")
+			Broadphase.AxisOrder = dSAP_AXES_XZY;
+		else if(Axes == "yxz")
+			Broadphase.AxisOrder = dSAP_AXES_YXZ;
+		else if(Axes == "yzx")
+			Broadphase.AxisOrder = dSAP_AXES_YZX;
+		else if(Axes == "zxy")
+			Broadphase.AxisOrder = dSAP_AXES_ZXY;
+		else if(Axes == "zyx")
+			Broadphase.AxisOrder = dSAP_AXES_ZYX;
+		else {
+			Log.Write("Invalid broadphase axes: %s", Axes.c_str());
+			return 0;
+		}
+	}
+	else if(Type == "quadtree") {
+		Broadphase.Type = _Broadphase::BROADPHASE_QUADTREE;
+		BroadphaseElement->QueryIntAttribute("depth", &Broadphase.Depth);
+
+		// Get bounds
+		Element = BroadphaseElement->FirstChildElement("center");
+		if(Element) {
+			Element->QueryFloatAttribute("x", &Broadphase.Center[0]);
+			Element->QueryFloatAttribute("y", &Broadphase.Center[1]);
+			Element->QueryFloatAttribute("z", &Broadphase.Center[2]);
+		}
+		Element = BroadphaseElement->FirstChildElement("extents");
+		if(Element) {
+			Element->QueryFloatAttribute("x", &Broadphase.Extents[0]);
+			Element->QueryFloatAttribute("y", &Broadphase.Extents[1]);
+			Element->QueryFloatAttribute("z", &Broadphase.Extents[2]);
+		}
+
+		if(Broadphase.Depth < 1) {
+			Log.Write("Broadphase depth must be at least 1");
+			return 0;
+		}
+	}
+	else {
+		Log.Write("Invalid broadphase type: %s", Type.c_str());
+		return 0;
+	}
+
+	return 1;
+}
+
 // Processes a template tag
 int _Level::GetTemplateProperties(XMLElement *TemplateElement, _Template &Template) {
 	XMLElement *Element;
@@ -495,6 +635,9 @@ int _Level::GetTemplateProperties(XMLElement *TemplateElement, _Template &Templa
 				}
 			}
 		}
+
+		// Collide against height samples instead of a trimesh
+		Element->QueryIntAttribute("heightfield", &Template.HeightField);
 	}
 
 	// Get physical attributes
@@ -820,19 +963,19 @@ _Object *_Level::CreateObject(const _ObjectSpawn &Object) {
 	if(Replay.IsRecording() && Object.Template->TemplateID != -1) {
 
 		// Write replay information
-		std::fstream &ReplayFile = Replay.GetFile();
+		_ReplayWriter &ReplayWriter = Replay.GetWriter();
 		Replay.WriteEvent(_Replay::PACKET_CREATE);
-		ReplayFile.write((char *)&Object.Template->TemplateID, sizeof(Object.Template->TemplateID));
-		ReplayFile.write((char *)&NewObject->GetID(), sizeof(NewObject->GetID()));
+		ReplayWriter.Write((char *)&Object.Template->TemplateID, sizeof(Object.Template->TemplateID));
+		ReplayWriter.Write((char *)&NewObject->GetID(), sizeof(NewObject->GetID()));
 		if(Object.Template->Type == _Object::PLANE) {
-			ReplayFile.put(1);
-			ReplayFile.write((char *)&Object.Plane, sizeof(float) * 4);
+			ReplayWriter.Put(1);
+			ReplayWriter.Write((char *)&Object.Plane, sizeof(float) * 4);
 		}
 		else {
-			ReplayFile.put(0);
-			ReplayFile.write((char *)&Object.Position, sizeof(float) * 3);
+			ReplayWriter.Put(0);
+			ReplayWriter.Write((char *)&Object.Position, sizeof(float) * 3);
 		}
-		ReplayFile.write((char *)&Object.Rotation, sizeof(float) * 3);
+		ReplayWriter.Write((char *)&Object.Rotation, sizeof(float) * 3);
 	}
 
 	return NewObject;
@@ -29,6 +29,7 @@ class _Object;
 struct _Template;
 struct _ObjectSpawn;
 struct _ConstraintSpawn;
+struct _Broadphase;
 
 // Handle user data from .irr file
 class _UserDataLoader : public irr::scene::ISceneUserDataSerializer {
@@ -55,6 +56,7 @@ class _Level {
 		// Templates
 		_Template *GetTemplate(const std::string &Name);
 		_Template *GetTemplateFromID(int ID);
+		const std::vector<_Template *> &GetTemplates() const { return Templates; }
 
 		// Scripts
 		void RunScripts();
@@ -72,6 +74,7 @@ class _Level {
 	private:
 
 		// Loading
+		int GetBroadphaseProperties(tinyxml2::XMLElement *BroadphaseElement, _Broadphase &Broadphase);
 		int GetTemplateProperties(tinyxml2::XMLElement *TemplateElement, _Template &Template);
 		int GetObjectSpawnProperties(tinyxml2::XMLElement *ObjectElement, _ObjectSpawn &ObjectSpawn);
 		int GetConstraintSpawnProperties(tinyxml2::XMLElement *ConstraintElement, _ConstraintSpawn &ConstraintSpawn);
@@ -51,7 +51,8 @@ void _Log::Write(const char *Line, ...) {
 	vsnprintf(Buffer, 1024, Line, ArgumentList);
 	va_end(ArgumentList);
 
-	// Write line
+	// Write line, loader threads also write errors
+	std::lock_guard<std::mutex> Lock(Mutex);
 	std::cout << Buffer << std::endl;
 	FileStream << Buffer << std::endl;
 }
@@ -17,6 +17,7 @@
 *******************************************************************************/
 #pragma once
 #include <fstream>
+#include <mutex>
 
 // Classes
 class _Log {
@@ -31,6 +32,7 @@ class _Log {
 	private:
 
 		std::ofstream FileStream;
+		std::mutex Mutex;
 
 };
 
@@ -21,7 +21,7 @@ int main(int ArgumentCount, char **Arguments) {
 
 	// Initialize the game
 	if(!Framework.Init(ArgumentCount, Arguments))
-		return 0;
+		return Framework.GetExitCode();
 
 	// Main game loop
 	while(!Framework.IsDone()) {
@@ -32,5 +32,5 @@ int main(int ArgumentCount, char **Arguments) {
 	// Shut down the system
 	Framework.Close();
 
-	return 0;
+	return Framework.GetExitCode();
 }
@@ -0,0 +1,92 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <mappedfile.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// Map a file into memory
+bool _MappedFile::Open(const std::string &Path) {
+	Close();
+
+#ifdef _WIN32
+	HANDLE FileHandle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(FileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER FileSize;
+	if(!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart == 0) {
+		CloseHandle(FileHandle);
+		return false;
+	}
+
+	HANDLE MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(FileHandle);
+	if(!MappingHandle)
+		return false;
+
+	Data = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(MappingHandle);
+	if(!Data)
+		return false;
+
+	Size = (size_t)FileSize.QuadPart;
+#else
+	int FileDescriptor = open(Path.c_str(), O_RDONLY);
+	if(FileDescriptor == -1)
+		return false;
+
+	struct stat FileStat;
+	if(fstat(FileDescriptor, &FileStat) == -1 || !S_ISREG(FileStat.st_mode) || FileStat.st_size == 0) {
+		close(FileDescriptor);
+		return false;
+	}
+
+	void *Mapping = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+	close(FileDescriptor);
+	if(Mapping == MAP_FAILED)
+		return false;
+
+	Data = Mapping;
+	Size = (size_t)FileStat.st_size;
+#endif
+
+	return true;
+}
+
+// Unmap file
+void _MappedFile::Close() {
+	if(!Data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(Data);
+#else
+	munmap(Data, Size);
+#endif
+
+	Data = nullptr;
+	Size = 0;
+}
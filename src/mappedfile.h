@@ -0,0 +1,44 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class _MappedFile {
+
+	public:
+
+		_MappedFile() : Data(nullptr), Size(0) { }
+		~_MappedFile() { Close(); }
+
+		bool Open(const std::string &Path);
+		void Close();
+		bool IsOpen() const { return Data != nullptr; }
+
+		const char *GetData() const { return (const char *)Data; }
+		size_t GetSize() const { return Size; }
+
+	private:
+
+		void *Data;
+		size_t Size;
+
+};
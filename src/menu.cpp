@@ -28,6 +28,7 @@
 #include <save.h>
 #include <audio.h>
 #include <physics.h>
+#include <profiler.h>
 #include <states/viewreplay.h>
 #include <states/play.h>
 #include <states/null.h>
@@ -91,16 +92,6 @@ enum GUIElements {
 	WIN_RESTARTLEVEL, WIN_NEXTLEVEL, WIN_SAVEREPLAY, WIN_MAINMENU,
 };
 
-// Compare function for sorting replays by timestamp
-bool CompareReplaysTimestamp(const _ReplayInfo &Left, const _ReplayInfo &Right) {
-	return Left.Timestamp > Right.Timestamp;
-}
-
-// Compare function for sorting replays by level, then timestamp
-bool CompareReplaysLevel(const _ReplayInfo &Left, const _ReplayInfo &Right) {
-	return Left.LevelName < Right.LevelName || (Left.LevelName == Right.LevelName && Left.Timestamp > Right.Timestamp);
-}
-
 // Handle action inputs
 bool _Menu::HandleAction(int InputType, int Action, float Value) {
 	if(Input.HasJoystick())
@@ -317,7 +308,8 @@ void _Menu::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIElement *Ele
 						Interface.SetShortMessage("Sorted by date", INTERFACE_SHORTMESSAGE_X, INTERFACE_SHORTMESSAGE_Y);
 					else if(ReplaySort == SORT_LEVELNAME)
 						Interface.SetShortMessage("Sorted by level", INTERFACE_SHORTMESSAGE_X, INTERFACE_SHORTMESSAGE_Y);
-					InitReplays(true);
+					StartOffset = 0;
+					InitReplays(false);
 				break;
 				case REPLAYS_DELETE: {
 
@@ -330,10 +322,11 @@ void _Menu::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIElement *Ele
 						// Remove file
 						std::string FilePath = Save.ReplayPath + FileName;
 						remove(FilePath.c_str());
+						Save.RemoveReplay(FileName);
 
 						// Refresh screen
 						Interface.SetShortMessage("Replay deleted", INTERFACE_SHORTMESSAGE_X, INTERFACE_SHORTMESSAGE_Y);
-						InitReplays(true);
+						InitReplays(false);
 					}
 				}
 				break;
@@ -782,62 +775,41 @@ void _Menu::InitReplays(bool LoadReplays) {
 	// Text
 	AddMenuText(Interface.GetPositionPercent(0.5, 0.1), L"Replays");
 
-	// Load replay files
-	if(LoadReplays) {
-
-		// Change directories
-		std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
-		irrFile->changeWorkingDirectoryTo(Save.ReplayPath.c_str());
-
-		// Clear list
-		ReplayFiles.clear();
-
-		// Get a list of replays
-		io::IFileList *FileList = irrFile->createFileList();
-		uint32_t FileCount = FileList->getFileCount();
-		for(uint32_t i = 0; i < FileCount; i++) {
-			if(!FileList->isDirectory(i) && FileList->getFileName(i).find(".replay") != -1) {
-
-				// Load header
-				bool Loaded = Replay.LoadReplay(FileList->getFileName(i).c_str(), true);
-				if(Loaded && Replay.GetVersion() == REPLAY_VERSION && Replay.GetTimeStep() == PHYSICS_TIMESTEP) {
-					char Buffer[256];
-
-					// Get level info
-					Level.Init(Replay.GetLevelName(), true);
-					if(Level.LevelVersion > Replay.GetLevelVersion())
-						continue;
-
-					// Get replay info
-					_ReplayInfo ReplayInfo;
-					ReplayInfo.Filename = FileList->getFileName(i).c_str();
-					ReplayInfo.Description = Replay.GetDescription();
-					ReplayInfo.LevelName = Level.LevelName;
-					ReplayInfo.LevelNiceName = Level.LevelNiceName;
-					ReplayInfo.Autosave = Replay.GetAutosave();
-					ReplayInfo.Won = Replay.GetWon();
-					ReplayInfo.Timestamp = Replay.GetTimestamp();
-					ReplayInfo.Platform = Replay.GetPlatform();
-
-					// Date
-					strftime(Buffer, 32, "%Y-%m-%d %H:%M:%S", localtime(&Replay.GetTimestamp()));
-					ReplayInfo.Date = Buffer;
-
-					// Get time string
-					Interface.ConvertSecondsToString(Replay.GetFinishTime(), Buffer);
-					ReplayInfo.FinishTime = Buffer;
-					ReplayFiles.push_back(ReplayInfo);
-				}
-			}
-		}
-		FileList->drop();
-		irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
-
-		// Sort replays
-		if(ReplaySort == SORT_TIMESTAMP)
-			std::sort(ReplayFiles.begin(), ReplayFiles.end(), CompareReplaysTimestamp);
-		else if(ReplaySort == SORT_LEVELNAME)
-			std::sort(ReplayFiles.begin(), ReplayFiles.end(), CompareReplaysLevel);
+	// Sync catalog with replay directory
+	if(LoadReplays)
+		Save.UpdateReplayCatalog();
+
+	// Keep page in range
+	ReplayCount = (uint32_t)Save.GetReplayCount();
+	while(StartOffset > 0 && StartOffset >= ReplayCount)
+		StartOffset = StartOffset >= REPLAY_SCROLL_AMOUNT ? StartOffset - REPLAY_SCROLL_AMOUNT : 0;
+
+	// Get current page
+	std::vector<_ReplayCatalogEntry> Page;
+	Save.GetReplayPage(ReplaySort == SORT_LEVELNAME, StartOffset, REPLAY_DISPLAY_COUNT, Page);
+	ReplayFiles.clear();
+	for(const auto &Entry : Page) {
+		char Buffer[256];
+
+		// Get replay info
+		_ReplayInfo ReplayInfo;
+		ReplayInfo.Filename = Entry.File;
+		ReplayInfo.Description = Entry.Description;
+		ReplayInfo.LevelName = Entry.LevelFile;
+		ReplayInfo.LevelNiceName = Entry.LevelNiceName;
+		ReplayInfo.Autosave = Entry.Autosave;
+		ReplayInfo.Won = Entry.Won;
+		ReplayInfo.Timestamp = (int)Entry.Timestamp;
+		ReplayInfo.Platform = Entry.Platform;
+
+		// Date
+		strftime(Buffer, 32, "%Y-%m-%d %H:%M:%S", localtime(&Entry.Timestamp));
+		ReplayInfo.Date = Buffer;
+
+		// Get time string
+		Interface.ConvertSecondsToString(Entry.FinishTime, Buffer);
+		ReplayInfo.FinishTime = Buffer;
+		ReplayFiles.push_back(ReplayInfo);
 	}
 
 	// Calculate layout
@@ -851,38 +823,30 @@ void _Menu::InitReplays(bool LoadReplays) {
 
 	// Add replay buttons
 	uint32_t ReplayIndex = 0;
-	uint32_t ReplayCount = 0;
 	for(const auto &ReplayInfo : ReplayFiles) {
-		if(ReplayCount >= StartOffset) {
-
-			// Add button
-			gui::IGUIButton *LevelButton = irrGUI->addButton(
-				Interface.GetCenteredRectPercent(
-					StartX + Column * SpacingX,
-					StartY + Row * SpacingY,
-					BUTTON_LEVEL_SIZE,
-					BUTTON_LEVEL_SIZE
-				),
-				CurrentLayout,
-				REPLAY_LEVELID + ReplayIndex + StartOffset
-			);
-			LevelButton->setImage(irrDriver->getTexture((Framework.GetWorkingPath() + "levels/" + ReplayInfo.LevelName + "/icon.jpg").c_str()));
-			LevelButton->setScaleImage(true);
-
-			// Update columns and rows
-			Column++;
-			if(Column >= REPLAY_COLUMNS) {
-				Column = 0;
-				Row++;
-			}
 
-			// Cap display count
-			ReplayIndex++;
-			if(ReplayIndex >= REPLAY_DISPLAY_COUNT)
-				break;
+		// Add button
+		gui::IGUIButton *LevelButton = irrGUI->addButton(
+			Interface.GetCenteredRectPercent(
+				StartX + Column * SpacingX,
+				StartY + Row * SpacingY,
+				BUTTON_LEVEL_SIZE,
+				BUTTON_LEVEL_SIZE
+			),
+			CurrentLayout,
+			REPLAY_LEVELID + ReplayIndex
+		);
+		LevelButton->setImage(irrDriver->getTexture((Framework.GetWorkingPath() + "levels/" + ReplayInfo.LevelName + "/icon.jpg").c_str()));
+		LevelButton->setScaleImage(true);
+
+		// Update columns and rows
+		Column++;
+		if(Column >= REPLAY_COLUMNS) {
+			Column = 0;
+			Row++;
 		}
 
-		ReplayCount++;
+		ReplayIndex++;
 	}
 
 	// Page buttons
@@ -1292,6 +1256,7 @@ void _Menu::Update(float FrameTime) {
 
 // Draws the current state
 void _Menu::Draw() {
+	_ProfileScope Scope(_Profiler::GUI_DRAW);
 	CurrentLayout->draw();
 	irrGUI->drawAll();
 
@@ -1582,10 +1547,10 @@ void _Menu::ReplayScrollUp() {
 
 // Scroll the replay list down
 void _Menu::ReplayScrollDown() {
-	if(ReplayFiles.size() < REPLAY_SCROLL_AMOUNT)
+	if(ReplayCount < REPLAY_SCROLL_AMOUNT)
 		return;
 
-	if(StartOffset < ReplayFiles.size() - REPLAY_SCROLL_AMOUNT)
+	if(StartOffset < ReplayCount - REPLAY_SCROLL_AMOUNT)
 		StartOffset += REPLAY_SCROLL_AMOUNT;
 
 	InitReplays(false);
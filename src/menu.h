@@ -78,6 +78,7 @@ class _Menu {
 			CurrentLayout = 0;
 			SelectedElement = nullptr;
 			StartOffset = 0;
+			ReplayCount = 0;
 			ReplaySort = SORT_TIMESTAMP;
 		}
 
@@ -126,8 +127,9 @@ class _Menu {
 		bool FirstStateLoad;
 		irr::gui::IGUIElement *CurrentLayout;
 
-		// Replays
+		// Replays, only the current page is loaded from the catalog
 		std::vector<_ReplayInfo> ReplayFiles;
+		uint32_t ReplayCount;
 		irr::gui::IGUIElement *SelectedElement;
 		int ReplaySort;
 		uint32_t StartOffset;
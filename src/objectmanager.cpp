@@ -19,7 +19,12 @@
 #include <replay.h>
 #include <level.h>
 #include <physics.h>
+#include <profiler.h>
 #include <objects/object.h>
+#include <objects/template.h>
+#include <objects/plane.h>
+#include <objects/orb.h>
+#include <algorithm>
 
 using namespace irr;
 
@@ -27,7 +32,8 @@ _ObjectManager ObjectManager;
 
 // Constructor
 _ObjectManager::_ObjectManager() :
-	NextObjectID(0) {
+	NextObjectID(0),
+	DuplicateIDs(0) {
 
 }
 
@@ -57,11 +63,96 @@ _Object *_ObjectManager::AddObject(_Object *Object) {
 		NextObjectID++;
 
 		Objects.push_back(Object);
+		AddToIndex(std::prev(Objects.end()));
+		if(Object->GetNode() && Object->GetBody() && Object->GetGeometry())
+			Transforms.Add(Object);
+		if(Object->GetType() == _Object::ZONE)
+			Zones.push_back(Object);
 	}
 
 	return Object;
 }
 
+// Changes the replay ID of an object
+void _ObjectManager::SetObjectID(_Object *Object, uint16_t ID) {
+	if(Object->GetID() == ID)
+		return;
+
+	// Find position in object list
+	auto Iterator = Objects.end();
+	const _ObjectSlot &Slot = ObjectSlots[Object->GetID()];
+	if(Slot.Object == Object)
+		Iterator = Slot.Iterator;
+	else
+		Iterator = std::find(Objects.begin(), Objects.end(), Object);
+
+	RemoveID(Object);
+	Object->SetID(ID);
+	AddID(Iterator);
+}
+
+// Adds an object to the lookup indexes
+void _ObjectManager::AddToIndex(std::list<_Object *>::iterator Iterator) {
+	AddID(Iterator);
+	ObjectNames[(*Iterator)->GetName()].push_back(*Iterator);
+}
+
+// Removes an object from the lookup indexes
+void _ObjectManager::RemoveFromIndex(_Object *Object) {
+	RemoveID(Object);
+
+	auto NameIterator = ObjectNames.find(Object->GetName());
+	std::vector<_Object *> &Named = NameIterator->second;
+	Named.erase(std::find(Named.begin(), Named.end(), Object));
+	if(Named.empty())
+		ObjectNames.erase(NameIterator);
+}
+
+// Adds an object to its ID slot, objects that share an ID wait until the first one is removed
+void _ObjectManager::AddID(std::list<_Object *>::iterator Iterator) {
+	uint16_t ID = (*Iterator)->GetID();
+	if(ID >= ObjectSlots.size())
+		ObjectSlots.resize(ID + 1);
+
+	_ObjectSlot &Slot = ObjectSlots[ID];
+	if(Slot.Object) {
+
+		// Keep the slot pointing at the object created first
+		if(std::find(Objects.begin(), Iterator, Slot.Object) == Iterator) {
+			Slot.Object = *Iterator;
+			Slot.Iterator = Iterator;
+		}
+		DuplicateIDs++;
+	}
+	else {
+		Slot.Object = *Iterator;
+		Slot.Iterator = Iterator;
+	}
+}
+
+// Removes an object from its ID slot
+void _ObjectManager::RemoveID(_Object *Object) {
+	uint16_t ID = Object->GetID();
+	_ObjectSlot &Slot = ObjectSlots[ID];
+	if(Slot.Object != Object) {
+		DuplicateIDs--;
+		return;
+	}
+
+	// Move the next object with the same ID into the slot
+	Slot.Object = nullptr;
+	if(DuplicateIDs) {
+		for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ++Iterator) {
+			if(*Iterator != Object && (*Iterator)->GetID() == ID) {
+				Slot.Object = *Iterator;
+				Slot.Iterator = Iterator;
+				DuplicateIDs--;
+				break;
+			}
+		}
+	}
+}
+
 // Deletes an object
 void _ObjectManager::DeleteObject(_Object *Object) {
 
@@ -71,13 +162,11 @@ void _ObjectManager::DeleteObject(_Object *Object) {
 // Gets an object by name
 _Object *_ObjectManager::GetObjectByName(const std::string &Name) {
 
-	// Search through object list
-	for(auto &Iterator : Objects) {
-		if(Iterator->GetName() == Name)
-			return Iterator;
-	}
+	auto Iterator = ObjectNames.find(Name);
+	if(Iterator == ObjectNames.end())
+		return nullptr;
 
-	return nullptr;
+	return Iterator->second.front();
 }
 
 // Gets an object by type
@@ -94,6 +183,8 @@ _Object *_ObjectManager::GetObjectByType(int Type) {
 
 // Deletes all of the objects
 void _ObjectManager::ClearObjects() {
+	FlushDeletedObjects();
+	Transforms.Clear();
 
 	// Delete constraints first
 	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ) {
@@ -113,43 +204,60 @@ void _ObjectManager::ClearObjects() {
 	}
 
 	Objects.clear();
+	Zones.clear();
+	ObjectSlots.clear();
+	ObjectNames.clear();
+	DuplicateIDs = 0;
 	NextObjectID = 0;
 }
 
 // Performs start frame operations on the objects
 void _ObjectManager::BeginFrame() {
+	Transforms.BeginStep();
+}
 
-	for(auto &Iterator : Objects)
-		Iterator->BeginFrame();
+// Destroys objects removed during the frame
+void _ObjectManager::FlushDeletedObjects() {
+	for(auto &Object : DeletedObjects)
+		delete Object;
+
+	DeletedObjects.clear();
 }
 
 // Performs end frame operations on the objects
 void _ObjectManager::EndFrame() {
-	bool UpdateReplay = Replay.NeedsPacket();
-	uint16_t ReplayMovementCount = 0;
+	_ProfileScope Scope(_Profiler::OBJECTS_END_FRAME);
+	FlushDeletedObjects();
 
-	// Get replay update count
-	for(auto &Iterator : Objects) {
+	// Copy transforms from physics and note objects that moved for replays
+	Transforms.EndStep();
+
+	// Perform specific end-of-frame operations
+	for(auto &Zone : Zones)
+		Zone->EndFrame();
 
-		// Perform specific end-of-frame operations
-		Iterator->EndFrame();
+	if(!Replay.NeedsPacket())
+		return;
 
-		// Get a count for all the objects that need replay events recorded
-		if(Iterator->ReadyForReplayUpdate()) {
+	// Objects are flagged only in the step they moved and written the same frame, so they are all in the active range
+	size_t ActiveCount = Transforms.GetActiveCount();
+	uint16_t ReplayMovementCount = 0;
+	for(size_t i = 0; i < ActiveCount; i++) {
+		if(Transforms.GetObject(i)->ReadyForReplayUpdate())
 			ReplayMovementCount++;
-		}
 	}
 
 	// Write a replay movement packet
-	if(UpdateReplay && ReplayMovementCount > 0) {
+	if(ReplayMovementCount > 0) {
 
 		// Write replay event
-		std::fstream &ReplayFile = Replay.GetFile();
+		_ReplayWriter &ReplayWriter = Replay.GetWriter();
 		Replay.WriteEvent(_Replay::PACKET_MOVEMENT);
-		ReplayFile.write((char *)&ReplayMovementCount, sizeof(ReplayMovementCount));
+		ReplayWriter.Write((char *)&ReplayMovementCount, sizeof(ReplayMovementCount));
 
 		// Write the updated objects
-		for(auto &Iterator : Objects) {
+		for(size_t i = 0; i < ActiveCount; i++) {
+			_Object *Iterator = Transforms.GetObject(i);
 
 			// Save the replay
 			if(Iterator->ReadyForReplayUpdate()) {
@@ -157,17 +265,213 @@ void _ObjectManager::EndFrame() {
 				glm::vec3 Position = Iterator->GetPosition();
 
 				// Write object update
-				ReplayFile.write((char *)&Iterator->GetID(), sizeof(Iterator->GetID()));
-				ReplayFile.write((char *)&Position[0], sizeof(float) * 3);
-				ReplayFile.write((char *)&Rotation[0], sizeof(float) * 3);
+				ReplayWriter.Write((char *)&Iterator->GetID(), sizeof(Iterator->GetID()));
+				ReplayWriter.Write((char *)&Position[0], sizeof(float) * 3);
+				ReplayWriter.Write((char *)&Rotation[0], sizeof(float) * 3);
 				Iterator->WroteReplayPacket();
 			}
 		}
 	}
+
+	// Write full world state periodically for seeking
+	if(Replay.NeedsKeyframe())
+		WriteKeyframe();
+}
+
+// Objects created from templates are recorded in keyframes. Constraints are left out because keyframes are only
+// loaded while viewing replays, where physics is disabled and constraints create no joints.
+static bool IsKeyframeObject(const _Object *Object) {
+	const _Template *Template = Object->GetTemplate();
+	if(!Template || Template->TemplateID == -1)
+		return false;
+
+	switch(Object->GetType()) {
+		case _Object::CONSTRAINT_FIXED:
+		case _Object::CONSTRAINT_HINGE:
+		case _Object::CONSTRAINT_D6:
+			return false;
+	}
+
+	return true;
+}
+
+// Writes every replay object's template and orientation to the replay
+void _ObjectManager::WriteKeyframe() {
+
+	// Get size of keyframe data
+	uint32_t Size = sizeof(int16_t) * 2;
+	int16_t ObjectCount = 0;
+	int16_t OrbCount = 0;
+	for(auto &Iterator : Objects) {
+		if(!IsKeyframeObject(Iterator))
+			continue;
+
+		ObjectCount++;
+		Size += sizeof(int16_t) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(float) * 3;
+		if(Iterator->GetType() == _Object::PLANE)
+			Size += sizeof(float) * 4;
+		else
+			Size += sizeof(float) * 3;
+
+		if(Iterator->GetType() == _Object::ORB && static_cast<_Orb *>(Iterator)->GetState() != _Orb::ORBSTATE_NORMAL) {
+			OrbCount++;
+			Size += sizeof(uint16_t) + sizeof(uint8_t) + sizeof(float) * 2;
+		}
+	}
+
+	// Write replay event
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
+	Replay.WriteKeyframeEvent();
+	ReplayWriter.Write((char *)&Size, sizeof(Size));
+
+	// Write objects
+	ReplayWriter.Write((char *)&ObjectCount, sizeof(ObjectCount));
+	for(auto &Iterator : Objects) {
+		if(!IsKeyframeObject(Iterator))
+			continue;
+
+		const _Template *Template = Iterator->GetTemplate();
+		ReplayWriter.Write((char *)&Template->TemplateID, sizeof(Template->TemplateID));
+		ReplayWriter.Write((char *)&Iterator->GetID(), sizeof(Iterator->GetID()));
+		if(Iterator->GetType() == _Object::PLANE) {
+			ReplayWriter.Put(1);
+			ReplayWriter.Write((char *)&static_cast<_Plane *>(Iterator)->GetPlane()[0], sizeof(float) * 4);
+		}
+		else {
+			glm::vec3 Position = Iterator->GetPosition();
+			ReplayWriter.Put(0);
+			ReplayWriter.Write((char *)&Position[0], sizeof(float) * 3);
+		}
+
+		glm::vec3 Rotation = Physics.QuaternionToEuler(Iterator->GetQuaternion());
+		ReplayWriter.Write((char *)&Rotation[0], sizeof(float) * 3);
+	}
+
+	// Write orb states
+	ReplayWriter.Write((char *)&OrbCount, sizeof(OrbCount));
+	for(auto &Iterator : Objects) {
+		if(!IsKeyframeObject(Iterator) || Iterator->GetType() != _Object::ORB)
+			continue;
+
+		_Orb *Orb = static_cast<_Orb *>(Iterator);
+		if(Orb->GetState() == _Orb::ORBSTATE_NORMAL)
+			continue;
+
+		float OrbTime = Orb->GetOrbTime();
+		float Length = Orb->GetDeactivateLength();
+		ReplayWriter.Write((char *)&Orb->GetID(), sizeof(Orb->GetID()));
+		ReplayWriter.Put((char)Orb->GetState());
+		ReplayWriter.Write((char *)&OrbTime, sizeof(OrbTime));
+		ReplayWriter.Write((char *)&Length, sizeof(Length));
+	}
+}
+
+// Returns true if every record in a keyframe fits inside its payload
+static bool IsKeyframeValid(const _ReplayEventView &Event) {
+	if(Event.Type != _Replay::PACKET_KEYFRAME)
+		return false;
+
+	// Skip payload size
+	size_t Offset = sizeof(uint32_t);
+
+	// Check objects
+	int16_t ObjectCount;
+	if(Offset + sizeof(ObjectCount) > Event.PayloadSize)
+		return false;
+	Event.Read(Offset, ObjectCount);
+	Offset += sizeof(ObjectCount);
+	if(ObjectCount < 0)
+		return false;
+
+	for(int i = 0; i < ObjectCount; i++) {
+		uint8_t PositionType;
+		if(Offset + 5 > Event.PayloadSize)
+			return false;
+		Event.Read(Offset + 4, PositionType);
+		Offset += 5 + sizeof(float) * (PositionType == 1 ? 4 : 3) + sizeof(float) * 3;
+		if(Offset > Event.PayloadSize)
+			return false;
+	}
+
+	// Check orb states
+	int16_t OrbCount;
+	if(Offset + sizeof(OrbCount) > Event.PayloadSize)
+		return false;
+	Event.Read(Offset, OrbCount);
+	Offset += sizeof(OrbCount);
+
+	return OrbCount >= 0 && Offset + (size_t)OrbCount * 11 <= Event.PayloadSize;
+}
+
+// Replaces all objects with the ones stored in a keyframe, returns false if the keyframe is malformed
+bool _ObjectManager::LoadKeyframe(const _ReplayEventView &Event) {
+	if(!IsKeyframeValid(Event))
+		return false;
+
+	ClearObjects();
+
+	// Skip payload size
+	size_t Offset = sizeof(uint32_t);
+
+	// Create objects
+	int16_t ObjectCount;
+	Event.Read(Offset, ObjectCount);
+	Offset += sizeof(ObjectCount);
+	for(int i = 0; i < ObjectCount; i++) {
+		_ObjectSpawn Spawn;
+
+		int16_t TemplateID;
+		uint16_t ObjectID;
+		uint8_t PositionType;
+		Event.Read(Offset, TemplateID);
+		Event.Read(Offset + 2, ObjectID);
+		Event.Read(Offset + 4, PositionType);
+		Offset += 5;
+		Spawn.Template = Level.GetTemplateFromID(TemplateID);
+
+		if(PositionType == 1) {
+			Event.Read(Offset, Spawn.Plane);
+			Offset += sizeof(float) * 4;
+		}
+		else {
+			Event.Read(Offset, Spawn.Position);
+			Offset += sizeof(float) * 3;
+		}
+		Event.Read(Offset, Spawn.Rotation);
+		Offset += sizeof(float) * 3;
+
+		if(Spawn.Template != nullptr) {
+			_Object *NewObject = Level.CreateObject(Spawn);
+			if(NewObject)
+				SetObjectID(NewObject, ObjectID);
+		}
+	}
+
+	// Restore orb states
+	int16_t OrbCount;
+	Event.Read(Offset, OrbCount);
+	Offset += sizeof(OrbCount);
+	for(int i = 0; i < OrbCount; i++) {
+		uint16_t ObjectID;
+		uint8_t State;
+		float OrbTime, Length;
+		Event.Read(Offset, ObjectID);
+		Event.Read(Offset + 2, State);
+		Event.Read(Offset + 3, OrbTime);
+		Event.Read(Offset + 7, Length);
+		Offset += 11;
+
+		_Object *Object = GetObjectByID(ObjectID);
+		if(Object && Object->GetType() == _Object::ORB)
+			static_cast<_Orb *>(Object)->SetDeactivationState(State, OrbTime, Length);
+	}
+
+	return true;
 }
 
 // Updates all objects in the scene
 void _ObjectManager::Update(float FrameTime) {
+	_ProfileScope Scope(_Profiler::OBJECTS_UPDATE);
 
 	// Update objects
 	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ) {
@@ -181,12 +485,17 @@ void _ObjectManager::Update(float FrameTime) {
 
 			// Write delete events to the replay
 			if(Replay.IsRecording()) {
-				std::fstream &ReplayFile = Replay.GetFile();
+				_ReplayWriter &ReplayWriter = Replay.GetWriter();
 				Replay.WriteEvent(_Replay::PACKET_DELETE);
-				ReplayFile.write((char *)&Object->GetID(), sizeof(Object->GetID()));
+				ReplayWriter.Write((char *)&Object->GetID(), sizeof(Object->GetID()));
 			}
 
-			delete Object;
+			// Destroy at the end of the frame
+			RemoveFromIndex(Object);
+			Transforms.Remove(Object);
+			if(Object->GetType() == _Object::ZONE)
+				Zones.erase(std::find(Zones.begin(), Zones.end(), Object));
+			DeletedObjects.push_back(Object);
 			Iterator = Objects.erase(Iterator);
 		}
 		else {
@@ -204,56 +513,37 @@ void _ObjectManager::UpdateReplay(float FrameTime) {
 		Iterator->UpdateReplay(FrameTime);
 }
 
-// Updates all objects in the scene from a replay file
-void _ObjectManager::UpdateFromReplay() {
-	core::vector3df Position, Rotation;
-
-	// Get replay stream and read object count
-	std::fstream &ReplayFile = Replay.GetFile();
-	int16_t ObjectCount;
-	ReplayFile.read((char *)&ObjectCount, sizeof(ObjectCount));
-
-	// Read first object
-	int16_t ObjectID;
-	ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-	ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-	ReplayFile.read((char *)&Rotation.X, sizeof(float) * 3);
-
-	// Loop through the rest of the objects
-	int UpdatedObjectCount = 0;
-	for(auto &Iterator : Objects) {
-		if(ObjectID == Iterator->GetID()) {
-			Iterator->SetPositionFromReplay(Position);
-			Iterator->GetNode()->setRotation(Rotation);
-
-			//printf("ObjectPacket ObjectID=%d Type=%d Position=%f %f %f Rotation=%f %f %f\n", ObjectID, Object->GetType(), Position.X, Position.Y, Position.Z, Rotation.X, Rotation.Y, Rotation.Z);
-			if(UpdatedObjectCount < ObjectCount - 1) {
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-				ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-				ReplayFile.read((char *)&Rotation.X, sizeof(float) * 3);
-			}
-
-			UpdatedObjectCount++;
+// Updates all objects in the scene from a replay movement event
+void _ObjectManager::UpdateFromReplay(const _ReplayEventView &Event) {
+	int ObjectCount = Event.GetMovementCount();
+	if(!ObjectCount)
+		return;
+
+	// Update each object in the packet
+	_ReplayMovementObject Movement;
+	for(int i = 0; i < ObjectCount; i++) {
+		Event.GetMovementObject(i, Movement);
+		_Object *Object = GetObjectByID(Movement.ObjectID);
+		if(Object) {
+			Object->SetPositionFromReplay(core::vector3df(Movement.Position[0], Movement.Position[1], Movement.Position[2]));
+			Object->GetNode()->setRotation(core::vector3df(Movement.Rotation[0], Movement.Rotation[1], Movement.Rotation[2]));
 		}
 	}
 }
 
 // Interpolate between last and current orientation for every object
 void _ObjectManager::InterpolateOrientations(float BlendFactor) {
-
-	for(auto &Iterator : Objects)
-		Iterator->InterpolateOrientation(BlendFactor);
+	_ProfileScope Scope(_Profiler::INTERPOLATE);
+	Transforms.Interpolate(BlendFactor);
+	Transforms.Scatter();
 }
 
 // Returns an object by an index, nullptr if no such index
 _Object *_ObjectManager::GetObjectByID(int ID) {
+	if(ID < 0 || ID >= (int)ObjectSlots.size())
+		return nullptr;
 
-	for(auto &Iterator : Objects) {
-		if(Iterator->GetID() == ID)
-			return Iterator;
-	}
-
-	return nullptr;
+	return ObjectSlots[ID].Object;
 }
 
 // Print all object orientations
@@ -265,12 +555,13 @@ void _ObjectManager::PrintObjectOrientations() {
 
 // Deletes an object by its ID
 void _ObjectManager::DeleteObjectByID(int ID) {
-
-	for(auto Iterator = Objects.begin(); Iterator != Objects.end(); ++Iterator) {
-		if((*Iterator)->GetID() == ID) {
-			delete (*Iterator);
-			Objects.erase(Iterator);
-			return;
-		}
-	}
+	_Object *Object = GetObjectByID(ID);
+	if(!Object)
+		return;
+
+	auto Iterator = ObjectSlots[ID].Iterator;
+	RemoveFromIndex(Object);
+	Transforms.Remove(Object);
+	delete Object;
+	Objects.erase(Iterator);
 }
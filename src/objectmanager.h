@@ -20,10 +20,22 @@
 // Libraries
 #include <string>
 #include <list>
+#include <unordered_map>
+#include <vector>
+#include <transformbuffer.h>
 #include <irrTypes.h>
 
 // Forward Declarations
 class _Object;
+struct _ReplayEventView;
+
+// Object with a replay ID and its position in the object list
+struct _ObjectSlot {
+	_ObjectSlot() : Object(nullptr) { }
+
+	_Object *Object;
+	std::list<_Object *>::iterator Iterator;
+};
 
 // Classes
 class _ObjectManager {
@@ -37,12 +49,15 @@ class _ObjectManager {
 
 		void Update(float FrameTime);
 		void UpdateReplay(float FrameTime);
-		void UpdateFromReplay();
+		void UpdateFromReplay(const _ReplayEventView &Event);
+		void WriteKeyframe();
+		bool LoadKeyframe(const _ReplayEventView &Event);
 		void InterpolateOrientations(float BlendFactor);
 		void BeginFrame();
 		void EndFrame();
 
 		_Object *AddObject(_Object *Object);
+		void SetObjectID(_Object *Object, uint16_t ID);
 		void DeleteObject(_Object *Object);
 		void DeleteObjectByID(int ID);
 		_Object *GetObjectByName(const std::string &Name);
@@ -52,13 +67,34 @@ class _ObjectManager {
 		void PrintObjectOrientations();
 		void ClearObjects();
 		size_t GetObjectCount() const { return Objects.size(); }
+		size_t GetActiveCount() const { return Transforms.GetActiveCount(); }
 		const std::list<_Object *> &GetObjects() const { return Objects; }
+		_TransformBuffer &GetTransforms() { return Transforms; }
 
 	private:
 
+		void FlushDeletedObjects();
+		void AddToIndex(std::list<_Object *>::iterator Iterator);
+		void RemoveFromIndex(_Object *Object);
+		void AddID(std::list<_Object *>::iterator Iterator);
+		void RemoveID(_Object *Object);
+
+		// Objects in creation order
 		std::list<_Object *> Objects;
+		std::vector<_Object *> DeletedObjects;
+
+		// Objects with end of frame operations, in creation order
+		std::vector<_Object *> Zones;
 		uint16_t NextObjectID;
 
+		// Transforms of objects with bodies and scene nodes
+		_TransformBuffer Transforms;
+
+		// Lookup indexes, each returns the first matching object in creation order
+		std::vector<_ObjectSlot> ObjectSlots;
+		std::unordered_map<std::string, std::vector<_Object *>> ObjectNames;
+		int DuplicateIDs;
+
 };
 
 // Singletons
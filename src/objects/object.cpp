@@ -17,10 +17,12 @@
 *******************************************************************************/
 #include <objects/object.h>
 #include <objects/template.h>
+#include <objectmanager.h>
 #include <config.h>
 #include <scripting.h>
 #include <physics.h>
 #include <log.h>
+#include <arena.h>
 #include <globals.h>
 #include <ode/collision.h>
 #include <ode/objects.h>
@@ -42,12 +44,12 @@ _Object::_Object(const _Template *Template) :
 	Timer(0.0f),
 	Lifetime(0.0f),
 	Node(nullptr),
-	LastPosition(0.0f, 0.0f, 0.0f),
-	LastRotation(1.0f, 0.0f, 0.0f, 0.0f),
 	DrawPosition(0.0f, 0.0f, 0.0f),
 	Body(nullptr),
 	Geometry(nullptr),
+	TransformIndex(-1),
 	NeedsReplayPacket(false),
+	CollisionCallback(-1),
 	TouchingGroundTimer(0.0f),
 	TouchingGround(false) {
 }
@@ -68,6 +70,16 @@ _Object::~_Object() {
 		dGeomDestroy(Geometry);
 }
 
+// Allocate from the arena for the object's type
+void *_Object::operator new(size_t Size) {
+	return ObjectArenas.Allocate(Size);
+}
+
+// Return memory to the arena for the object's type
+void _Object::operator delete(void *Pointer, size_t Size) {
+	ObjectArenas.Free(Pointer, Size);
+}
+
 // Print object position and rotation
 void _Object::PrintOrientation() {
 	if(!Body)
@@ -120,9 +132,11 @@ void _Object::Update(float FrameTime) {
 	if(Lifetime > 0.0f && Timer > Lifetime)
 		Deleted = true;
 
-	// Set touch timer
-	if(TouchingGround)
+	// Set touch timer from collisions in the last step
+	if(TouchingGround) {
 		TouchingGroundTimer = TOUCHING_GROUND_WINDOW;
+		TouchingGround = false;
+	}
 
 	// Update touch timer
 	TouchingGroundTimer -= FrameTime;
@@ -201,10 +215,12 @@ void _Object::SetProperties(const _ObjectSpawn &Object, bool SetTransform) {
 		dGeomSetData(Geometry, this);
 		dGeomSetCategoryBits(Geometry, Template->CollisionGroup);
 		dGeomSetCollideBits(Geometry, Template->CollisionMask);
+		if(!Body)
+			Physics.SetStatic(Geometry);
 	}
 
 	// Collision
-	CollisionCallback = Template->CollisionCallback;
+	CollisionCallback = Scripting.GetCallback(Template->CollisionCallback);
 }
 
 // Sets object properties
@@ -219,22 +235,12 @@ void _Object::SetProperties(const _ConstraintSpawn &Object) {
 	Lifetime = Template->Lifetime;
 }
 
-// Interpolate between last and current orientation
-void _Object::InterpolateOrientation(float BlendFactor) {
-	if(!Node || !Body)
-		return;
-
-	// Get current orientation
-	glm::vec3 CurrentPosition = GetPosition();
-	glm::quat CurrentRotation = GetQuaternion();
-
-	// Set node position
-	DrawPosition = CurrentPosition * BlendFactor + LastPosition * (1.0f - BlendFactor);
+// Set the scene node to an interpolated orientation
+void _Object::SetDrawTransform(const glm::vec3 &Position, const glm::quat &Rotation) {
+	DrawPosition = Position;
 	Node->setPosition(core::vector3df(DrawPosition[0], DrawPosition[1], DrawPosition[2]));
 
-	// Set node rotation
-	glm::quat DrawRotation = glm::mix(LastRotation, CurrentRotation, BlendFactor);
-	glm::vec3 EulerRotation = Physics.QuaternionToEuler(DrawRotation);
+	glm::vec3 EulerRotation = Physics.QuaternionToEuler(Rotation);
 	Node->setRotation(core::vector3df(EulerRotation[0], EulerRotation[1], EulerRotation[2]));
 }
 
@@ -263,7 +269,8 @@ void _Object::SetPosition(const glm::vec3 &Position) {
 	if(Geometry)
 		dGeomSetPosition(Geometry, Position[0], Position[1], Position[2]);
 
-	LastPosition = Position;
+	if(TransformIndex != -1)
+		ObjectManager.GetTransforms().SetPosition(this, Position);
 }
 
 // Set rotation from quaternion
@@ -272,7 +279,8 @@ void _Object::SetQuaternion(const glm::quat &Quaternion) {
 	if(Geometry)
 		dGeomSetQuaternion(Geometry, Rotation);
 
-	LastRotation = Quaternion;
+	if(TransformIndex != -1)
+		ObjectManager.GetTransforms().SetRotation(this, Quaternion);
 }
 
 // Get rotation
@@ -316,9 +324,13 @@ void _Object::HandleCollision(const _ObjectCollision &ObjectCollision) {
 			TouchingGround = true;
 	}
 
-	// Call collision handler
-	if(CollisionCallback.size())
-		Scripting.CallCollisionHandler(CollisionCallback, this, ObjectCollision.OtherObject);
+	// Call collision handler, or save it for the level's batched handler
+	if(CollisionCallback != -1) {
+		if(Scripting.IsBatchingCollisions())
+			Scripting.QueueCollision(ObjectCollision);
+		else
+			Scripting.CallCollisionHandler(CollisionCallback, this, ObjectCollision.OtherObject);
+	}
 }
 
 // Load a mesh file
@@ -336,24 +348,6 @@ irr::scene::ISceneNode *_Object::LoadMesh(const std::string &MeshFile) {
 	return irrScene->addAnimatedMeshSceneNode(AnimatedMesh);
 }
 
-// Resets the object state before the frame begins
-void _Object::BeginFrame() {
-	TouchingGround = false;
-	if(Body || Geometry) {
-		LastPosition = GetPosition();
-		LastRotation = GetQuaternion();
-	}
-}
-
-// Determines if the object moved
-void _Object::EndFrame() {
-
-	// Note changes for replays
-	if(Node && Body && !NeedsReplayPacket && !(LastPosition == GetPosition() && LastRotation == GetQuaternion())) {
-		NeedsReplayPacket = true;
-	}
-}
-
 // Update the graphic node position
 void _Object::SetPositionFromReplay(const irr::core::vector3df &Position) {
 	if(Node) {
@@ -56,18 +56,22 @@ class _Object {
 		_Object(const _Template *Template);
 		virtual ~_Object();
 
+		// Objects are allocated from arenas
+		static void *operator new(size_t Size);
+		static void operator delete(void *Pointer, size_t Size);
+
 		void PrintOrientation();
 
 		// Updates
 		virtual void Update(float FrameTime);
-		void BeginFrame();
-		virtual void EndFrame();
-		void InterpolateOrientation(float BlendFactor);
+		virtual void EndFrame() { }
+		void SetDrawTransform(const glm::vec3 &Position, const glm::quat &Rotation);
 
 		// Replays
 		virtual void UpdateReplay(float FrameTime);
 		bool ReadyForReplayUpdate() const { return NeedsReplayPacket; }
 		void WroteReplayPacket() { NeedsReplayPacket = false; }
+		void SetMoved() { NeedsReplayPacket = true; }
 		virtual void UpdateAudio(const glm::vec3 &Position, float Speed) { }
 
 		// Object properties
@@ -76,7 +80,7 @@ class _Object {
 		void SetLifetime(float Value) { Lifetime = Timer + Value; }
 		void SetSleep(int State);
 
-		std::string GetName() const { return Name; }
+		const std::string &GetName() const { return Name; }
 		bool GetDeleted() const { return Deleted; }
 		float GetLifetime() const { return Lifetime; }
 		int GetType() const { return Type; }
@@ -105,6 +109,9 @@ class _Object {
 
 		irr::scene::ISceneNode *GetNode() { return Node; }
 		dBodyID GetBody() { return Body; }
+		dGeomID GetGeometry() { return Geometry; }
+		void SetTransformIndex(int Value) { TransformIndex = Value; }
+		int GetTransformIndex() const { return TransformIndex; }
 
 		virtual void HandleCollision(const _ObjectCollision &ObjectCollision);
 		bool IsTouchingGround() const { return TouchingGroundTimer > 0.0f; }
@@ -131,17 +138,16 @@ class _Object {
 
 		// Physics and graphics
 		irr::scene::ISceneNode *Node;
-		glm::vec3 LastPosition;
-		glm::quat LastRotation;
 		glm::vec3 DrawPosition;
 		dBodyID Body;
 		dGeomID Geometry;
+		int TransformIndex;
 
 		// Replays
 		bool NeedsReplayPacket;
 
 		// Collision
-		std::string CollisionCallback;
+		int CollisionCallback;
 		float TouchingGroundTimer;
 		bool TouchingGround;
 
@@ -40,7 +40,7 @@ _Orb::_Orb(const _ObjectSpawn &Object) :
 	_Object(Object.Template),
 	Light(nullptr),
 	Sound(nullptr),
-	DeactivationCallback(""),
+	DeactivationCallback(-1),
 	State(ORBSTATE_NORMAL),
 	OrbTime(0.0f),
 	DeactivateLength(ORB_DEACTIVATETIME) {
@@ -98,8 +98,8 @@ _Orb::_Orb(const _ObjectSpawn &Object) :
 
 	// Set object properties
 	SetProperties(Object);
-	if(CollisionCallback == "")
-		CollisionCallback = "OnHitOrb";
+	if(CollisionCallback == -1)
+		CollisionCallback = Scripting.GetCallback("OnHitOrb");
 }
 
 // Destructor
@@ -117,19 +117,36 @@ void _Orb::StartDeactivation(const std::string &Callback, float Length) {
 
 	if(State == ORBSTATE_NORMAL) {
 		State = ORBSTATE_DEACTIVATING;
-		DeactivationCallback = Callback;
+		DeactivationCallback = Scripting.GetCallback(Callback);
 		DeactivateLength = Length;
 
 		// Save the event on the replay
 		if(Replay.IsRecording()) {
-			std::fstream &ReplayFile = Replay.GetFile();
+			_ReplayWriter &ReplayWriter = Replay.GetWriter();
 			Replay.WriteEvent(_Replay::PACKET_ORBDEACTIVATE);
-			ReplayFile.write((char *)&ID, sizeof(ID));
-			ReplayFile.write((char *)&DeactivateLength, sizeof(DeactivateLength));
+			ReplayWriter.Write((char *)&ID, sizeof(ID));
+			ReplayWriter.Write((char *)&DeactivateLength, sizeof(DeactivateLength));
 		}
 	}
 }
 
+// Restores the deactivation state from a replay keyframe
+void _Orb::SetDeactivationState(int Value, float Time, float Length) {
+	State = Value;
+	OrbTime = Time;
+	DeactivateLength = Length;
+
+	// Update glow, light and sound
+	if(State != ORBSTATE_NORMAL) {
+		if(State == ORBSTATE_DEACTIVATED) {
+			InnerNode->setVisible(false);
+			if(Sound)
+				Sound->SetGain(0.0f);
+		}
+		UpdateDeactivation(0.0f);
+	}
+}
+
 // Updates the orb
 void _Orb::Update(float FrameTime) {
 
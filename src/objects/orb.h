@@ -43,6 +43,9 @@ class _Orb : public _Object {
 		void StartDeactivation(const std::string &TCallback, float Length);
 		bool IsStillActive() const { return State == ORBSTATE_NORMAL; }
 		int GetState() const { return State; }
+		float GetOrbTime() const { return OrbTime; }
+		float GetDeactivateLength() const { return DeactivateLength; }
+		void SetDeactivationState(int Value, float Time, float Length);
 
 		void SetShape(const glm::vec3 &Shape) override;
 
@@ -59,7 +62,7 @@ class _Orb : public _Object {
 		_AudioSource *Sound;
 
 		// Deactivation
-		std::string DeactivationCallback;
+		int DeactivationCallback;
 		int State;
 		float OrbTime;
 		float DeactivateLength;
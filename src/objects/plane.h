@@ -34,6 +34,7 @@ class _Plane : public _Object {
 		glm::quat GetQuaternion() const override { return glm::quat(1, 0, 0, 0); }
 
 		void UpdateTransform();
+		const glm::vec4 &GetPlane() const { return Plane; }
 
 	private:
 
@@ -23,6 +23,7 @@
 #include <actions.h>
 #include <graphics.h>
 #include <config.h>
+#include <scripting.h>
 #include <objects/sphere.h>
 #include <objects/constraint.h>
 #include <objects/template.h>
@@ -94,8 +95,8 @@ _Player::_Player(const _ObjectSpawn &Object) :
 
 	// Set object properties
 	SetProperties(Object);
-	if(CollisionCallback == "")
-		CollisionCallback = "OnHitPlayer";
+	if(CollisionCallback == -1)
+		CollisionCallback = Scripting.GetCallback("OnHitPlayer");
 }
 
 // Destructor
@@ -46,6 +46,7 @@ _Template::_Template() {
 	AngularDamping = 0.003f * (100 * PHYSICS_TIMESTEP);
 	ERP = 0.2;
 	CFM = 0.0;
+	MaterialIndex = -1;
 
 	// Constraints
 	ConstraintAxis = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -68,6 +69,7 @@ _Template::_Template() {
 
 	// Terrain
 	Smooth = 5;
+	HeightField = 0;
 }
 
 _ObjectSpawn::_ObjectSpawn() {
@@ -52,6 +52,7 @@ struct _Template {
 	float AngularDamping;
 	float ERP;
 	float CFM;
+	int MaterialIndex;
 
 	// Constraints
 	glm::vec3 ConstraintAxis;
@@ -72,6 +73,7 @@ struct _Template {
 	// Terrain
 	std::string HeightMap;
 	int Smooth;
+	int HeightField;
 };
 
 struct _ObjectSpawn {
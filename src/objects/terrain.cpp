@@ -21,20 +21,72 @@
 #include <config.h>
 #include <level.h>
 #include <save.h>
+#include <log.h>
+#include <colmesh.h>
 #include <objects/template.h>
 #include <ITerrainSceneNode.h>
 #include <CDynamicMeshBuffer.h>
 #include <ISceneManager.h>
-#include <fstream>
+#include <IFileSystem.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <vector>
 
 using namespace irr;
 
+// Check if a file name is <level>_<version>_<object>_<key>.cache for a level and object
+static bool IsTerrainCache(const std::string &File, const std::string &LevelName, const std::string &ObjectName) {
+	std::string Prefix = LevelName + "_";
+	if(File.compare(0, Prefix.size(), Prefix) != 0)
+		return false;
+
+	// Skip version
+	size_t Position = Prefix.size();
+	while(Position < File.size() && isdigit((unsigned char)File[Position]))
+		Position++;
+	if(Position == Prefix.size())
+		return false;
+
+	std::string Object = "_" + ObjectName + "_";
+	if(File.compare(Position, Object.size(), Object) != 0)
+		return false;
+
+	// Check key and extension
+	Position += Object.size();
+	if(File.size() != Position + 16 + 6 || File.compare(Position + 16, 6, ".cache") != 0)
+		return false;
+
+	return std::all_of(File.begin() + Position, File.begin() + Position + 16, [](char Character) { return isxdigit((unsigned char)Character); });
+}
+
+// Remove caches baked for other versions of the level or older terrain settings
+static void RemoveStaleCaches(const std::string &ObjectName, const std::string &CachePath) {
+	std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
+	if(!irrFile->changeWorkingDirectoryTo(Save.CachePath.c_str()))
+		return;
+
+	io::IFileList *FileList = irrFile->createFileList();
+	irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+
+	for(uint32_t i = 0; i < FileList->getFileCount(); i++) {
+		std::string File = FileList->getFileName(i).c_str();
+		if(!FileList->isDirectory(i) && Save.CachePath + File != CachePath && IsTerrainCache(File, Level.LevelName, ObjectName))
+			remove((Save.CachePath + File).c_str());
+	}
+	FileList->drop();
+}
+
 // Constructor
 _Terrain::_Terrain(const _ObjectSpawn &Object) :
 	_Object(Object.Template),
 	TriMeshData(nullptr),
 	VertexList(nullptr),
-	FaceList(nullptr) {
+	FaceList(nullptr),
+	HeightFieldData(nullptr),
+	HeightList(nullptr),
+	CollisionSize(0) {
 
 	// Check for mesh file
 	if(Template->HeightMap != "") {
@@ -72,48 +124,25 @@ _Terrain::_Terrain(const _ObjectSpawn &Object) :
 			Terrain->setMaterialType((video::E_MATERIAL_TYPE)Template->CustomMaterial);
 
 		if(Physics.IsEnabled()) {
+			if(Template->HeightField)
+				CreateHeightField(Terrain, OriginalRotationPivot);
+			else {
 
-			// Get vertex data
-			scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
-			Terrain->getMeshBufferForLOD(MeshBuffer, 0);
-			uint16_t *Indices = MeshBuffer.getIndices();
-
-			// Allocate memory for lists
-			int VertexCount = MeshBuffer.getIndexCount() * 3;
-			int IndexCount = MeshBuffer.getIndexCount();
-			VertexList = new float[VertexCount];
-			FaceList = new dTriIndex[IndexCount];
-
-			// Transform vertices
-			core::matrix4 RotationTransform;
-			RotationTransform.setRotationDegrees(Terrain->getRotation());
-			video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
-
-			// Get face and vertex list
-			int VertexIndex = 0;
-			for(int i = 0; i < IndexCount; i += 3) {
-				FaceList[i+0] = i+0;
-				FaceList[i+1] = i+1;
-				FaceList[i+2] = i+2;
-				for(int j = 0; j < 3; j++) {
-
-					// Apply terrain transform
-					core::vector3df Vertex = Vertices[Indices[i+j]].Pos * Terrain->getScale() + Terrain->getPosition();
-					Vertex -= OriginalRotationPivot;
-					RotationTransform.inverseRotateVect(Vertex);
-					Vertex += OriginalRotationPivot;
-
-					// Set triangle
-					VertexList[VertexIndex++] = Vertex.X;
-					VertexList[VertexIndex++] = Vertex.Y;
-					VertexList[VertexIndex++] = Vertex.Z;
+				// Load the baked collision mesh, or bake it and save it for later loads
+				std::string CachePath = GetCachePath(Object.Name, GetCacheKey(Object));
+				if(CacheFile.Open(CachePath)) {
+					TriMeshData = _ColMesh::Load(CacheFile);
+					CollisionSize = CacheFile.GetSize();
+				}
+				if(!TriMeshData) {
+					CacheFile.Close();
+					BakeMesh(Terrain, OriginalRotationPivot, CachePath);
+					RemoveStaleCaches(Object.Name, CachePath);
 				}
-			}
 
-			// Create trimesh
-			TriMeshData = dGeomTriMeshDataCreate();
-			dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount / 3, FaceList, IndexCount, 3 * sizeof(dTriIndex), nullptr);
-			Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+				// Create trimesh
+				Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+			}
 		}
 
 		SetProperties(Object, false);
@@ -123,11 +152,154 @@ _Terrain::_Terrain(const _ObjectSpawn &Object) :
 // Destructor
 _Terrain::~_Terrain() {
 	dGeomTriMeshDataDestroy(TriMeshData);
+	if(HeightFieldData)
+		dGeomHeightfieldDataDestroy(HeightFieldData);
 	delete[] VertexList;
 	delete[] FaceList;
+	delete[] HeightList;
+}
+
+// Build the collision mesh from the terrain's highest detail level and save it to the cache
+void _Terrain::BakeMesh(scene::ITerrainSceneNode *Terrain, const core::vector3df &OriginalRotationPivot, const std::string &CachePath) {
+
+	// Get vertex data
+	scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
+	Terrain->getMeshBufferForLOD(MeshBuffer, 0);
+	uint16_t *Indices = MeshBuffer.getIndices();
+
+	// Allocate memory for lists
+	int VertexCount = MeshBuffer.getVertexCount();
+	int IndexCount = MeshBuffer.getIndexCount();
+	VertexList = new float[VertexCount * 3];
+	FaceList = new dTriIndex[IndexCount];
+
+	// Transform vertices
+	core::matrix4 RotationTransform;
+	RotationTransform.setRotationDegrees(Terrain->getRotation());
+	video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
+	for(int i = 0; i < VertexCount; i++) {
+
+		// Apply terrain transform
+		core::vector3df Vertex = Vertices[i].Pos * Terrain->getScale() + Terrain->getPosition();
+		Vertex -= OriginalRotationPivot;
+		RotationTransform.inverseRotateVect(Vertex);
+		Vertex += OriginalRotationPivot;
+
+		VertexList[i * 3 + 0] = Vertex.X;
+		VertexList[i * 3 + 1] = Vertex.Y;
+		VertexList[i * 3 + 2] = Vertex.Z;
+	}
+
+	// Faces share the terrain's vertices
+	for(int i = 0; i < IndexCount; i++)
+		FaceList[i] = Indices[i];
+
+	// Create trimesh
+	TriMeshData = dGeomTriMeshDataCreate();
+	dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, IndexCount, 3 * sizeof(dTriIndex), nullptr);
+	CollisionSize = VertexCount * 3 * sizeof(float) + IndexCount * sizeof(dTriIndex) + dGeomTriMeshDataGetTree(TriMeshData, nullptr) * COLMESH_NODE_SIZE;
+
+	// Save baked mesh
+	if(!_ColMesh::Save(CachePath, VertexList, VertexCount, FaceList, IndexCount / 3, TriMeshData))
+		Log.Write("Could not write terrain cache: %s", CachePath.c_str());
+}
+
+// Build a heightfield from the terrain's highest detail level
+void _Terrain::CreateHeightField(scene::ITerrainSceneNode *Terrain, const core::vector3df &OriginalRotationPivot) {
+
+	// Get smoothed heights
+	scene::CDynamicMeshBuffer MeshBuffer(video::EVT_STANDARD, video::EIT_32BIT);
+	Terrain->getMeshBufferForLOD(MeshBuffer, 0);
+	int Size = (int)std::sqrt((float)MeshBuffer.getVertexCount());
+	core::vector3df Scale = Terrain->getScale();
+
+	// Patches don't always reach the far edges of the heightmap, so only use the samples they cover
+	int XCount = 0, ZCount = 0;
+	uint16_t *Indices = MeshBuffer.getIndices();
+	for(uint32_t i = 0; i < MeshBuffer.getIndexCount(); i++) {
+		XCount = std::max(XCount, Indices[i] / Size + 1);
+		ZCount = std::max(ZCount, Indices[i] % Size + 1);
+	}
+
+	// Terrain vertices are stored by x then z. The heightfield's local x runs along the terrain's z and its
+	// local z along the terrain's -x, so its cells are split on the same diagonal as the terrain mesh.
+	int SampleCount = XCount * ZCount;
+	HeightList = new float[SampleCount];
+	float MinHeight = 0.0f, MaxHeight = 0.0f;
+	video::S3DVertex *Vertices = (video::S3DVertex *)MeshBuffer.getVertices();
+	for(int j = 0; j < XCount; j++) {
+		for(int i = 0; i < ZCount; i++) {
+			float Height = Vertices[(XCount - 1 - j) * Size + i].Pos.Y * Scale.Y;
+			HeightList[j * ZCount + i] = Height;
+			if((i == 0 && j == 0) || Height < MinHeight)
+				MinHeight = Height;
+			if((i == 0 && j == 0) || Height > MaxHeight)
+				MaxHeight = Height;
+		}
+	}
+	CollisionSize = SampleCount * sizeof(float);
+
+	// Build heightfield
+	float Width = (ZCount - 1) * Scale.Z;
+	float Depth = (XCount - 1) * Scale.X;
+	HeightFieldData = dGeomHeightfieldDataCreate();
+	dGeomHeightfieldDataBuildSingle(HeightFieldData, HeightList, 0, Width, Depth, ZCount, XCount, 1.0f, 0.0f, TERRAIN_HEIGHTFIELD_THICKNESS, 0);
+	dGeomHeightfieldDataSetBounds(HeightFieldData, MinHeight, MaxHeight);
+	Geometry = dCreateHeightfield(Physics.GetSpace(), HeightFieldData, 1);
+
+	// Apply the same inverse rotation about the original pivot as the trimesh vertices
+	core::matrix4 RotationTransform;
+	RotationTransform.setRotationDegrees(Terrain->getRotation());
+	core::vector3df Axes[3] = { core::vector3df(0, 0, 1), core::vector3df(0, 1, 0), core::vector3df(-1, 0, 0) };
+	dMatrix3 Rotation;
+	for(int i = 0; i < 3; i++) {
+		RotationTransform.inverseRotateVect(Axes[i]);
+		Rotation[0 * 4 + i] = Axes[i].X;
+		Rotation[1 * 4 + i] = Axes[i].Y;
+		Rotation[2 * 4 + i] = Axes[i].Z;
+	}
+	Rotation[3] = Rotation[7] = Rotation[11] = 0;
+	dGeomSetRotation(Geometry, Rotation);
+
+	// Center of the heightfield
+	core::vector3df Center = core::vector3df(Depth * 0.5f, 0.0f, Width * 0.5f) + Terrain->getPosition() - OriginalRotationPivot;
+	RotationTransform.inverseRotateVect(Center);
+	Center += OriginalRotationPivot;
+	dGeomSetPosition(Geometry, Center.X, Center.Y, Center.Z);
+}
+
+// Hash everything the collision mesh is built from with FNV-1a
+uint64_t _Terrain::GetCacheKey(const _ObjectSpawn &Object) {
+	uint64_t Hash = 14695981039346656037ULL;
+	auto HashBytes = [&Hash](const void *Data, size_t Size) {
+		const unsigned char *Bytes = (const unsigned char *)Data;
+		for(size_t i = 0; i < Size; i++)
+			Hash = (Hash ^ Bytes[i]) * 1099511628211ULL;
+	};
+
+	// Hash heightmap
+	io::IReadFile *File = irrFile->createAndOpenFile(Template->HeightMap.c_str());
+	if(File) {
+		std::vector<char> Data(File->getSize());
+		File->read(Data.data(), Data.size());
+		HashBytes(Data.data(), Data.size());
+		File->drop();
+	}
+
+	// Hash transform and options
+	HashBytes(&Template->Shape[0], sizeof(float) * 3);
+	HashBytes(&Template->Smooth, sizeof(Template->Smooth));
+	HashBytes(&Object.Position[0], sizeof(float) * 3);
+	HashBytes(&Object.Rotation[0], sizeof(float) * 3);
+	HashBytes(&COLMESH_VERSION, sizeof(COLMESH_VERSION));
+
+	return Hash;
 }
 
 // Get path to terrain cache file
-std::string _Terrain::GetCachePath(const std::string &ObjectName) {
-	return Save.CachePath + Level.LevelName + "_" + std::to_string(Level.LevelVersion) + "_" + ObjectName + ".cache";
+std::string _Terrain::GetCachePath(const std::string &ObjectName, uint64_t Key) {
+	char Buffer[17];
+	snprintf(Buffer, sizeof(Buffer), "%016llx", (unsigned long long)Key);
+
+	return Save.CachePath + Level.LevelName + "_" + std::to_string(Level.LevelVersion) + "_" + ObjectName + "_" + Buffer + ".cache";
 }
@@ -19,7 +19,20 @@
 
 // Libraries
 #include <objects/object.h>
+#include <mappedfile.h>
+#include <ode/collision.h>
 #include <ode/collision_trimesh.h>
+#include <vector3d.h>
+
+// Forward Declarations
+namespace irr {
+	namespace scene {
+		class ITerrainSceneNode;
+	}
+}
+
+// Constants
+const float TERRAIN_HEIGHTFIELD_THICKNESS = 10.0f;
 
 // Classes
 class _Terrain : public _Object {
@@ -29,11 +42,25 @@ class _Terrain : public _Object {
 		_Terrain(const _ObjectSpawn &Object);
 		~_Terrain();
 
+		size_t GetCollisionSize() const { return CollisionSize; }
+
 	private:
 
-		std::string GetCachePath(const std::string &ObjectName);
+		void BakeMesh(irr::scene::ITerrainSceneNode *Terrain, const irr::core::vector3df &OriginalRotationPivot, const std::string &CachePath);
+		void CreateHeightField(irr::scene::ITerrainSceneNode *Terrain, const irr::core::vector3df &OriginalRotationPivot);
+		uint64_t GetCacheKey(const _ObjectSpawn &Object);
+		std::string GetCachePath(const std::string &ObjectName, uint64_t Key);
 
 		dTriMeshDataID TriMeshData;
 		float *VertexList;
 		dTriIndex *FaceList;
+
+		// Baked collision mesh
+		_MappedFile CacheFile;
+
+		// Heightfield
+		dHeightfieldDataID HeightFieldData;
+		float *HeightList;
+
+		size_t CollisionSize;
 };
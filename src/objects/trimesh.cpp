@@ -18,9 +18,11 @@
 #include <objects/trimesh.h>
 #include <physics.h>
 #include <globals.h>
+#include <log.h>
+#include <colmesh.h>
 #include <objects/template.h>
 #include <ode/collision.h>
-#include <fstream>
+#include <cstring>
 
 // Constructor
 _Trimesh::_Trimesh(const _ObjectSpawn &Object) :
@@ -29,57 +31,20 @@ _Trimesh::_Trimesh(const _ObjectSpawn &Object) :
 	VertexList(nullptr),
 	FaceList(nullptr) {
 
-	// Load collision mesh file
-	std::ifstream MeshFile(Object.Template->CollisionFile.c_str(), std::ios::binary);
-	if(MeshFile) {
+	// Map collision mesh file
+	if(MappedFile.Open(Object.Template->CollisionFile)) {
 
-		// Read header
-		int VertexCount, FaceCount;
-		MeshFile.read((char *)&VertexCount, sizeof(VertexCount));
-		MeshFile.read((char *)&FaceCount, sizeof(FaceCount));
-
-		// Allocate memory for lists
-		VertexList = new float[VertexCount * 3];
-		FaceList = new dTriIndex[FaceCount * 3];
-
-		// Read vertices
-		int VertexIndex = 0;
-		for(int i = 0; i < VertexCount; i++) {
-			float Value;
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			VertexList[VertexIndex++] = -Value;
-		}
-
-		// Read faces
-		int FaceIndex = 0;
-		for(int i = 0; i < FaceCount; i++) {
-			int Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+2] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+1] = Value;
-
-			MeshFile.read((char *)&Value, sizeof(Value));
-			FaceList[FaceIndex+0] = Value;
-
-			FaceIndex += 3;
-		}
-
-		// Close file
-		MeshFile.close();
+		// Check for precooked format
+		if(_ColMesh::IsColMesh(MappedFile))
+			TriMeshData = _ColMesh::Load(MappedFile);
+		else
+			LoadMesh();
 
 		// Create trimesh
-		TriMeshData = dGeomTriMeshDataCreate();
-		dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, FaceIndex, 3 * sizeof(dTriIndex), nullptr);
-		Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+		if(TriMeshData)
+			Geometry = dCreateTriMesh(Physics.GetSpace(), TriMeshData, 0, 0, 0);
+		else
+			Log.Write("Invalid collision mesh: %s", Object.Template->CollisionFile.c_str());
 	}
 
 	SetProperties(Object, false);
@@ -92,3 +57,45 @@ _Trimesh::~_Trimesh() {
 	delete[] VertexList;
 	delete[] FaceList;
 }
+
+// Copy a mesh in the original format, flipping the z axis and winding order
+void _Trimesh::LoadMesh() {
+	const char *Data = MappedFile.GetData();
+	size_t Size = MappedFile.GetSize();
+
+	// Read header
+	int32_t VertexCount, FaceCount;
+	if(Size < sizeof(VertexCount) + sizeof(FaceCount))
+		return;
+	memcpy(&VertexCount, Data, sizeof(VertexCount));
+	memcpy(&FaceCount, Data + sizeof(VertexCount), sizeof(FaceCount));
+	if(VertexCount < 0 || FaceCount < 0 || sizeof(VertexCount) + sizeof(FaceCount) + ((uint64_t)VertexCount + FaceCount) * 3 * sizeof(float) > Size)
+		return;
+
+	// Allocate memory for lists
+	VertexList = new float[VertexCount * 3];
+	FaceList = new dTriIndex[FaceCount * 3];
+
+	// Read vertices
+	const char *Position = Data + sizeof(VertexCount) + sizeof(FaceCount);
+	memcpy(VertexList, Position, VertexCount * 3 * sizeof(float));
+	for(int i = 0; i < VertexCount; i++)
+		VertexList[i * 3 + 2] = -VertexList[i * 3 + 2];
+	Position += VertexCount * 3 * sizeof(float);
+
+	// Read faces
+	for(int i = 0; i < FaceCount; i++) {
+		int32_t Face[3];
+		memcpy(Face, Position, sizeof(Face));
+		FaceList[i * 3 + 0] = Face[2];
+		FaceList[i * 3 + 1] = Face[1];
+		FaceList[i * 3 + 2] = Face[0];
+		Position += sizeof(Face);
+	}
+
+	// Lists are copied, so the file isn't needed
+	MappedFile.Close();
+
+	TriMeshData = dGeomTriMeshDataCreate();
+	dGeomTriMeshDataBuildSingle1(TriMeshData, VertexList, 3 * sizeof(float), VertexCount, FaceList, FaceCount * 3, 3 * sizeof(dTriIndex), nullptr);
+}
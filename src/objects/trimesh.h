@@ -19,6 +19,7 @@
 
 // Libraries
 #include <objects/object.h>
+#include <mappedfile.h>
 #include <ode/collision_trimesh.h>
 
 // Classes
@@ -31,8 +32,13 @@ class _Trimesh : public _Object {
 
 	protected:
 
+		void LoadMesh();
+
 		dTriMeshDataID TriMeshData;
 		float *VertexList;
 		dTriIndex *FaceList;
 
+		// Precooked meshes are used straight from the mapped file
+		_MappedFile MappedFile;
+
 };
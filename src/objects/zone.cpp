@@ -37,8 +37,8 @@ _Zone::_Zone(const _ObjectSpawn &Object) :
 
 	// Set common properties
 	SetProperties(Object);
-	if(CollisionCallback == "")
-		CollisionCallback = "OnHitZone";
+	if(CollisionCallback == -1)
+		CollisionCallback = Scripting.GetCallback("OnHitZone");
 }
 
 // Collision callback
@@ -60,7 +60,7 @@ void _Zone::HandleCollision(const _ObjectCollision &ObjectCollision) {
 		TouchState.push_back(ObjectTouchState(ObjectCollision.OtherObject, 2));
 
 		// Call Lua function
-		if(CollisionCallback.size())
+		if(CollisionCallback != -1)
 			Scripting.CallZoneHandler(CollisionCallback, 0, this, ObjectCollision.OtherObject);
 	}
 }
@@ -76,7 +76,7 @@ void _Zone::EndFrame() {
 			if(Iterator->TouchCount <= 0) {
 
 				// Call Lua function
-				if(CollisionCallback.size())
+				if(CollisionCallback != -1)
 					Scripting.CallZoneHandler(CollisionCallback, 1, this, Iterator->Object);
 
 				Iterator = TouchState.erase(Iterator);
@@ -126,6 +126,19 @@ ODE_API void dGeomTriMeshDataBuildSingle1(dTriMeshDataID g,
                                   const void* Indices, int IndexCount, int TriStride,
                                   const void* Normals);
 /*
+* Build a TriMesh data object with single precision vertex data and an OPCODE
+* tree saved by dGeomTriMeshDataGetTree. Returns 0 if the tree doesn't match the mesh.
+*/
+ODE_API int dGeomTriMeshDataBuildSingleTree(dTriMeshDataID g,
+                                  const void* Vertices, int VertexStride, int VertexCount, 
+                                  const void* Indices, int IndexCount, int TriStride,
+                                  const void* TreeNodes, int TreeNodeCount);
+/*
+* Copy the OPCODE tree of a built TriMesh data object to TreeNodes, which holds
+* 32 bytes per node. Pass null to get the node count.
+*/
+ODE_API int dGeomTriMeshDataGetTree(dTriMeshDataID g, void* TreeNodes);
+/*
 * Build a TriMesh data object with double precision vertex data.
 */
 ODE_API void dGeomTriMeshDataBuildDouble(dTriMeshDataID g, 
@@ -96,10 +96,11 @@ dxTriMeshData::~dxTriMeshData()
     }
 }
 
-void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned VertexCount,
+bool dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned VertexCount,
     const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
     const dReal *in_Normals,
-    bool Single)
+    bool Single,
+    const AABBNoLeafNodeData *TreeNodes, unsigned TreeNodeCount)
 {
     dxTriMeshData_Parent::buildData(Vertices, VertexStide, VertexCount, Indices, IndexCount, TriStride, in_Normals, Single);
     dAASSERT(IndexCount % dMTV__MAX == 0);
@@ -120,7 +121,8 @@ void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned V
 
     OPCODECREATE TreeBuilder(&m_Mesh, Settings, true, false);
 
-    m_BVTree.Build(TreeBuilder);
+    // Use a tree saved with dGeomTriMeshDataGetTree when one is given
+    bool result = TreeNodes != NULL ? m_BVTree.Build(TreeBuilder, TreeNodes, TreeNodeCount) : m_BVTree.Build(TreeBuilder);
 
     // compute model space AABB
     dVector3 AABBMax, AABBMin;
@@ -133,6 +135,8 @@ void dxTriMeshData::buildData(const Point *Vertices, int VertexStide, unsigned V
 
     // user data (not used by OPCODE)
     dIASSERT(m_InternalUseFlags == NULL);
+
+    return result;
 }
 
 
@@ -697,6 +701,43 @@ void dGeomTriMeshDataBuildSingle1(dTriMeshDataID g,
         true);
 }
 
+/*extern */
+int dGeomTriMeshDataBuildSingleTree(dTriMeshDataID g,
+    const void* Vertices, int VertexStride, int VertexCount, 
+    const void* Indices, int IndexCount, int TriStride,
+    const void* TreeNodes, int TreeNodeCount)
+{
+    dUASSERT(g, "The argument is not a trimesh data");
+
+    dxTriMeshData *data = g;
+    return data->buildData((const Point *)Vertices, VertexStride, VertexCount, 
+        (const IndexedTriangle *)Indices, IndexCount, TriStride, 
+        NULL, 
+        true,
+        (const AABBNoLeafNodeData *)TreeNodes, TreeNodeCount);
+}
+
+/*extern */
+int dGeomTriMeshDataGetTree(dTriMeshDataID g, void* TreeNodes)
+{
+    dUASSERT(g, "The argument is not a trimesh data");
+
+    const Model &model = g->m_BVTree;
+    if (model.GetTree() == NULL || model.HasLeafNodes() || model.IsQuantized())
+    {
+        return 0;
+    }
+
+    const AABBNoLeafTree *tree = (const AABBNoLeafTree *)model.GetTree();
+
+    if (TreeNodes != NULL)
+    {
+        tree->Export((AABBNoLeafNodeData *)TreeNodes);
+    }
+
+    return tree->GetNbNodes();
+}
+
 /*extern */
 void dGeomTriMeshDataBuildDouble1(dTriMeshDataID g,
     const void* Vertices, int VertexStride, int VertexCount, 
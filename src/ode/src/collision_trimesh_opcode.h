@@ -180,10 +180,11 @@ public:
 
     ~dxTriMeshData();
 
-    void buildData(const Point *Vertices, int VertexStide, unsigned VertexCount,
+    bool buildData(const Point *Vertices, int VertexStide, unsigned VertexCount,
         const IndexedTriangle *Indices, unsigned IndexCount, int TriStride,
         const dReal *in_Normals,
-        bool Single);
+        bool Single,
+        const AABBNoLeafNodeData *TreeNodes=NULL, unsigned TreeNodeCount=0);
 
 private:
     void calculateDataAABB(dVector3 &AABBMax, dVector3 &AABBMin);
@@ -566,23 +566,13 @@ void dxHeightfield::computeAABB()
 
 #endif // DHEIGHTFIELD_CORNER_ORIGIN
 
-            // X extents
-            aabb[0] = final_posr->pos[0] +
-                dMIN3( dMIN( dx[0], dx[3] ), dMIN( dy[0], dy[3] ), dMIN( dz[0], dz[3] ) );
-            aabb[1] = final_posr->pos[0] +
-                dMAX3( dMAX( dx[0], dx[3] ), dMAX( dy[0], dy[3] ), dMAX( dz[0], dz[3] ) );
-
-            // Y extents
-            aabb[2] = final_posr->pos[1] +
-                dMIN3( dMIN( dx[1], dx[4] ), dMIN( dy[1], dy[4] ), dMIN( dz[1], dz[4] ) );
-            aabb[3] = final_posr->pos[1] +
-                dMAX3( dMAX( dx[1], dx[4] ), dMAX( dy[1], dy[4] ), dMAX( dz[1], dz[4] ) );
-
-            // Z extents
-            aabb[4] = final_posr->pos[2] +
-                dMIN3( dMIN( dx[2], dx[5] ), dMIN( dy[2], dy[5] ), dMIN( dz[2], dz[5] ) );
-            aabb[5] = final_posr->pos[2] +
-                dMAX3( dMAX( dx[2], dx[5] ), dMAX( dy[2], dy[5] ), dMAX( dz[2], dz[5] ) );
+            // Extents are the sum of each rotated axis' contribution
+            aabb[0] = final_posr->pos[0] + dMIN( dx[0], dx[3] ) + dMIN( dy[0], dy[3] ) + dMIN( dz[0], dz[3] );
+            aabb[1] = final_posr->pos[0] + dMAX( dx[0], dx[3] ) + dMAX( dy[0], dy[3] ) + dMAX( dz[0], dz[3] );
+            aabb[2] = final_posr->pos[1] + dMIN( dx[1], dx[4] ) + dMIN( dy[1], dy[4] ) + dMIN( dz[1], dz[4] );
+            aabb[3] = final_posr->pos[1] + dMAX( dx[1], dx[4] ) + dMAX( dy[1], dy[4] ) + dMAX( dz[1], dz[4] );
+            aabb[4] = final_posr->pos[2] + dMIN( dx[2], dx[5] ) + dMIN( dy[2], dy[5] ) + dMIN( dz[2], dz[5] );
+            aabb[5] = final_posr->pos[2] + dMAX( dx[2], dx[5] ) + dMAX( dy[2], dy[5] ) + dMAX( dz[2], dz[5] );
         }
         else
         {
@@ -969,6 +959,85 @@ static inline dReal DistancePointToLine(const dVector3 &_point,
     return dVector3Length(v);
 }
 
+// Closest point on triangle ABC to a point, by the Voronoi region the point falls in
+static void ClosestPointOnTriangle(const dVector3 &_point,
+                                   const dVector3 &_a,
+                                   const dVector3 &_b,
+                                   const dVector3 &_c,
+                                   dVector3 &_closest)
+{
+    dVector3 ab, ac, ap, bp, cp;
+    dVector3Subtract(_b, _a, ab);
+    dVector3Subtract(_c, _a, ac);
+
+    // vertex region A
+    dVector3Subtract(_point, _a, ap);
+    const dReal d1 = dVector3Dot(ab, ap);
+    const dReal d2 = dVector3Dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        dVector3Copy(_a, _closest);
+        return;
+    }
+
+    // vertex region B
+    dVector3Subtract(_point, _b, bp);
+    const dReal d3 = dVector3Dot(ab, bp);
+    const dReal d4 = dVector3Dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        dVector3Copy(_b, _closest);
+        return;
+    }
+
+    // edge region AB
+    const dReal vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        const dReal v = d1 / (d1 - d3);
+        dAddScaledVectors3(_closest, _a, ab, 1, v);
+        return;
+    }
+
+    // vertex region C
+    dVector3Subtract(_point, _c, cp);
+    const dReal d5 = dVector3Dot(ab, cp);
+    const dReal d6 = dVector3Dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        dVector3Copy(_c, _closest);
+        return;
+    }
+
+    // edge region AC
+    const dReal vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        const dReal w = d2 / (d2 - d6);
+        dAddScaledVectors3(_closest, _a, ac, 1, w);
+        return;
+    }
+
+    // edge region BC
+    const dReal va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        const dReal w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        dVector3 bc;
+        dVector3Subtract(_c, _b, bc);
+        dAddScaledVectors3(_closest, _b, bc, 1, w);
+        return;
+    }
+
+    // face region
+    const dReal denom = REAL(1.0) / (va + vb + vc);
+    const dReal v = vb * denom;
+    const dReal w = vc * denom;
+    dVector3 t;
+    dAddScaledVectors3(t, ab, ac, v, w);
+    dVector3Add(_a, t, _closest);
+}
+
 
 
 
@@ -1501,10 +1570,17 @@ int dxHeightfield::dCollideHeightfieldZone( const int minX, const int maxX, cons
                 dContactGeom *planeCurrContact = PlaneContact + i;
                 // Check if contact point found in plane is inside Triangle.
                 const dVector3 &pCPos = planeCurrContact->pos;
+                // A sphere's contact is its deepest point, so test where it touches the plane instead.
+                // Otherwise a neighbouring plane can be accepted with more depth than its triangle has.
+                dVector3 testPos;
+                if (o2->type == dSphereClass)
+                    dAddScaledVectors3(testPos, pCPos, itPlane->planeDef, 1, planeCurrContact->depth);
+                else
+                    dVector3Copy(pCPos, testPos);
                 for (sizeint b = 0; planeTriListSize > b; b++)
                 {  
                     if (m_p_data->IsOnHeightfield2 (itPlane->trianglelist[b]->vertices[0], 
-                        pCPos, 
+                        testPos, 
                         itPlane->trianglelist[b]->isUp))
                     {
                         pContact = CONTACT(contact, numTerrainContacts*skip);
@@ -1627,6 +1703,48 @@ int dxHeightfield::dCollideHeightfieldZone( const int minX, const int maxX, cons
         }
     }
 
+    // pass3 for spheres: closest point of triangles whose plane contact fell outside them.
+    // Spheres smaller than a cell skip pass2, so without this they miss edges and corners.
+    if (o2->type == dSphereClass)
+    {
+        const dReal radius = dGeomSphereGetRadius(o2);
+        dVector3 center, closest, delta;
+        dVector3Copy(o2->final_posr->pos, center);
+
+        for (unsigned int k = 0; k < numTri; k++)
+        {
+            const HeightFieldTriangle * const itTriangle = &tempTriangleBuffer[k];
+            if (itTriangle->state == true)
+                continue;// plane triangle did already collide.
+
+            // centers behind the triangle are left to the plane test
+            if (dVector3Dot(center, itTriangle->planeDef) - itTriangle->planeDef[3] < 0)
+                continue;
+
+            ClosestPointOnTriangle(center,
+                itTriangle->vertices[0]->vertex,
+                itTriangle->vertices[1]->vertex,
+                itTriangle->vertices[2]->vertex,
+                closest);
+            dVector3Subtract(closest, center, delta);
+            const dReal distanceSquared = dVector3LengthSquare(delta);
+            if (distanceSquared >= radius * radius || distanceSquared < dEpsilon)
+                continue;
+
+            const dReal distance = dSqrt(distanceSquared);
+            pContact = CONTACT(contact, numTerrainContacts*skip);
+            dVector3Copy(closest, pContact->pos);
+            dCopyScaledVector3(pContact->normal, delta, REAL(1.0) / distance);
+            pContact->depth = radius - distance;
+            pContact->side1 = -1;
+            pContact->side2 = -1;
+
+            numTerrainContacts++;
+            if ( numTerrainContacts == numMaxContactsPossible )
+                return numTerrainContacts;
+        }
+    }
+
 #ifdef _HEIGHTFIELDEDGECOLLIDING
     // pass3: VS triangle Edges
     if (needFurtherPasses)
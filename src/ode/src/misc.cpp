@@ -26,6 +26,7 @@
 #include "matrix.h"
 #include "error.h"
 #include "odeou.h"
+#include "util.h"
 
 //****************************************************************************
 // random numbers
@@ -75,14 +76,9 @@ int dTestRand()
 
 
 // adam's all-int straightforward(?) dRandInt (0..n-1)
-int dRandInt (int n)
+static int RandIntFromValue (duint32 r, int n)
 {
     int result;
-    // Since there is no memory barrier macro in ODE assign via volatile variable 
-    // to prevent compiler reusing seed as value of `r'
-    volatile unsigned long raw_r = dRand();
-    duint32 r = (duint32)raw_r;
-    
     duint32 un = n;
     dIASSERT(sizeof(n) == sizeof(un));
 
@@ -139,6 +135,40 @@ int dRandInt (int n)
 }
 
 
+int dRandInt (int n)
+{
+    // Since there is no memory barrier macro in ODE assign via volatile variable 
+    // to prevent compiler reusing seed as value of `r'
+    volatile unsigned long raw_r = dRand();
+    return RandIntFromValue((duint32)raw_r, n);
+}
+
+
+int dxRandIntFromSeed (duint32 *seed, int n)
+{
+    *seed = ((duint32)1664525 * *seed + (duint32)1013904223) & (duint32)0xffffffff;
+    return RandIntFromValue(*seed, n);
+}
+
+
+// Skip count numbers of the generator by composing its affine step with itself
+duint32 dxRandAdvance (duint32 seed, duint64 count)
+{
+    duint32 multiplier = 1664525, increment = 1013904223;
+    duint32 totalMultiplier = 1, totalIncrement = 0;
+    for (; count != 0; count >>= 1) {
+        if (count & 1) {
+            totalMultiplier *= multiplier;
+            totalIncrement = totalIncrement * multiplier + increment;
+        }
+        increment = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+    }
+
+    return totalMultiplier * seed + totalIncrement;
+}
+
+
 dReal dRandReal()
 {
     return (dReal)(((double) dRand()) / ((double) 0xffffffff));
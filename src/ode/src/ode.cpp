@@ -1852,9 +1852,17 @@ int dWorldQuickStep (dWorldID w, dReal stepsize)
     dxWorldProcessIslandsInfo islandsinfo;
     if (dxReallocateWorldProcessContext (w, islandsinfo, stepsize, &dxEstimateQuickStepMemoryRequirements))
     {
-        if (dxProcessIslands (w, islandsinfo, stepsize, &dxQuickStepIsland, &dxEstimateQuickStepMaxCallCount))
+        // Seed each island's constraint shuffling so the result does not depend on the order islands are stepped in
+        sizeint islandsCount = islandsinfo.GetIslandsCount();
+        duint32 *islandRandomSeeds = islandsCount != 0 ? w->unsafeGetWorldProcessingContext()->ReallocateIslandRandomSeeds(islandsCount) : NULL;
+        if (islandsCount == 0 || islandRandomSeeds != NULL)
         {
-            result = true;
+            dxQuickStepAssignIslandRandomSeeds(w, islandsinfo, islandRandomSeeds);
+
+            if (dxProcessIslands (w, islandsinfo, stepsize, &dxQuickStepIsland, &dxEstimateQuickStepMaxCallCount))
+            {
+                result = true;
+            }
         }
     }
 
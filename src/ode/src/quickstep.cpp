@@ -661,6 +661,7 @@ struct dxQuickStepperStage4CallContext
         m_LCP_iteration = 0;
         m_cf_4b = 0;
         m_ji_4b = 0;
+        m_SOR_randomSeed = callContext->m_randomSeed;
     }
 
     void AssignLCP_IterationData(dCallReleaseeID releaseeInstance, unsigned int iterationAllowedThreads)
@@ -727,6 +728,7 @@ struct dxQuickStepperStage4CallContext
     volatile atomicord32            m_LCP_iterationThreadsRemaining;
     dCallReleaseeID                 m_LCP_iterationNextReleasee;
     volatile atomicord32            m_SOR_reorderHeadTaken;
+    duint32                         m_SOR_randomSeed;
     volatile atomicord32            m_SOR_reorderTailTaken;
     volatile atomicord32            m_SOR_bi_zeroHeadTaken;
     volatile atomicord32            m_SOR_bi_zeroTailTaken;
@@ -2454,7 +2456,7 @@ bool dxQuickStepIsland_Stage4LCP_ConstraintsShuffling(dxQuickStepperStage4CallCo
                     IndexError *order = stage4CallContext->m_order + startIndex;
 
                     for (unsigned int index = 1; index < indicesCount; ++index) {
-                        int swapIndex = dRandInt(index + 1);
+                        int swapIndex = dxRandIntFromSeed(&stage4CallContext->m_SOR_randomSeed, index + 1);
                         IndexError tmp = order[index];
                         order[index] = order[swapIndex];
                         order[swapIndex] = tmp;
@@ -3342,3 +3344,44 @@ unsigned dxEstimateQuickStepMaxCallCount(unsigned activeThreadCount, unsigned al
     return result;
 }
 
+
+// Give each island the generator state it would reach if islands were stepped in order, then advance the
+// global seed past all of them. Threaded steps then reorder constraints exactly like single threaded ones.
+void dxQuickStepAssignIslandRandomSeeds(dxWorld *world, dxWorldProcessIslandsInfo &islandsInfo, duint32 *islandRandomSeeds)
+{
+#if CONSTRAINTS_REORDERING_METHOD == REORDERING_METHOD__RANDOMLY
+    // Constraints are shuffled on every RANDOM_CONSTRAINTS_REORDERING_FREQUENCY-th iteration after the first
+    const unsigned int num_iterations = world->qs.num_iterations;
+    const duint64 reorderCount = num_iterations > RANDOM_CONSTRAINTS_REORDERING_FREQUENCY ? (num_iterations - 1) / RANDOM_CONSTRAINTS_REORDERING_FREQUENCY : 0;
+
+    unsigned int const *islandSizes = islandsInfo.GetIslandSizes();
+    dxJoint *const *islandJointsStart = islandsInfo.GetJointsArray();
+    duint32 seed = (duint32)dRandGetSeed();
+
+    const sizeint islandsCount = islandsInfo.GetIslandsCount();
+    for (sizeint islandIndex = 0; islandIndex != islandsCount; ++islandIndex) {
+        islandRandomSeeds[islandIndex] = seed;
+
+        // Each shuffle draws one number per constraint row after the first
+        unsigned int m = 0;
+        unsigned int jcount = islandSizes[islandIndex * dxISE__MAX + dxISE_JOINTS_COUNT];
+        for (unsigned int j = 0; j != jcount; ++j) {
+            dxJoint::Info1 info;
+            islandJointsStart[j]->getInfo1(&info);
+            m += info.m;
+        }
+        islandJointsStart += jcount;
+
+        if (m > 1) {
+            seed = dxRandAdvance(seed, reorderCount * (m - 1));
+        }
+    }
+
+    dRandSetSeed(seed);
+    islandsInfo.AssignIslandRandomSeeds(islandRandomSeeds);
+#else
+    (void)world; // unused
+    (void)islandsInfo; // unused
+    (void)islandRandomSeeds; // unused
+#endif
+}
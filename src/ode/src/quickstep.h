@@ -26,6 +26,7 @@
 #include <ode/common.h>
 
 struct dxStepperProcessingCallContext;
+struct dxWorldProcessIslandsInfo;
 
 
 sizeint dxEstimateQuickStepMemoryRequirements(
@@ -34,6 +35,7 @@ unsigned dxEstimateQuickStepMaxCallCount(
     unsigned activeThreadCount, unsigned allowedThreadCount);
 
 void dxQuickStepIsland(const dxStepperProcessingCallContext *callContext);
+void dxQuickStepAssignIslandRandomSeeds(dxWorld *world, dxWorldProcessIslandsInfo &islandsInfo, duint32 *islandRandomSeeds);
 
 
 #endif
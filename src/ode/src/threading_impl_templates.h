@@ -660,13 +660,9 @@ void dxtemplateJobListContainer<tThreadLull, tThreadMutex, tAtomicsProvider>::Re
             break;
         }
 
+        // The waiting thread may return as soon as it is signalled, so the fault must be stored
+        // in its stack and the job released before waking it
         void *job_call_wait = current_job->m_call_wait;
-
-        if (job_call_wait != NULL)
-        {
-            wait_signal_proc_ptr(job_call_wait);
-        }
-
         int call_fault = current_job->m_call_fault;
 
         if (current_job->m_fault_accumulator_ptr)
@@ -677,6 +673,11 @@ void dxtemplateJobListContainer<tThreadLull, tThreadMutex, tAtomicsProvider>::Re
         dxThreadedJobInfo *dependent_job = current_job->m_dependent_job;
         ReleaseJobInfoIntoPool(current_job);
 
+        if (job_call_wait != NULL)
+        {
+            wait_signal_proc_ptr(job_call_wait);
+        }
+
         if (dependent_job == NULL)
         {
             break;
@@ -56,7 +56,9 @@ dxWorldProcessContext::dxWorldProcessContext():
     m_pmaStepperArenas(NULL),
     m_pswObjectsAllocWorld(NULL),
     m_pmgStepperMutexGroup(NULL),
-    m_pcwIslandsSteppingWait(NULL)
+    m_pcwIslandsSteppingWait(NULL),
+    m_pIslandRandomSeeds(NULL),
+    m_nIslandRandomSeedsCapacity(0)
 {
     // Do nothing
 }
@@ -82,6 +84,11 @@ dxWorldProcessContext::~dxWorldProcessContext()
     {
         dxWorldProcessMemArena::FreeMemArena(m_pmaIslandsArena);
     }
+
+    if (m_pIslandRandomSeeds != NULL)
+    {
+        dFree(m_pIslandRandomSeeds, m_nIslandRandomSeedsCapacity * sizeof(duint32));
+    }
 }
 
 void dxWorldProcessContext::CleanupWorldReferences(dxWorld *pswWorldInstance)
@@ -196,6 +203,27 @@ void dxWorldProcessContext::ReturnStepperMemArena(dxWorldProcessMemArena *pmaAre
 }
 
 
+duint32 *dxWorldProcessContext::ReallocateIslandRandomSeeds(sizeint nIslandsCount)
+{
+    // The buffer only grows, so steady state steps don't touch the allocator
+    if (nIslandsCount > m_nIslandRandomSeedsCapacity)
+    {
+        sizeint nNewCapacity = nIslandsCount > m_nIslandRandomSeedsCapacity * 2 ? nIslandsCount : m_nIslandRandomSeedsCapacity * 2;
+        duint32 *pNewSeeds = (duint32 *)dRealloc(m_pIslandRandomSeeds, m_nIslandRandomSeedsCapacity * sizeof(duint32), nNewCapacity * sizeof(duint32));
+
+        if (pNewSeeds == NULL)
+        {
+            return NULL;
+        }
+
+        m_pIslandRandomSeeds = pNewSeeds;
+        m_nIslandRandomSeedsCapacity = nNewCapacity;
+    }
+
+    return m_pIslandRandomSeeds;
+}
+
+
 dxWorldProcessMemArena *dxWorldProcessContext::ReallocateIslandsMemArena(sizeint nMemoryRequirement, 
     const dxWorldProcessMemoryManager *pmmMemortManager, float fReserveFactor, unsigned uiReserveMinimum)
 {
@@ -659,13 +687,7 @@ void dxStepBody (dxBody *b, dReal h)
     dNormalize4 (b->q);
     dQtoR (b->q,b->posr.R);
 
-    // notify all attached geoms that this body has moved
-    dxWorldProcessContext *world_process_context = b->world->unsafeGetWorldProcessingContext(); 
-    for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom)) {
-        world_process_context->LockForStepbodySerialization();
-        dGeomMoved (geom);
-        world_process_context->UnlockForStepbodySerialization();
-    }
+    // attached geoms are notified by dxProcessIslands once all islands are stepped
 
     // notify the user
     if (b->moved_callback != NULL) {
@@ -695,14 +717,6 @@ void dxStepBody (dxBody *b, dReal h)
 //****************************************************************************
 // island processing
 
-enum dxISLANDSIZESELEMENT
-{
-    dxISE_BODIES_COUNT,
-    dxISE_JOINTS_COUNT,
-
-    dxISE__MAX
-};
-
 // This estimates dynamic memory requirements for dxProcessIslands
 static sizeint EstimateIslandProcessingMemoryRequirements(dxWorld *world)
 {
@@ -904,7 +918,9 @@ bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsI
         dIASSERT(islandsAllowedThreadCount != 0);
         dIASSERT(activeThreadCount >= islandsAllowedThreadCount);
 
-        unsigned stepperAllowedThreadCount = islandsAllowedThreadCount; // For now, set stepper allowed threads equal to island stepping threads
+        // Islands are stepped in parallel but each island is solved by a single thread. The multithreaded SOR iteration
+        // visits constraints in a different order than the sequential one, so results would depend on the thread count.
+        unsigned stepperAllowedThreadCount = 1;
 
         unsigned simultaneousCallsCount = EstimateIslandProcessingSimultaneousCallsMaximumCount(activeThreadCount, islandsAllowedThreadCount, stepperAllowedThreadCount, maxCallCountEstimator);
         if (!world->PreallocateResourcesForThreadedCalls(simultaneousCallsCount)) {
@@ -930,6 +946,20 @@ bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsI
             break;
         }
 
+        // Notify geoms that their bodies moved in island order. dGeomMoved reorders the space's geom list,
+        // so doing it from the stepping threads would make later collisions depend on which island finished first.
+        dxBody *const *bodies = islandsInfo.GetBodiesArray();
+        unsigned int const *islandSizes = islandsInfo.GetIslandSizes();
+        const sizeint islandsCount = islandsInfo.GetIslandsCount();
+        for (sizeint islandIndex = 0; islandIndex != islandsCount; ++islandIndex) {
+            unsigned int bcount = islandSizes[islandIndex * dxISE__MAX + dxISE_BODIES_COUNT];
+            for (dxBody *const *bodyend = bodies + bcount; bodies != bodyend; ++bodies) {
+                for (dxGeom *geom = (*bodies)->geom; geom; geom = dGeomGetBodyNext (geom)) {
+                    dGeomMoved (geom);
+                }
+            }
+        }
+
         result = true;
     }
     while (false);
@@ -1013,6 +1043,9 @@ void dxIslandsProcessingCallContext::ThreadedProcessIslandSearch(dxSingleIslandC
                 // Store selected island details
                 stepperCallContext->AssignIslandSelection(islandBodiesStart, islandJointsStart, bcount, jcount);
 
+                duint32 const *islandRandomSeeds = islandsInfo.GetIslandRandomSeeds();
+                stepperCallContext->m_stepperCallContext.AssignIslandRandomSeed(islandRandomSeeds != NULL ? islandRandomSeeds[islandIndex] : 0);
+
                 // Store next island index to continue search from
                 ++islandIndex;
                 stepperCallContext->AssignIslandSearchProgress(islandIndex);
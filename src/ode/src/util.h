@@ -216,6 +216,8 @@ public:
     bool ReallocateStepperMemArenas(dxWorld *world, unsigned nIslandThreadsCount, sizeint nMemoryRequirement, 
         const dxWorldProcessMemoryManager *pmmMemortManager, float fReserveFactor, unsigned uiReserveMinimum);
 
+    duint32 *ReallocateIslandRandomSeeds(sizeint nIslandsCount);
+
 private:
     static void FreeArenasList(dxWorldProcessMemArena *pmaExistingArenas);
 
@@ -254,6 +256,16 @@ private:
     dxWorld                 *m_pswObjectsAllocWorld;
     dMutexGroupID           m_pmgStepperMutexGroup;
     dCallWaitID             m_pcwIslandsSteppingWait;
+    duint32                 *m_pIslandRandomSeeds;
+    sizeint                 m_nIslandRandomSeedsCapacity;
+};
+
+enum dxISLANDSIZESELEMENT
+{
+    dxISE_BODIES_COUNT,
+    dxISE_JOINTS_COUNT,
+
+    dxISE__MAX
 };
 
 struct dxWorldProcessIslandsInfo
@@ -264,18 +276,24 @@ struct dxWorldProcessIslandsInfo
         m_pIslandSizes = islandsizes;
         m_pBodies = bodies;
         m_pJoints = joints;
+        m_pIslandRandomSeeds = NULL;
     }
 
+    // Random seed each island starts from, so islands stepped in any order use the numbers they would get stepped in sequence
+    void AssignIslandRandomSeeds(duint32 const *islandRandomSeeds) { m_pIslandRandomSeeds = islandRandomSeeds; }
+
     sizeint GetIslandsCount() const { return m_IslandCount; }
     unsigned int const *GetIslandSizes() const { return m_pIslandSizes; }
     dxBody *const *GetBodiesArray() const { return m_pBodies; }
     dxJoint *const *GetJointsArray() const { return m_pJoints; }
+    duint32 const *GetIslandRandomSeeds() const { return m_pIslandRandomSeeds; }
 
 private:
     sizeint                  m_IslandCount;
     unsigned int const      *m_pIslandSizes;
     dxBody *const           *m_pBodies;
     dxJoint *const          *m_pJoints;
+    duint32 const           *m_pIslandRandomSeeds;
 };
 
 struct dxStepperProcessingCallContext
@@ -284,10 +302,15 @@ struct dxStepperProcessingCallContext
         dxWorldProcessMemArena *stepperArena, dxBody *const *islandBodiesStart, dxJoint *const *islandJointsStart): 
         m_world(world), m_stepSize(stepSize), m_stepperArena(stepperArena), m_finalReleasee(NULL), 
         m_islandBodiesStart(islandBodiesStart), m_islandJointsStart(islandJointsStart), m_islandBodiesCount(0), m_islandJointsCount(0),
-        m_stepperAllowedThreads(stepperAllowedThreads)
+        m_stepperAllowedThreads(stepperAllowedThreads), m_randomSeed(0)
     {
     }
 
+    void AssignIslandRandomSeed(duint32 randomSeed)
+    {
+        m_randomSeed = randomSeed;
+    }
+
     void AssignIslandSelection(dxBody *const *islandBodiesStart, dxJoint *const *islandJointsStart, 
         unsigned islandBodiesCount, unsigned islandJointsCount)
     {
@@ -314,6 +337,7 @@ struct dxStepperProcessingCallContext
     unsigned                m_islandBodiesCount;
     unsigned                m_islandJointsCount;
     unsigned                m_stepperAllowedThreads;
+    duint32                 m_randomSeed;
 };
 
 #define BEGIN_STATE_SAVE(memarena, state) void *state = memarena->SaveState();
@@ -322,6 +346,10 @@ struct dxStepperProcessingCallContext
 typedef void (*dstepper_fn_t) (const dxStepperProcessingCallContext *callContext);
 typedef unsigned (*dmaxcallcountestimate_fn_t) (unsigned activeThreadCount, unsigned allowedThreadCount);
 
+// Random numbers from a caller owned seed, following the same sequence as dRand() and dRandInt()
+duint32 dxRandAdvance (duint32 seed, duint64 count);
+int dxRandIntFromSeed (duint32 *seed, int n);
+
 bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsInfo, 
                        dReal stepSize, dstepper_fn_t stepper, dmaxcallcountestimate_fn_t maxCallCountEstimator);
 
@@ -16,6 +16,10 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <physics.h>
+#include <config.h>
+#include <scripting.h>
+#include <log.h>
+#include <profiler.h>
 #include <objects/object.h>
 #include <objects/template.h>
 #include <ode/odeinit.h>
@@ -47,9 +51,15 @@ static void RayCallback(void *Data, dGeomID Geometry1, dGeomID Geometry2) {
 	}
 }
 
+// Data passed to the near collision callback
+struct _CollideData {
+	std::vector<_ObjectCollision> *ObjectCollisions;
+	_CollisionStats *Stats;
+};
+
 // Near collision callback
 static void ODECallback(void *Data, dGeomID Geometry, dGeomID OtherGeometry) {
-	std::vector<_ObjectCollision> *ObjectCollisions = (std::vector<_ObjectCollision> *)Data;
+	_CollideData *CollideData = (_CollideData *)Data;
 	dBodyID Body = dGeomGetBody(Geometry);
 	dBodyID OtherBody = dGeomGetBody(OtherGeometry);
 
@@ -57,52 +67,80 @@ static void ODECallback(void *Data, dGeomID Geometry, dGeomID OtherGeometry) {
 	_Object *Object =(_Object *)dGeomGetData(Geometry);
 	_Object *OtherObject = (_Object *)dGeomGetData(OtherGeometry);
 
-	// Get contacts
+	// Get contacts, limited by what the pair of geometry types can generate
 	dContact Contacts[MAX_CONTACTS];
-	int Count = dCollide(Geometry, OtherGeometry, MAX_CONTACTS, &Contacts[0].geom, sizeof(dContact));
+	int Count = dCollide(Geometry, OtherGeometry, Physics.GetContactLimit(Geometry, OtherGeometry), &Contacts[0].geom, sizeof(dContact));
+	CollideData->Stats->NearCalls++;
+	CollideData->Stats->Contacts += Count;
+	if(!Count)
+		return;
+
+	// Get surface for the pair of templates
+	const _MaterialPair &Material = Physics.GetMaterialPair(Object->GetTemplate(), OtherObject->GetTemplate());
+
+	// Find the most upward and downward facing normals while creating contact joints
+	int Up = 0;
+	int Down = 0;
+	glm::vec3 AverageNormal(0.0f, 0.0f, 0.0f);
 	for(int i = 0; i < Count; i++) {
-
-		// Test for zones
-		bool Response = true;
-		if(Object->GetTemplate()->CollisionGroup & _Physics::FILTER_ZONE || OtherObject->GetTemplate()->CollisionGroup & _Physics::FILTER_ZONE)
-			Response = false;
+		AverageNormal += glm::vec3(Contacts[i].geom.normal[0], Contacts[i].geom.normal[1], Contacts[i].geom.normal[2]);
 
 		// Collision response
-		if(Response) {
-			Contacts[i].surface.mode = dContactApprox1 | dContactSoftERP | dContactSoftCFM;
-			Contacts[i].surface.mu = std::min(Object->GetTemplate()->Friction, OtherObject->GetTemplate()->Friction);
-
-			// Handle ERP and CFM
-			Contacts[i].surface.soft_erp = std::min(Object->GetTemplate()->ERP, OtherObject->GetTemplate()->ERP);
-			Contacts[i].surface.soft_cfm = std::max(Object->GetTemplate()->CFM, OtherObject->GetTemplate()->CFM);
-
-			// Handle rolling friction
-			float RollingFriction = std::max(Object->GetTemplate()->RollingFriction, OtherObject->GetTemplate()->RollingFriction);
-			if(RollingFriction > 0) {
-				Contacts[i].surface.mode |= dContactRolling;
-				Contacts[i].surface.rho = RollingFriction;
-				Contacts[i].surface.rho2 = RollingFriction;
-			}
-
-			// Handle restitution
-			float Restitution = std::max(Object->GetTemplate()->Restitution, OtherObject->GetTemplate()->Restitution);
-			if(Restitution > 0) {
-				Contacts[i].surface.mode |= dContactBounce;
-				Contacts[i].surface.bounce = Restitution;
-				Contacts[i].surface.bounce_vel = 0;
-			}
+		if(Material.Response) {
+			Contacts[i].surface = Material.Surface;
 
 			// Create contact joint
 			dJointID Joint = dJointCreateContact(Physics.GetWorld(), Physics.GetContactGroup(), &Contacts[i]);
 			dJointAttach(Joint, Body, OtherBody);
 		}
 
-		// Get normal
-		glm::vec3 Normal(Contacts[i].geom.normal[0], Contacts[i].geom.normal[1], Contacts[i].geom.normal[2]);
+		if(Contacts[i].geom.normal[1] > Contacts[Up].geom.normal[1])
+			Up = i;
+		if(Contacts[i].geom.normal[1] < Contacts[Down].geom.normal[1])
+			Down = i;
+	}
+
+	// Contacts between the same pair can cancel out
+	float Length = glm::length(AverageNormal);
+	if(Length > 0.0f)
+		AverageNormal /= Length;
+
+	// Handle collision callback once per object, the normal is flipped for the other object
+	const dReal *Normal = Contacts[Up].geom.normal;
+	const dReal *OtherNormal = Contacts[Down].geom.normal;
+	CollideData->ObjectCollisions->push_back(_ObjectCollision(Object, OtherObject, glm::vec3(Normal[0], Normal[1], Normal[2]), 1, AverageNormal, Count));
+	CollideData->ObjectCollisions->push_back(_ObjectCollision(OtherObject, Object, glm::vec3(OtherNormal[0], OtherNormal[1], OtherNormal[2]), -1, -AverageNormal, Count));
+}
+
+// Build the contact surface for a pair of templates
+static void GetSurface(const _Template *Template, const _Template *OtherTemplate, _MaterialPair &Material) {
+	dSurfaceParameters &Surface = Material.Surface;
+	Surface = dSurfaceParameters();
 
-		// Handle collision callback
-		ObjectCollisions->push_back(_ObjectCollision(Object, OtherObject, Normal, 1));
-		ObjectCollisions->push_back(_ObjectCollision(OtherObject, Object, Normal, -1));
+	// Test for zones
+	Material.Response = !(Template->CollisionGroup & _Physics::FILTER_ZONE || OtherTemplate->CollisionGroup & _Physics::FILTER_ZONE);
+
+	Surface.mode = dContactApprox1 | dContactSoftERP | dContactSoftCFM;
+	Surface.mu = std::min(Template->Friction, OtherTemplate->Friction);
+
+	// Handle ERP and CFM
+	Surface.soft_erp = std::min(Template->ERP, OtherTemplate->ERP);
+	Surface.soft_cfm = std::max(Template->CFM, OtherTemplate->CFM);
+
+	// Handle rolling friction
+	float RollingFriction = std::max(Template->RollingFriction, OtherTemplate->RollingFriction);
+	if(RollingFriction > 0) {
+		Surface.mode |= dContactRolling;
+		Surface.rho = RollingFriction;
+		Surface.rho2 = RollingFriction;
+	}
+
+	// Handle restitution
+	float Restitution = std::max(Template->Restitution, OtherTemplate->Restitution);
+	if(Restitution > 0) {
+		Surface.mode |= dContactBounce;
+		Surface.bounce = Restitution;
+		Surface.bounce_vel = 0;
 	}
 }
 
@@ -116,13 +154,33 @@ int _Physics::Init() {
 	dInitODE();
 	dRandSetSeed(0);
 
+	// Set contact limits
+	SetContactLimits();
+
 	// Create world
 	World = dWorldCreate();
 	dWorldSetGravity(World, 0, -9.81, 0);
 	dWorldSetCFM(World, 0.0);
 
-	// Create space
-	Space = dHashSpaceCreate(0);
+	// Step islands on a thread pool
+	if(Config.PhysicsThreads > 1) {
+		ThreadingImplementation = dThreadingAllocateMultiThreadedImplementation();
+		ThreadPool = dThreadingAllocateThreadPool(Config.PhysicsThreads - 1, 0, dAllocateFlagBasicData, nullptr);
+		if(ThreadingImplementation && ThreadPool) {
+			dThreadingThreadPoolServeMultiThreadedImplementation(ThreadPool, ThreadingImplementation);
+			dWorldSetStepThreadingImplementation(World, dThreadingImplementationGetFunctions(ThreadingImplementation), ThreadingImplementation);
+			dWorldSetStepIslandsProcessingMaxThreadCount(World, Config.PhysicsThreads);
+		}
+		else {
+			Log.Write("Failed to create physics thread pool");
+			CloseThreadPool();
+		}
+	}
+
+	// Create spaces
+	Space = CreateSpace();
+	if(Broadphase.SplitStatic)
+		StaticSpace = CreateSpace();
 
 	// Create contact group
 	ContactGroup = dJointGroupCreate(0);
@@ -139,9 +197,15 @@ int _Physics::Close() {
 	if(ContactGroup)
 		dJointGroupDestroy(ContactGroup);
 
-	// Free space
+	// Free spaces
 	if(Space)
 		dSpaceDestroy(Space);
+	if(StaticSpace)
+		dSpaceDestroy(StaticSpace);
+	Space = StaticSpace = nullptr;
+
+	// Stop thread pool
+	CloseThreadPool();
 
 	// Free world
 	if(World)
@@ -156,20 +220,128 @@ int _Physics::Close() {
 	return 1;
 }
 
+// Create a collision space using the level's broadphase
+dSpaceID _Physics::CreateSpace() {
+
+	switch(Broadphase.Type) {
+		case _Broadphase::BROADPHASE_SAP:
+			return dSweepAndPruneSpaceCreate(0, Broadphase.AxisOrder);
+		case _Broadphase::BROADPHASE_QUADTREE: {
+			dVector3 Center = { Broadphase.Center[0], Broadphase.Center[1], Broadphase.Center[2], 0 };
+			dVector3 Extents = { Broadphase.Extents[0], Broadphase.Extents[1], Broadphase.Extents[2], 0 };
+			return dQuadTreeSpaceCreate(0, Center, Extents, Broadphase.Depth);
+		}
+		default: {
+			dSpaceID HashSpace = dHashSpaceCreate(0);
+			dHashSpaceSetLevels(HashSpace, Broadphase.MinLevel, Broadphase.MaxLevel);
+			return HashSpace;
+		}
+	}
+}
+
+// Set the maximum contacts generated for each pair of geometry classes
+void _Physics::SetContactLimits() {
+	for(int i = 0; i < dGeomNumClasses; i++) {
+		for(int j = 0; j < dGeomNumClasses; j++)
+			ContactLimits[i][j] = MAX_CONTACTS;
+	}
+
+	// Spheres touch convex primitives at a single point
+	SetContactLimit(dSphereClass, dSphereClass, 1);
+	SetContactLimit(dSphereClass, dBoxClass, 1);
+	SetContactLimit(dSphereClass, dPlaneClass, 1);
+	SetContactLimit(dSphereClass, dCylinderClass, 1);
+
+	// Box face clipping produces at most 8 points, and ODE caps box-plane at 4
+	SetContactLimit(dBoxClass, dBoxClass, 8);
+	SetContactLimit(dBoxClass, dPlaneClass, 4);
+}
+
+// Set the contact limit for a pair of geometry classes in both orders
+void _Physics::SetContactLimit(int Class, int OtherClass, int Limit) {
+	ContactLimits[Class][OtherClass] = Limit;
+	ContactLimits[OtherClass][Class] = Limit;
+}
+
+// Precompute contact surfaces for every pair of templates
+void _Physics::SetMaterials(const std::vector<_Template *> &Templates) {
+	MaterialCount = (int)Templates.size();
+	Materials.resize(MaterialCount * MaterialCount);
+	for(int i = 0; i < MaterialCount; i++) {
+		Templates[i]->MaterialIndex = i;
+		for(int j = 0; j < MaterialCount; j++)
+			GetSurface(Templates[i], Templates[j], Materials[i * MaterialCount + j]);
+	}
+}
+
+// Get the contact surface for a pair of templates
+const _MaterialPair &_Physics::GetMaterialPair(const _Template *Template, const _Template *OtherTemplate) {
+	int Index = Template->MaterialIndex;
+	int OtherIndex = OtherTemplate->MaterialIndex;
+	if(Index >= 0 && Index < MaterialCount && OtherIndex >= 0 && OtherIndex < MaterialCount)
+		return Materials[Index * MaterialCount + OtherIndex];
+
+	// Template was not part of the level
+	GetSurface(Template, OtherTemplate, ScratchMaterial);
+
+	return ScratchMaterial;
+}
+
+// Move a geom without a body into the static space, where it is never collided against itself
+void _Physics::SetStatic(dGeomID Geometry) {
+	dSpaceID GeometrySpace = dGeomGetSpace(Geometry);
+	if(!StaticSpace || GeometrySpace == StaticSpace)
+		return;
+
+	if(GeometrySpace)
+		dSpaceRemove(GeometrySpace, Geometry);
+	dSpaceAdd(StaticSpace, Geometry);
+}
+
+// Stops the island stepping threads
+void _Physics::CloseThreadPool() {
+
+	if(ThreadingImplementation) {
+		dThreadingImplementationShutdownProcessing(ThreadingImplementation);
+		dWorldSetStepThreadingImplementation(World, nullptr, nullptr);
+	}
+
+	if(ThreadPool)
+		dThreadingFreeThreadPool(ThreadPool);
+
+	if(ThreadingImplementation)
+		dThreadingFreeImplementation(ThreadingImplementation);
+
+	ThreadPool = nullptr;
+	ThreadingImplementation = nullptr;
+}
+
 // Updates the physics system
 void _Physics::Update(float FrameTime) {
 	if(Enabled) {
-
-		// Handle collisions
-		dSpaceCollide(Space, &ObjectCollisions, &ODECallback);
+		_ProfileScope Scope(_Profiler::PHYSICS);
+
+		// Handle collisions between bodies, then bodies against static geoms
+		_CollideData CollideData = { &ObjectCollisions, &CollisionStats };
+		{
+			_ProfileScope CollideScope(_Profiler::COLLIDE);
+			dSpaceCollide(Space, &CollideData, &ODECallback);
+			if(StaticSpace)
+				dSpaceCollide2((dGeomID)Space, (dGeomID)StaticSpace, &CollideData, &ODECallback);
+		}
 
 		// Handle callbacks
-		for(auto ObjectCollision : ObjectCollisions)
+		for(const auto &ObjectCollision : ObjectCollisions)
 			ObjectCollision.Object->HandleCollision(ObjectCollision);
+		CollisionStats.Events += ObjectCollisions.size();
 		ObjectCollisions.clear();
+		Scripting.FlushCollisions();
 
 		// Run timestep
-		dWorldQuickStep(World, FrameTime);
+		{
+			_ProfileScope StepScope(_Profiler::STEP);
+			dWorldQuickStep(World, FrameTime);
+		}
 
 		// Remove contact joints
 		dJointGroupEmpty(ContactGroup);
@@ -201,6 +373,8 @@ bool _Physics::RaycastWorld(const glm::vec3 &Start, glm::vec3 &End) {
 		// Check collisions
 		dVector4 HitPosition = { 0, 0, 0, dInfinity };
 		dSpaceCollide2(Ray, (dGeomID)Space, HitPosition, &RayCallback);
+		if(StaticSpace)
+			dSpaceCollide2(Ray, (dGeomID)StaticSpace, HitPosition, &RayCallback);
 
 		// Cleanup
 		dGeomDestroy(Ray);
@@ -17,6 +17,10 @@
 *******************************************************************************/
 #pragma once
 #include <ode/common.h>
+#include <ode/collision.h>
+#include <ode/collision_space.h>
+#include <ode/contact.h>
+#include <ode/threading_impl.h>
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
@@ -26,15 +30,65 @@ const float PHYSICS_TIMESTEP = 1.0f / 500.0f;
 
 // Forward Declarations
 class _Object;
+struct _Template;
 
 // Structures
+struct _Broadphase {
+	_Broadphase() : Type(BROADPHASE_HASH), SplitStatic(true), MinLevel(-3), MaxLevel(10), AxisOrder(dSAP_AXES_XZY), Center(0.0f), Extents(100.0f), Depth(5) { }
+
+	enum BroadphaseType {
+		BROADPHASE_HASH,
+		BROADPHASE_SAP,
+		BROADPHASE_QUADTREE,
+	};
+
+	// Type of collision space
+	int Type;
+
+	// Keep geoms without bodies in their own space
+	bool SplitStatic;
+
+	// Hash space cell sizes as powers of two
+	int MinLevel, MaxLevel;
+
+	// Sweep and prune axis order
+	int AxisOrder;
+
+	// Quadtree bounds, ODE subdivides along the x and y axes
+	glm::vec3 Center;
+	glm::vec3 Extents;
+	int Depth;
+};
+
+// Collision counters
+struct _CollisionStats {
+	_CollisionStats() : NearCalls(0), Contacts(0), Events(0) { }
+
+	uint64_t NearCalls;
+	uint64_t Contacts;
+	uint64_t Events;
+};
+
+// Contact surface shared by a pair of templates
+struct _MaterialPair {
+	_MaterialPair() : Surface(), Response(true) { }
+
+	dSurfaceParameters Surface;
+	bool Response;
+};
+
 struct _ObjectCollision {
-	_ObjectCollision(_Object *Object, _Object *OtherObject, const glm::vec3 &Normal, float NormalScale) : Object(Object), OtherObject(OtherObject), Normal(Normal), NormalScale(NormalScale) { }
+	_ObjectCollision(_Object *Object, _Object *OtherObject, const glm::vec3 &Normal, float NormalScale, const glm::vec3 &AverageNormal, int ContactCount) :
+		Object(Object), OtherObject(OtherObject), Normal(Normal), NormalScale(NormalScale), AverageNormal(AverageNormal), ContactCount(ContactCount) { }
 
 	_Object *Object;
 	_Object *OtherObject;
 	glm::vec3 Normal;
 	float NormalScale;
+
+	// Mean contact normal pointing away from the other object, and the number of contacts it came from
+	glm::vec3 AverageNormal;
+	int ContactCount;
 };
 
 // Classes
@@ -50,7 +104,7 @@ class _Physics {
 			FILTER_ZONE			= 0x8,
 		};
 
-		_Physics() : Enabled(false) { }
+		_Physics() : Enabled(false), Space(nullptr), StaticSpace(nullptr), MaterialCount(0), ThreadingImplementation(nullptr), ThreadPool(nullptr) { }
 		int Init();
 		int Close();
 
@@ -63,21 +117,55 @@ class _Physics {
 		dWorldID GetWorld() { return World; }
 		dJointGroupID GetContactGroup() { return ContactGroup; }
 		dSpaceID GetSpace() { return Space; }
+		dSpaceID GetStaticSpace() { return StaticSpace; }
+		void SetStatic(dGeomID Geometry);
+
+		void SetBroadphase(const _Broadphase &Value) { Broadphase = Value; }
+		const _Broadphase &GetBroadphase() const { return Broadphase; }
 
 		void SetEnabled(bool Value) { Enabled = Value; }
 		bool IsEnabled() const { return Enabled; }
 		void RemoveFilter(int &Value, int Filter);
 
+		void SetMaterials(const std::vector<_Template *> &Templates);
+		const _MaterialPair &GetMaterialPair(const _Template *Template, const _Template *OtherTemplate);
+		int GetContactLimit(dGeomID Geometry, dGeomID OtherGeometry) const { return ContactLimits[dGeomGetClass(Geometry)][dGeomGetClass(OtherGeometry)]; }
+
+		const _CollisionStats &GetCollisionStats() const { return CollisionStats; }
+		void ResetCollisionStats() { CollisionStats = _CollisionStats(); }
+
 		void Dump();
 
 	private:
 
+		dSpaceID CreateSpace();
+		void SetContactLimits();
+		void SetContactLimit(int Class, int OtherClass, int Limit);
+		void CloseThreadPool();
+
 		bool Enabled;
 
 		dWorldID World;
 		dJointGroupID ContactGroup;
+		// Bodies live in the dynamic space, geoms without bodies in the static space
 		dSpaceID Space;
+		dSpaceID StaticSpace;
+		_Broadphase Broadphase;
+		_CollisionStats CollisionStats;
+
+		// Contact limits indexed by geometry class
+		int ContactLimits[dGeomNumClasses][dGeomNumClasses];
+
+		// Surfaces for every pair of level templates, indexed by _Template::MaterialIndex
+		std::vector<_MaterialPair> Materials;
+		int MaterialCount;
+		_MaterialPair ScratchMaterial;
+
+		// Thread pool used to step islands
+		dThreadingImplementationID ThreadingImplementation;
+		dThreadingThreadPoolID ThreadPool;
 
+		// Collision events, reused every step
 		std::vector<_ObjectCollision> ObjectCollisions;
 
 };
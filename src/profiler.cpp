@@ -0,0 +1,151 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <profiler.h>
+#include <log.h>
+#include <algorithm>
+#include <cstdio>
+
+_Profiler Profiler;
+
+// Names shown in the overlay and trace
+static const char *PROFILER_SECTION_NAMES[_Profiler::COUNT] = {
+	"Frame",
+	"Physics",
+	"Collide",
+	"Step",
+	"Objects",
+	"EndFrame",
+	"Timers",
+	"Lua",
+	"Interpolate",
+	"Scene draw",
+	"GUI draw",
+};
+
+// Constructor
+_Profiler::_Profiler() :
+	ShowOverlay(false),
+	WriteIndex(0),
+	FrameStartIndex(0),
+	Frame(0),
+	HistoryIndex(0),
+	HistoryCount(0),
+	Enabled(false) {
+
+}
+
+// Start or stop recording, the ring buffer is allocated on first use
+void _Profiler::SetEnabled(bool Value) {
+	if(Value && !Samples) {
+		Samples.reset(new _ProfileSample[PROFILER_SAMPLES]);
+		StartTime = std::chrono::high_resolution_clock::now();
+	}
+
+	Enabled = Value;
+}
+
+// Add a sample, overwriting the oldest one when the ring is full
+void _Profiler::Record(int Section, int64_t Start, int64_t End) {
+	uint64_t Index = WriteIndex.fetch_add(1, std::memory_order_relaxed);
+
+	_ProfileSample &Sample = Samples[Index & (PROFILER_SAMPLES - 1)];
+	Sample.Start = Start;
+	Sample.Duration = End - Start;
+	Sample.Frame = Frame;
+	Sample.Section = (uint8_t)Section;
+}
+
+// Sum the samples of the last frame into the rolling history
+void _Profiler::EndFrame() {
+	if(!Enabled)
+		return;
+
+	uint64_t EndIndex = WriteIndex.load(std::memory_order_acquire);
+	if(EndIndex - FrameStartIndex > PROFILER_SAMPLES)
+		FrameStartIndex = EndIndex - PROFILER_SAMPLES;
+
+	float Totals[COUNT] = { 0 };
+	for(uint64_t i = FrameStartIndex; i < EndIndex; i++) {
+		const _ProfileSample &Sample = Samples[i & (PROFILER_SAMPLES - 1)];
+		Totals[Sample.Section] += Sample.Duration * 1e-6f;
+	}
+
+	for(int i = 0; i < COUNT; i++)
+		History[i][HistoryIndex] = Totals[i];
+
+	HistoryIndex = (HistoryIndex + 1) % PROFILER_HISTORY;
+	HistoryCount = std::min(HistoryCount + 1, PROFILER_HISTORY);
+	FrameStartIndex = EndIndex;
+	Frame++;
+}
+
+// Get the minimum, average and maximum time per frame of a section in milliseconds
+void _Profiler::GetStats(int Section, double &Minimum, double &Average, double &Maximum) const {
+	Minimum = Average = Maximum = 0.0;
+	if(!HistoryCount)
+		return;
+
+	Minimum = History[Section][0];
+	for(int i = 0; i < HistoryCount; i++) {
+		float Value = History[Section][i];
+		Minimum = std::min(Minimum, (double)Value);
+		Maximum = std::max(Maximum, (double)Value);
+		Average += Value;
+	}
+	Average /= HistoryCount;
+}
+
+// Write the samples in the ring buffer as a Chrome trace, viewable in chrome://tracing or Perfetto
+bool _Profiler::ExportTrace(const std::string &Path) const {
+	if(!Samples)
+		return false;
+
+	FILE *File = fopen(Path.c_str(), "w");
+	if(!File) {
+		Log.Write("Unable to open %s for writing", Path.c_str());
+		return false;
+	}
+
+	uint64_t EndIndex = WriteIndex.load(std::memory_order_acquire);
+	uint64_t StartIndex = EndIndex > PROFILER_SAMPLES ? EndIndex - PROFILER_SAMPLES : 0;
+
+	fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for(uint64_t i = StartIndex; i < EndIndex; i++) {
+		const _ProfileSample &Sample = Samples[i & (PROFILER_SAMPLES - 1)];
+		fprintf(File, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"frame\":%u}}%s\n",
+			GetSectionName(Sample.Section),
+			Sample.Start * 1e-3,
+			Sample.Duration * 1e-3,
+			Sample.Frame,
+			i + 1 < EndIndex ? "," : "");
+	}
+	fprintf(File, "]}\n");
+	fclose(File);
+
+	Log.Write("Wrote %d profiler samples to %s", (int)(EndIndex - StartIndex), Path.c_str());
+
+	return true;
+}
+
+// Get the display name of a section
+const char *_Profiler::GetSectionName(int Section) {
+	if(Section < 0 || Section >= COUNT)
+		return "";
+
+	return PROFILER_SECTION_NAMES[Section];
+}
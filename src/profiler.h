@@ -0,0 +1,115 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Constants
+
+// Samples kept in the ring buffer, must be a power of two
+const uint64_t PROFILER_SAMPLES = 1 << 17;
+
+// Frames used for the rolling overlay statistics
+const int PROFILER_HISTORY = 120;
+
+// Timed span of one section, times are in nanoseconds since the profiler was enabled
+struct _ProfileSample {
+	int64_t Start;
+	int64_t Duration;
+	uint32_t Frame;
+	uint8_t Section;
+};
+
+// Records timed sections into a ring buffer for an overlay and trace exports
+class _Profiler {
+
+	public:
+
+		enum SectionType {
+			FRAME,
+			PHYSICS,
+			COLLIDE,
+			STEP,
+			OBJECTS_UPDATE,
+			OBJECTS_END_FRAME,
+			TIMERS,
+			LUA,
+			INTERPOLATE,
+			SCENE_DRAW,
+			GUI_DRAW,
+			COUNT,
+		};
+
+		_Profiler();
+
+		void SetEnabled(bool Value);
+		bool IsEnabled() const { return Enabled; }
+
+		int64_t GetTime() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - StartTime).count(); }
+		void Record(int Section, int64_t Start, int64_t End);
+		void EndFrame();
+
+		void GetStats(int Section, double &Minimum, double &Average, double &Maximum) const;
+		bool ExportTrace(const std::string &Path) const;
+		static const char *GetSectionName(int Section);
+
+		bool ShowOverlay;
+
+	private:
+
+		// Ring buffer, slots are claimed with an atomic increment
+		std::unique_ptr<_ProfileSample[]> Samples;
+		std::atomic<uint64_t> WriteIndex;
+		uint64_t FrameStartIndex;
+		uint32_t Frame;
+
+		// Per section totals of recent frames in milliseconds
+		float History[COUNT][PROFILER_HISTORY];
+		int HistoryIndex;
+		int HistoryCount;
+
+		std::chrono::high_resolution_clock::time_point StartTime;
+		bool Enabled;
+
+};
+
+// Singletons
+extern _Profiler Profiler;
+
+// Times a section until the end of the scope
+class _ProfileScope {
+
+	public:
+
+		_ProfileScope(int Section) : Section(Section), Start(Profiler.IsEnabled() ? Profiler.GetTime() : -1) { }
+		~_ProfileScope() {
+			if(Start >= 0)
+				Profiler.Record(Section, Start, Profiler.GetTime());
+		}
+
+	private:
+
+		int Section;
+		int64_t Start;
+
+};
@@ -16,15 +16,39 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #include <replay.h>
+#include <replaycodec.h>
+#include <mappedfile.h>
 #include <save.h>
 #include <log.h>
 #include <config.h>
 #include <level.h>
 #include <framework.h>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#endif
 
 _Replay Replay;
 
+// Constructor
+_Replay::_Replay() :
+	Encoding(ENCODING_RAW),
+	ObjectDataStart(0),
+	ObjectDataSize(0),
+	EndOfData(false),
+	NextKeyframeTime(0.0f),
+	Time(0.0f),
+	State(STATE_NONE) {
+
+}
+
 // Start recording a replay
 void _Replay::StartRecording() {
 	if(State != STATE_NONE)
@@ -33,6 +57,9 @@ void _Replay::StartRecording() {
 	// Set up state
 	State = STATE_RECORDING;
 	Time = 0;
+	NextKeyframeTime = 0;
+	Keyframes.clear();
+	Encoding = Config.CompressReplays ? ENCODING_COMPRESSED : ENCODING_RAW;
 
 	// Get header information
 	ReplayVersion = REPLAY_VERSION;
@@ -41,8 +68,7 @@ void _Replay::StartRecording() {
 
 	// Create replay file for object data
 	ReplayDataFile = Save.ReplayPath + "replay.dat";
-	File.open(ReplayDataFile.c_str(), std::ios::out | std::ios::binary);
-	if(!File.is_open())
+	if(!Writer.Open(ReplayDataFile))
 		Log.Write("Unable to open: %s", ReplayDataFile.c_str());
 }
 
@@ -51,7 +77,7 @@ void _Replay::StopRecording() {
 
 	if(State == STATE_RECORDING) {
 		State = STATE_NONE;
-		File.close();
+		Writer.Close();
 		remove(ReplayDataFile.c_str());
 	}
 }
@@ -61,165 +87,270 @@ bool _Replay::SaveReplay(const std::string &PlayerDescription, bool Autosave, bo
 	Description = PlayerDescription;
 	Timestamp = time(nullptr);
 	FinishTime = Time;
-
-	// Flush current replay file
-	File.flush();
+	TimeStep = Framework.GetTimeStep();
+	Platform = PLATFORM;
+	this->Autosave = Autosave;
+	this->Won = Won;
 
 	// Get new file name
 	std::stringstream ReplayFilePath;
 	ReplayFilePath << Save.ReplayPath << (uint32_t)Timestamp << "-" << Level.LevelName << ".replay";
 
-	// Open new file
-	std::fstream NewFile(ReplayFilePath.str().c_str(), std::ios::out | std::ios::binary);
+	// Map recorded object data from the spool file
+	_MappedFile Data;
+	if(!Writer.Flush() || (Writer.GetSize() && !Data.Open(Writer.GetPath()))) {
+		Log.Write("Unable to read replay data: %s", Writer.GetPath().c_str());
+		return false;
+	}
+
+	// Compress object data
+	const char *EventData = Data.GetData();
+	size_t EventSize = Data.GetSize();
+	std::string EncodedData;
+	if(Encoding == ENCODING_COMPRESSED) {
+		_ReplayCodec Codec;
+		if(!Codec.Encode(Data.GetData(), Data.GetSize(), TimeStep, EncodedData)) {
+			Log.Write("Unable to encode replay: %s", ReplayFilePath.str().c_str());
+			return false;
+		}
+
+		EventData = EncodedData.data();
+		EventSize = EncodedData.size();
+	}
+
+	// Write to a temporary file first so a failed save doesn't leave a partial replay
+	std::string TempPath = Save.ReplayPath + "replay.tmp";
+	std::fstream NewFile(TempPath.c_str(), std::ios::out | std::ios::binary);
+	if(!NewFile) {
+		Log.Write("Unable to open for writing: %s", TempPath.c_str());
+		return false;
+	}
+
+	// Write object data and keyframe index after the header
+	WriteHeader(NewFile, (uint32_t)EventSize);
+	NewFile.write(EventData, EventSize);
+	WriteChunk(NewFile, PACKET_INDEX, (char *)Keyframes.data(), Keyframes.size() * sizeof(_ReplayKeyframe));
+	NewFile.close();
+
+	// Move into place
+#ifdef _WIN32
+	bool Moved = NewFile && MoveFileExA(TempPath.c_str(), ReplayFilePath.str().c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+	bool Moved = NewFile && rename(TempPath.c_str(), ReplayFilePath.str().c_str()) == 0;
+#endif
+	if(!Moved) {
+		Log.Write("Unable to write replay: %s", ReplayFilePath.str().c_str());
+		remove(TempPath.c_str());
+	}
+
+	return Moved;
+}
+
+// Convert a replay from an older version to the compressed format
+bool _Replay::ConvertReplay(const std::string &InputFile, const std::string &OutputFile) {
+	if(!LoadReplay(InputFile)) {
+		Log.Write("Cannot load replay: %s", InputFile.c_str());
+		return false;
+	}
+
+	// Copy raw object data
+	std::string Data(Reader.GetEventData(), Reader.GetEventSize());
+	StopReplay();
+
+	// Add keyframes and compress
+	_ReplayCodec Codec;
+	std::string EncodedData;
+	if(Keyframes.empty()) {
+		std::string KeyframeData;
+		if(!Codec.InsertKeyframes(Data.data(), Data.size(), KeyframeData, Keyframes)) {
+			Log.Write("Invalid object data: %s", InputFile.c_str());
+			return false;
+		}
+		Data.swap(KeyframeData);
+	}
+	if(!Codec.Encode(Data.data(), Data.size(), TimeStep, EncodedData)) {
+		Log.Write("Unable to encode replay: %s", InputFile.c_str());
+		return false;
+	}
+
+	// Write new file
+	std::fstream NewFile(OutputFile.c_str(), std::ios::out | std::ios::binary);
 	if(!NewFile) {
-		Log.Write("Unable to open for writing: %s", ReplayFilePath.str().c_str());
+		Log.Write("Unable to open for writing: %s", OutputFile.c_str());
 		return false;
 	}
 
+	// Keep replays recorded with the old timer order on the last version that used it
+	int32_t OldVersion = ReplayVersion;
+	ReplayVersion = OldVersion < REPLAY_TIMER_ORDER_VERSION ? REPLAY_TIMER_ORDER_VERSION - 1 : REPLAY_VERSION;
+	Encoding = ENCODING_COMPRESSED;
+	WriteHeader(NewFile, (uint32_t)EncodedData.size());
+	NewFile.write(EncodedData.data(), EncodedData.size());
+	WriteChunk(NewFile, PACKET_INDEX, (char *)Keyframes.data(), Keyframes.size() * sizeof(_ReplayKeyframe));
+	uint32_t NewSize = (uint32_t)NewFile.tellp();
+	NewFile.close();
+
+	Log.Write("Converted %s version %d to %d, object data %d -> %d bytes (%.1fx), file size %d bytes",
+		InputFile.c_str(), OldVersion, ReplayVersion, (int)Data.size(), (int)EncodedData.size(), Data.size() / (double)std::max((size_t)1, EncodedData.size()), NewSize);
+
+	return true;
+}
+
+// Write header chunks and start the object data chunk
+void _Replay::WriteHeader(std::fstream &OutFile, uint32_t DataSize) {
+
 	// Write platform
-	char Platform = PLATFORM;
-	WriteChunk(NewFile, PACKET_PLATFORM, (char *)&Platform, sizeof(Platform));
+	WriteChunk(OutFile, PACKET_PLATFORM, (char *)&Platform, sizeof(Platform));
 
 	// Write replay version
-	WriteChunk(NewFile, PACKET_REPLAYVERSION, (char *)&ReplayVersion, sizeof(ReplayVersion));
+	WriteChunk(OutFile, PACKET_REPLAYVERSION, (char *)&ReplayVersion, sizeof(ReplayVersion));
 
 	// Write level version
-	WriteChunk(NewFile, PACKET_LEVELVERSION, (char *)&LevelVersion, sizeof(LevelVersion));
+	WriteChunk(OutFile, PACKET_LEVELVERSION, (char *)&LevelVersion, sizeof(LevelVersion));
 
 	// Write timestep value
-	WriteChunk(NewFile, PACKET_TIMESTEP, (char *)&Framework.GetTimeStep(), sizeof(Framework.GetTimeStep()));
+	WriteChunk(OutFile, PACKET_TIMESTEP, (char *)&TimeStep, sizeof(TimeStep));
 
 	// Write level file
-	WriteChunk(NewFile, PACKET_LEVELFILE, LevelName.c_str(), LevelName.length());
+	WriteChunk(OutFile, PACKET_LEVELFILE, LevelName.c_str(), LevelName.length());
 
 	// Write player's description of replay
-	WriteChunk(NewFile, PACKET_DESCRIPTION, Description.c_str(), Description.length());
+	WriteChunk(OutFile, PACKET_DESCRIPTION, Description.c_str(), Description.length());
 
 	// Write time stamp
-	WriteChunk(NewFile, PACKET_DATE, (char *)&Timestamp, sizeof(Timestamp));
+	WriteChunk(OutFile, PACKET_DATE, (char *)&Timestamp, sizeof(Timestamp));
 
 	// Write finish time
-	WriteChunk(NewFile, PACKET_FINISHTIME, (char *)&FinishTime, sizeof(FinishTime));
+	WriteChunk(OutFile, PACKET_FINISHTIME, (char *)&FinishTime, sizeof(FinishTime));
 
 	// Write autosave value
-	WriteChunk(NewFile, PACKET_AUTOSAVE, (char *)&Autosave, sizeof(Autosave));
+	WriteChunk(OutFile, PACKET_AUTOSAVE, (char *)&Autosave, sizeof(Autosave));
 
 	// Write won value
-	WriteChunk(NewFile, PACKET_WON, (char *)&Won, sizeof(Won));
+	WriteChunk(OutFile, PACKET_WON, (char *)&Won, sizeof(Won));
 
-	// Finished with header
-	NewFile.put(PACKET_OBJECTDATA);
-	uint32_t Dummy = 0;
-	NewFile.write((char *)&Dummy, sizeof(Dummy));
-
-	// Copy current data to new replay file
-	std::ifstream CurrentReplayFile(ReplayDataFile.c_str(), std::ios::in | std::ios::binary);
-	char Buffer[4096];
-	std::streamsize BytesRead;
-	while(!CurrentReplayFile.eof()) {
-		CurrentReplayFile.read(Buffer, 4096);
-		BytesRead = CurrentReplayFile.gcount();
-
-		if(BytesRead)
-			NewFile.write(Buffer, (uint32_t)BytesRead);
-	}
-
-	CurrentReplayFile.close();
-	NewFile.close();
+	// Write object data encoding
+	WriteChunk(OutFile, PACKET_ENCODING, (char *)&Encoding, sizeof(Encoding));
 
-	return true;
+	// Finished with header
+	OutFile.put(PACKET_OBJECTDATA);
+	OutFile.write((char *)&DataSize, sizeof(DataSize));
 }
 
-// Load header data
-void _Replay::LoadHeader() {
-	bool Debug = false;
+// Load header data, returns false if the header is invalid
+bool _Replay::LoadHeader() {
+	const char *Data = Reader.GetData();
+	size_t Size = Reader.GetSize();
+	size_t Offset = 0;
+	while(Size - Offset >= sizeof(char) + sizeof(uint32_t)) {
+		char PacketType = Data[Offset];
+		uint32_t PacketSize;
+		memcpy(&PacketSize, Data + Offset + 1, sizeof(PacketSize));
+		Offset += sizeof(char) + sizeof(PacketSize);
+
+		// Object data follows the header, older versions don't store its size
+		if(PacketType == PACKET_OBJECTDATA) {
+			ObjectDataStart = Offset;
+			ObjectDataSize = PacketSize ? PacketSize : (uint32_t)(Size - Offset);
+			return ObjectDataSize <= Size - Offset;
+		}
 
-	// Write replay version
-	char PacketType;
-	uint32_t PacketSize;
-	bool Done = false;
-	char Buffer[1024];
-	while(!File.eof() && !Done) {
-		PacketType = File.get();
-		File.read((char *)&PacketSize, sizeof(PacketSize));
+		// Check chunk size
+		if(PacketSize > Size - Offset)
+			return false;
+
+		const char *Packet = Data + Offset;
+		Offset += PacketSize;
 		switch(PacketType) {
 			case PACKET_REPLAYVERSION:
-				File.read((char *)&ReplayVersion, sizeof(ReplayVersion));
-				if(ReplayVersion != REPLAY_VERSION)
-					Done = true;
-
-				if(Debug)
-					Log.Write("ReplayVersion=%d, PacketSize=%d sizeof=%d", ReplayVersion, PacketSize, sizeof(ReplayVersion));
+				if(!ReadChunk(Packet, PacketSize, ReplayVersion) || ReplayVersion < REPLAY_MIN_VERSION || ReplayVersion > REPLAY_VERSION)
+					return false;
 			break;
 			case PACKET_LEVELVERSION:
-				File.read((char *)&LevelVersion, sizeof(LevelVersion));
-
-				if(Debug)
-					Log.Write("LevelVersion=%d, PacketSize=%d sizeof=%d", LevelVersion, PacketSize, sizeof(LevelVersion));
+				ReadChunk(Packet, PacketSize, LevelVersion);
 			break;
 			case PACKET_LEVELFILE:
-				if(PacketSize > 1024)
-					PacketSize = 1024;
-				File.read(Buffer, PacketSize);
-				Buffer[PacketSize] = 0;
-				LevelName = Buffer;
-
-				if(Debug)
-					Log.Write("LevelName=%s, PacketSize=%d", Buffer, PacketSize);
+				LevelName.assign(Packet, std::min(PacketSize, (uint32_t)1024));
 			break;
 			case PACKET_DESCRIPTION:
-				if(PacketSize > 1024)
-					PacketSize = 1024;
-				File.read(Buffer, PacketSize);
-				Buffer[PacketSize] = 0;
-				Description = Buffer;
-
-				if(Debug)
-					Log.Write("Description=%s, PacketSize=%d", Buffer, PacketSize);
+				Description.assign(Packet, std::min(PacketSize, (uint32_t)1024));
 			break;
 			case PACKET_DATE:
-				if(PacketSize > 8)
-					PacketSize = 8;
-				File.read((char *)&Timestamp, PacketSize);
-
-				if(Debug)
-					Log.Write("Timestamp=%d, PacketSize=%d sizeof=%d", Timestamp, PacketSize, sizeof(Timestamp));
+				Timestamp = 0;
+				memcpy(&Timestamp, Packet, std::min(PacketSize, (uint32_t)sizeof(Timestamp)));
 			break;
 			case PACKET_FINISHTIME:
-				File.read((char *)&FinishTime, sizeof(FinishTime));
-
-				if(Debug)
-					Log.Write("FinishTime=%f, PacketSize=%d sizeof=%d", FinishTime, PacketSize, sizeof(FinishTime));
+				if(!ReadChunk(Packet, PacketSize, FinishTime) || !std::isfinite(FinishTime) || FinishTime < 0.0f)
+					return false;
 			break;
 			case PACKET_TIMESTEP:
-				File.read((char *)&TimeStep, sizeof(TimeStep));
-
-				if(Debug)
-					Log.Write("TimeStep=%f, PacketSize=%d sizeof=%d", TimeStep, PacketSize, sizeof(TimeStep));
+				ReadChunk(Packet, PacketSize, TimeStep);
 			break;
 			case PACKET_AUTOSAVE:
-				Autosave = File.get();
-
-				if(Debug)
-					Log.Write("Autosave=%d, PacketSize=%d", Autosave, PacketSize);
+				ReadChunk(Packet, PacketSize, Autosave);
 			break;
 			case PACKET_WON:
-				Won = File.get();
-
-				if(Debug)
-					Log.Write("Won=%d, PacketSize=%d", Won, PacketSize);
+				ReadChunk(Packet, PacketSize, Won);
 			break;
 			case PACKET_PLATFORM:
-				Platform = File.get();
-			break;
-			case PACKET_OBJECTDATA:
-				Done = true;
+				ReadChunk(Packet, PacketSize, Platform);
 			break;
-			default:
-				File.ignore(PacketSize);
+			case PACKET_ENCODING:
+				ReadChunk(Packet, PacketSize, Encoding);
 			break;
 		}
 	}
+
+	return false;
+}
+
+// Load keyframe index that follows the object data
+void _Replay::LoadIndex() {
+	if(ReplayVersion < 5)
+		return;
+
+	// Find index chunk
+	const char *Data = Reader.GetData();
+	size_t Offset = ObjectDataStart + ObjectDataSize;
+	if(Reader.GetSize() - Offset < sizeof(char) + sizeof(uint32_t) || Data[Offset] != PACKET_INDEX)
+		return;
+
+	uint32_t PacketSize;
+	memcpy(&PacketSize, Data + Offset + 1, sizeof(PacketSize));
+	Offset += sizeof(char) + sizeof(PacketSize);
+	if(PacketSize > Reader.GetSize() - Offset)
+		return;
+
+	// Only keep entries that point to keyframe events
+	Keyframes.resize(PacketSize / sizeof(_ReplayKeyframe));
+	memcpy(Keyframes.data(), Data + Offset, Keyframes.size() * sizeof(_ReplayKeyframe));
+	Keyframes.erase(std::remove_if(Keyframes.begin(), Keyframes.end(), [this](const _ReplayKeyframe &Keyframe) {
+		return !Reader.IsKeyframeOffset(Keyframe.Offset);
+	}), Keyframes.end());
+}
+
+// Decompress object data into memory and play back from there
+bool _Replay::DecodeObjectData() {
+	_ReplayCodec Codec;
+	std::string Data;
+	if(!Codec.Decode(Reader.GetData() + ObjectDataStart, ObjectDataSize, TimeStep, Data, Keyframes))
+		return false;
+
+	// Replace mapped file with raw event data
+	Reader.SetDecodedEventData(Data);
+	ObjectDataStart = 0;
+	ObjectDataSize = (uint32_t)Reader.GetEventSize();
+
+	return true;
+}
+
+// Read a fixed size header chunk
+template<typename T> bool _Replay::ReadChunk(const char *Data, uint32_t Size, T &Value) {
+	if(Size < sizeof(Value))
+		return false;
+
+	memcpy(&Value, Data, sizeof(Value));
+	return true;
 }
 
 // Write a replay chunk
@@ -240,6 +371,12 @@ bool _Replay::NeedsPacket() {
 	return State == STATE_RECORDING;
 }
 
+// Determines if a keyframe is due
+bool _Replay::NeedsKeyframe() {
+
+	return State == STATE_RECORDING && Time >= NextKeyframeTime;
+}
+
 // Starts replay
 bool _Replay::LoadReplay(const std::string &ReplayFile, bool HeaderOnly) {
 	LevelName = "";
@@ -248,23 +385,48 @@ bool _Replay::LoadReplay(const std::string &ReplayFile, bool HeaderOnly) {
 	Autosave = false;
 	Won = false;
 	Platform = 0;
+	ObjectDataStart = 0;
+	ObjectDataSize = 0;
+	EndOfData = false;
+	Encoding = ENCODING_RAW;
+	TimeStep = Framework.GetTimeStep();
+	Keyframes.clear();
 
 	// Try absolute path
-	File.open(ReplayFile.c_str(), std::ios::in | std::ios::binary);
-	if(!File) {
+	if(!Reader.Open(ReplayFile)) {
 
 		// Pass only file name
-		File.open((Save.ReplayPath + ReplayFile).c_str(), std::ios::in | std::ios::binary);
-		if(!File)
+		if(!Reader.Open(Save.ReplayPath + ReplayFile))
 			return false;
 	}
 
 	// Read header
-	LoadHeader();
+	if(!LoadHeader()) {
+		Reader.Close();
+		return false;
+	}
 
 	// Read only the header
-	if(HeaderOnly)
-		File.close();
+	if(HeaderOnly) {
+		Reader.Close();
+		return true;
+	}
+
+	// Validate events
+	if(Encoding == ENCODING_COMPRESSED) {
+		if(!DecodeObjectData()) {
+			Log.Write("Invalid compressed replay data: %s", ReplayFile.c_str());
+			Reader.Close();
+			return false;
+		}
+	}
+	else {
+		if(!Reader.SetEventData(ObjectDataStart, ObjectDataSize))
+			Log.Write("Replay data is truncated: %s", ReplayFile.c_str());
+		LoadIndex();
+	}
+
+	EventIterator = Reader.begin();
 
 	return true;
 }
@@ -273,23 +435,63 @@ bool _Replay::LoadReplay(const std::string &ReplayFile, bool HeaderOnly) {
 void _Replay::StopReplay() {
 
 	State = STATE_NONE;
-	File.close();
+	Reader.Close();
+	EventIterator = _ReplayEventIterator();
 }
 
 // Returns true if the replay is done playing
 bool _Replay::ReplayStopped() {
 
-	return File.eof();
+	return EndOfData;
+}
+
+// Find the last keyframe at or before a time
+const _ReplayKeyframe *_Replay::FindKeyframe(float Time) {
+	auto Iterator = std::upper_bound(Keyframes.begin(), Keyframes.end(), Time, [](float Value, const _ReplayKeyframe &Keyframe) {
+		return Value < Keyframe.Timestamp;
+	});
+	if(Iterator == Keyframes.begin())
+		return nullptr;
+
+	return &(*--Iterator);
+}
+
+// Move to a keyframe event
+void _Replay::SeekToKeyframe(const _ReplayKeyframe &Keyframe) {
+	EventIterator = Reader.GetIterator(Keyframe.Offset);
+	EndOfData = false;
+}
+
+// Move to the first event
+void _Replay::SeekToStart() {
+	EventIterator = Reader.begin();
+	EndOfData = false;
 }
 
 // Write replay event
 void _Replay::WriteEvent(uint8_t Type) {
-	File.put(Type);
-	File.write((char *)&Time, sizeof(Time));
+	Writer.Put((char)Type);
+	Writer.Write((char *)&Time, sizeof(Time));
 }
 
-// Reads a packet header
-void _Replay::ReadEvent(_ReplayEvent &Packet) {
-	Packet.Type = File.get();
-	File.read((char *)&Packet.Timestamp, sizeof(Packet.Timestamp));
+// Write keyframe event and add it to the index
+void _Replay::WriteKeyframeEvent() {
+	_ReplayKeyframe Keyframe;
+	Keyframe.Timestamp = Time;
+	Keyframe.Offset = Writer.GetSize();
+	Keyframes.push_back(Keyframe);
+	NextKeyframeTime += REPLAY_KEYFRAME_INTERVAL;
+
+	WriteEvent(PACKET_KEYFRAME);
+}
+
+// Get the next event
+void _Replay::ReadEvent(_ReplayEventView &Event) {
+	if(EventIterator == Reader.end()) {
+		EndOfData = true;
+		return;
+	}
+
+	Event = *EventIterator;
+	++EventIterator;
 }
@@ -18,15 +18,22 @@
 #pragma once
 
 // Libraries
+#include <replayreader.h>
+#include <replaywriter.h>
 #include <fstream>
+#include <string>
+#include <vector>
 
 // Constants
-const int REPLAY_VERSION = 4;
+const int REPLAY_VERSION = 7;
+const int REPLAY_MIN_VERSION = 4;
+const int REPLAY_TIMER_ORDER_VERSION = 7;
+const float REPLAY_KEYFRAME_INTERVAL = 1.0f;
 
-// Event packet structure
-struct _ReplayEvent {
-	uint8_t Type;
+// Index entry for a keyframe
+struct _ReplayKeyframe {
 	float Timestamp;
+	uint32_t Offset;
 };
 
 // Classes
@@ -47,6 +54,8 @@ class _Replay {
 			PACKET_AUTOSAVE,
 			PACKET_WON,
 			PACKET_PLATFORM,
+			PACKET_INDEX,
+			PACKET_ENCODING,
 
 			// Object updates
 			PACKET_OBJECTDATA = 127,
@@ -57,6 +66,12 @@ class _Replay {
 			PACKET_ORBDEACTIVATE,
 			PACKET_INPUT,
 			PACKET_PLAYERSPEED,
+			PACKET_KEYFRAME,
+		};
+
+		enum EncodingType {
+			ENCODING_RAW,
+			ENCODING_COMPRESSED,
 		};
 
 		enum StateType {
@@ -65,26 +80,34 @@ class _Replay {
 			STATE_REPLAYING,
 		};
 
+		_Replay();
+
 		// Recording functions
 		void StartRecording();
 		void StopRecording();
 		bool SaveReplay(const std::string &PlayerDescription, bool Autosave=false, bool Won=false);
+		bool ConvertReplay(const std::string &InputFile, const std::string &OutputFile);
 
 		// Playback functions
 		bool LoadReplay(const std::string &ReplayFile, bool HeaderOnly=false);
 		void StartReplay() { State = STATE_REPLAYING; }
 		void StopReplay();
 		bool ReplayStopped();
+		const _ReplayKeyframe *FindKeyframe(float Time);
+		void SeekToKeyframe(const _ReplayKeyframe &Keyframe);
+		void SeekToStart();
 
 		void Update(float FrameTime);
 
 		bool IsRecording() const { return State == STATE_RECORDING; }
 		bool IsReplaying() const { return State == STATE_REPLAYING; }
 		bool NeedsPacket();
+		bool NeedsKeyframe();
 
-		std::fstream &GetFile() { return File; }
+		_ReplayWriter &GetWriter() { return Writer; }
 		void WriteEvent(uint8_t Type);
-		void ReadEvent(_ReplayEvent &Packet);
+		void WriteKeyframeEvent();
+		void ReadEvent(_ReplayEventView &Event);
 
 		const std::string &GetLevelName() { return LevelName; }
 		const std::string &GetDescription() { return Description; }
@@ -96,11 +119,17 @@ class _Replay {
 		char GetPlatform() { return Platform; }
 		bool GetAutosave() { return Autosave; }
 		bool GetWon() { return Won; }
+		bool IsCompressed() { return Encoding == ENCODING_COMPRESSED; }
+		const std::vector<_ReplayKeyframe> &GetKeyframes() { return Keyframes; }
 
 	private:
 
-		void LoadHeader();
+		bool LoadHeader();
+		void LoadIndex();
+		bool DecodeObjectData();
+		void WriteHeader(std::fstream &OutFile, uint32_t DataSize);
 		void WriteChunk(std::fstream &OutFile, char Type, const char *Data, uint32_t Size);
+		template<typename T> bool ReadChunk(const char *Data, uint32_t Size, T &Value);
 
 		// Header
 		int32_t ReplayVersion;
@@ -113,12 +142,22 @@ class _Replay {
 		char Platform;
 		bool Autosave;
 		bool Won;
+		uint8_t Encoding;
 
-		// Replay data file name
+		// Recording buffer and the file it is spooled to
 		std::string ReplayDataFile;
-
-		// File stream
-		std::fstream File;
+		_ReplayWriter Writer;
+
+		// Mapped replay file, or decoded data for compressed replays
+		_ReplayReader Reader;
+		_ReplayEventIterator EventIterator;
+		size_t ObjectDataStart;
+		uint32_t ObjectDataSize;
+		bool EndOfData;
+
+		// Keyframe index
+		std::vector<_ReplayKeyframe> Keyframes;
+		float NextKeyframeTime;
 
 		// Time management
 		float Time;
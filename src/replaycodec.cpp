@@ -0,0 +1,506 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <replaycodec.h>
+#include <replayreader.h>
+#include <quaternion.h>
+#include <zlib.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+using namespace irr;
+
+// Deflate can't expand data by more than about 1032:1, so larger raw sizes are corrupt
+const uint32_t REPLAY_MAX_COMPRESSION_RATIO = 1032;
+
+// Longest gap between events that is stored as a step count instead of a timestamp
+const uint32_t REPLAY_MAX_STEP_CODE = 128;
+
+// Smallest encoded object update: id, largest component and six single byte deltas
+const uint32_t REPLAY_MIN_OBJECT_SIZE = 8;
+
+// Last quantized orientation of an object, used as the base for deltas
+struct _QuantizedState {
+	_QuantizedState() : Position{0, 0, 0}, Rotation{0, 0, 0} { }
+
+	int32_t Position[3];
+	int32_t Rotation[3];
+};
+
+// Object state tracked while inserting keyframes
+struct _KeyframeObject {
+	int16_t TemplateID;
+	uint8_t PositionType;
+	float Position[4];
+	float Rotation[3];
+	bool Deactivating;
+	float DeactivateTime;
+	float DeactivateLength;
+};
+
+// Append a value to a buffer
+template<typename T> static void Append(std::string &Output, const T &Value) {
+	Output.append((const char *)&Value, sizeof(Value));
+}
+
+// Read a value from a buffer
+template<typename T> static bool Read(const char *&Data, const char *End, T &Value) {
+	if(End - Data < (std::ptrdiff_t)sizeof(Value))
+		return false;
+
+	memcpy(&Value, Data, sizeof(Value));
+	Data += sizeof(Value);
+
+	return true;
+}
+
+// Write a variable length integer
+static void WriteVarint(std::string &Output, uint32_t Value) {
+	while(Value >= 0x80) {
+		Output.push_back((char)(Value | 0x80));
+		Value >>= 7;
+	}
+	Output.push_back((char)Value);
+}
+
+// Read a variable length integer
+static bool ReadVarint(const char *&Data, const char *End, uint32_t &Value) {
+	Value = 0;
+	for(int Shift = 0; Shift < 35; Shift += 7) {
+		if(Data >= End)
+			return false;
+
+		uint8_t Byte = (uint8_t)*Data++;
+		Value |= (uint32_t)(Byte & 0x7f) << Shift;
+		if(!(Byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+// Map signed values to unsigned so small magnitudes stay small
+static uint32_t ZigZag(int32_t Value) {
+	return ((uint32_t)Value << 1) ^ (uint32_t)(Value >> 31);
+}
+
+static int32_t UnZigZag(uint32_t Value) {
+	return (int32_t)(Value >> 1) ^ -(int32_t)(Value & 1);
+}
+
+// Convert euler angles in degrees to the three smallest quaternion components
+static uint8_t PackRotation(const float *Rotation, int32_t *Packed) {
+	core::quaternion Quaternion(core::vector3df(Rotation[0], Rotation[1], Rotation[2]) * core::DEGTORAD);
+	float Components[4] = { Quaternion.X, Quaternion.Y, Quaternion.Z, Quaternion.W };
+
+	// Find largest component
+	uint8_t Largest = 0;
+	for(uint8_t i = 1; i < 4; i++) {
+		if(std::fabs(Components[i]) > std::fabs(Components[Largest]))
+			Largest = i;
+	}
+
+	// Flip so the dropped component is positive
+	float Sign = Components[Largest] < 0.0f ? -1.0f : 1.0f;
+	for(int i = 0, j = 0; i < 4; i++) {
+		if(i != Largest)
+			Packed[j++] = (int32_t)std::lround(Components[i] * Sign / REPLAY_ROTATION_QUANTUM);
+	}
+
+	return Largest;
+}
+
+// Convert packed quaternion back to euler angles in degrees
+static void UnpackRotation(uint8_t Largest, const int32_t *Packed, float *Rotation) {
+	float Components[4];
+	float Sum = 0.0f;
+	for(int i = 0, j = 0; i < 4; i++) {
+		if(i != Largest) {
+			Components[i] = Packed[j++] * REPLAY_ROTATION_QUANTUM;
+			Sum += Components[i] * Components[i];
+		}
+	}
+	Components[Largest] = std::sqrt(std::max(0.0f, 1.0f - Sum));
+
+	core::vector3df Euler;
+	core::quaternion(Components[0], Components[1], Components[2], Components[3]).toEuler(Euler);
+	Euler *= core::RADTODEG;
+	Rotation[0] = Euler.X;
+	Rotation[1] = Euler.Y;
+	Rotation[2] = Euler.Z;
+}
+
+// Compress raw event data, a new block is started at every keyframe
+bool _ReplayCodec::Encode(const char *Data, size_t Size, float TimeStep, std::string &Output) {
+	std::unordered_map<uint16_t, _QuantizedState> States;
+	std::string Block;
+	float LastTimestamp = 0.0f;
+	bool HasTimestamp = false;
+
+	Output.clear();
+	const char *End = Data + Size;
+	while(Data < End) {
+
+		// Read event header
+		uint8_t Type;
+		float Timestamp;
+		size_t PayloadSize;
+		if(!Read(Data, End, Type) || !Read(Data, End, Timestamp) || !_ReplayReader::GetPayloadSize(Type, Data, End - Data, PayloadSize))
+			return false;
+
+		// Blocks don't depend on previous ones
+		if(Type == _Replay::PACKET_KEYFRAME && Block.size()) {
+			if(!FlushBlock(Block, Output))
+				return false;
+
+			States.clear();
+			HasTimestamp = false;
+		}
+
+		// Store timestamp as a step count from the last event when it can be reproduced exactly
+		uint32_t StepCode = 0;
+		if(HasTimestamp) {
+			float Time = LastTimestamp;
+			for(uint32_t i = 0; i < REPLAY_MAX_STEP_CODE && Time <= Timestamp; i++) {
+				if(Time == Timestamp) {
+					StepCode = i + 1;
+					break;
+				}
+				Time += TimeStep;
+			}
+		}
+
+		Block.push_back((char)Type);
+		WriteVarint(Block, StepCode);
+		if(!StepCode)
+			Append(Block, Timestamp);
+
+		LastTimestamp = Timestamp;
+		HasTimestamp = true;
+
+		// Write payload
+		if(Type == _Replay::PACKET_MOVEMENT) {
+			const char *Payload = Data;
+			int16_t ObjectCount = 0;
+			Read(Payload, End, ObjectCount);
+			WriteVarint(Block, (uint32_t)std::max(0, (int)ObjectCount));
+
+			int32_t LastID = 0;
+			for(int i = 0; i < ObjectCount; i++) {
+				uint16_t ObjectID = 0;
+				float Position[3], Rotation[3];
+				Read(Payload, End, ObjectID);
+				Read(Payload, End, Position);
+				Read(Payload, End, Rotation);
+
+				// Write id relative to previous object in packet
+				WriteVarint(Block, ZigZag((int32_t)ObjectID - LastID));
+				LastID = ObjectID;
+
+				// Quantize
+				int32_t QuantizedPosition[3], QuantizedRotation[3];
+				for(int j = 0; j < 3; j++)
+					QuantizedPosition[j] = (int32_t)std::lround(Position[j] / REPLAY_POSITION_QUANTUM);
+				uint8_t Largest = PackRotation(Rotation, QuantizedRotation);
+
+				// Write deltas from the last state
+				_QuantizedState &State = States[ObjectID];
+				Block.push_back((char)Largest);
+				for(int j = 0; j < 3; j++) {
+					WriteVarint(Block, ZigZag(QuantizedPosition[j] - State.Position[j]));
+					State.Position[j] = QuantizedPosition[j];
+				}
+				for(int j = 0; j < 3; j++) {
+					WriteVarint(Block, ZigZag(QuantizedRotation[j] - State.Rotation[j]));
+					State.Rotation[j] = QuantizedRotation[j];
+				}
+			}
+		}
+		else
+			Block.append(Data, PayloadSize);
+
+		Data += PayloadSize;
+	}
+
+	return FlushBlock(Block, Output);
+}
+
+// Decompress event data back to the raw format and rebuild the keyframe index
+bool _ReplayCodec::Decode(const char *Data, size_t Size, float TimeStep, std::string &Output, std::vector<_ReplayKeyframe> &Keyframes) {
+	Output.clear();
+	Keyframes.clear();
+
+	std::string Block;
+	const char *End = Data + Size;
+	while(Data < End) {
+
+		// Uncompress block
+		uint32_t RawSize, CompressedSize;
+		if(!Read(Data, End, RawSize) || !Read(Data, End, CompressedSize) || CompressedSize > (size_t)(End - Data))
+			return false;
+
+		// Reject sizes that deflate can't produce before allocating
+		if((uint64_t)RawSize > (uint64_t)CompressedSize * REPLAY_MAX_COMPRESSION_RATIO)
+			return false;
+
+		Block.resize(RawSize);
+		uLongf Length = RawSize;
+		if(uncompress((Bytef *)&Block[0], &Length, (const Bytef *)Data, CompressedSize) != Z_OK || Length != RawSize)
+			return false;
+		Data += CompressedSize;
+
+		// Decode events
+		std::unordered_map<uint16_t, _QuantizedState> States;
+		float Timestamp = 0.0f;
+		bool HasTimestamp = false;
+		const char *BlockData = Block.data();
+		const char *BlockEnd = BlockData + Block.size();
+		while(BlockData < BlockEnd) {
+
+			// Get timestamp
+			uint8_t Type;
+			uint32_t StepCode;
+			if(!Read(BlockData, BlockEnd, Type) || !ReadVarint(BlockData, BlockEnd, StepCode))
+				return false;
+
+			if(StepCode) {
+				if(!HasTimestamp || StepCode > REPLAY_MAX_STEP_CODE)
+					return false;
+				for(uint32_t i = 1; i < StepCode; i++)
+					Timestamp += TimeStep;
+			}
+			else if(!Read(BlockData, BlockEnd, Timestamp))
+				return false;
+			HasTimestamp = true;
+
+			// Add keyframes to index
+			if(Type == _Replay::PACKET_KEYFRAME) {
+				_ReplayKeyframe Keyframe;
+				Keyframe.Timestamp = Timestamp;
+				Keyframe.Offset = (uint32_t)Output.size();
+				Keyframes.push_back(Keyframe);
+			}
+
+			Output.push_back((char)Type);
+			Append(Output, Timestamp);
+
+			// Get payload
+			if(Type == _Replay::PACKET_MOVEMENT) {
+				uint32_t ObjectCount;
+				if(!ReadVarint(BlockData, BlockEnd, ObjectCount))
+					return false;
+
+				// Count must fit the raw format and the remaining block data
+				if(ObjectCount > INT16_MAX || ObjectCount > (size_t)(BlockEnd - BlockData) / REPLAY_MIN_OBJECT_SIZE)
+					return false;
+				Append(Output, (int16_t)ObjectCount);
+
+				int32_t LastID = 0;
+				for(uint32_t i = 0; i < ObjectCount; i++) {
+					uint32_t Value;
+					uint8_t Largest;
+					if(!ReadVarint(BlockData, BlockEnd, Value) || !Read(BlockData, BlockEnd, Largest) || Largest > 3)
+						return false;
+
+					uint16_t ObjectID = (uint16_t)(LastID + UnZigZag(Value));
+					LastID = ObjectID;
+
+					// Apply deltas
+					_QuantizedState &State = States[ObjectID];
+					for(int j = 0; j < 3; j++) {
+						if(!ReadVarint(BlockData, BlockEnd, Value))
+							return false;
+						State.Position[j] += UnZigZag(Value);
+					}
+					for(int j = 0; j < 3; j++) {
+						if(!ReadVarint(BlockData, BlockEnd, Value))
+							return false;
+						State.Rotation[j] += UnZigZag(Value);
+					}
+
+					// Write raw object update
+					float Position[3], Rotation[3];
+					for(int j = 0; j < 3; j++)
+						Position[j] = State.Position[j] * REPLAY_POSITION_QUANTUM;
+					UnpackRotation(Largest, State.Rotation, Rotation);
+
+					Append(Output, ObjectID);
+					Append(Output, Position);
+					Append(Output, Rotation);
+				}
+			}
+			else {
+				size_t PayloadSize;
+				if(!_ReplayReader::GetPayloadSize(Type, BlockData, BlockEnd - BlockData, PayloadSize))
+					return false;
+
+				Output.append(BlockData, PayloadSize);
+				BlockData += PayloadSize;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Add keyframes to raw event data from older versions by tracking object state
+bool _ReplayCodec::InsertKeyframes(const char *Data, size_t Size, std::string &Output, std::vector<_ReplayKeyframe> &Keyframes) {
+	std::map<uint16_t, _KeyframeObject> Objects;
+	float LastTimestamp = 0.0f;
+	float NextKeyframeTime = 0.0f;
+	bool HasTimestamp = false;
+
+	Output.clear();
+	Keyframes.clear();
+	const char *End = Data + Size;
+	while(Data < End) {
+
+		// Read event header
+		const char *Event = Data;
+		uint8_t Type;
+		float Timestamp;
+		size_t PayloadSize;
+		if(!Read(Data, End, Type) || !Read(Data, End, Timestamp) || !_ReplayReader::GetPayloadSize(Type, Data, End - Data, PayloadSize))
+			return false;
+
+		// Write keyframe after all events of a step
+		if(HasTimestamp && Timestamp != LastTimestamp && LastTimestamp >= NextKeyframeTime) {
+			uint32_t KeyframeSize = sizeof(int16_t) * 2;
+			int16_t OrbCount = 0;
+			for(const auto &Iterator : Objects) {
+				KeyframeSize += sizeof(int16_t) + sizeof(uint16_t) + 1 + sizeof(float) * (Iterator.second.PositionType == 1 ? 4 : 3) + sizeof(float) * 3;
+				if(Iterator.second.Deactivating) {
+					OrbCount++;
+					KeyframeSize += sizeof(uint16_t) + 1 + sizeof(float) * 2;
+				}
+			}
+
+			_ReplayKeyframe Keyframe;
+			Keyframe.Timestamp = LastTimestamp;
+			Keyframe.Offset = (uint32_t)Output.size();
+			Keyframes.push_back(Keyframe);
+			NextKeyframeTime += REPLAY_KEYFRAME_INTERVAL;
+
+			Output.push_back((char)_Replay::PACKET_KEYFRAME);
+			Append(Output, LastTimestamp);
+			Append(Output, KeyframeSize);
+			Append(Output, (int16_t)Objects.size());
+			for(const auto &Iterator : Objects) {
+				const _KeyframeObject &Object = Iterator.second;
+				Append(Output, Object.TemplateID);
+				Append(Output, Iterator.first);
+				Output.push_back((char)Object.PositionType);
+				Output.append((const char *)Object.Position, sizeof(float) * (Object.PositionType == 1 ? 4 : 3));
+				Output.append((const char *)Object.Rotation, sizeof(float) * 3);
+			}
+
+			Append(Output, OrbCount);
+			for(const auto &Iterator : Objects) {
+				const _KeyframeObject &Object = Iterator.second;
+				if(!Object.Deactivating)
+					continue;
+
+				float OrbTime = LastTimestamp - Object.DeactivateTime;
+				uint8_t State = OrbTime >= Object.DeactivateLength ? 2 : 1;
+				Append(Output, Iterator.first);
+				Append(Output, State);
+				Append(Output, OrbTime);
+				Append(Output, Object.DeactivateLength);
+			}
+		}
+
+		LastTimestamp = Timestamp;
+		HasTimestamp = true;
+
+		// Track object state
+		const char *Payload = Data;
+		switch(Type) {
+			case _Replay::PACKET_CREATE: {
+				_KeyframeObject Object = {};
+				uint16_t ObjectID = 0;
+				Read(Payload, End, Object.TemplateID);
+				Read(Payload, End, ObjectID);
+				Read(Payload, End, Object.PositionType);
+				memcpy(Object.Position, Payload, sizeof(float) * (Object.PositionType == 1 ? 4 : 3));
+				Payload += sizeof(float) * (Object.PositionType == 1 ? 4 : 3);
+				memcpy(Object.Rotation, Payload, sizeof(float) * 3);
+				Object.Deactivating = false;
+				Object.DeactivateTime = 0.0f;
+				Object.DeactivateLength = 0.0f;
+				Objects[ObjectID] = Object;
+			} break;
+			case _Replay::PACKET_DELETE: {
+				uint16_t ObjectID = 0;
+				Read(Payload, End, ObjectID);
+				Objects.erase(ObjectID);
+			} break;
+			case _Replay::PACKET_MOVEMENT: {
+				int16_t ObjectCount = 0;
+				Read(Payload, End, ObjectCount);
+				for(int i = 0; i < ObjectCount; i++) {
+					uint16_t ObjectID = 0;
+					Read(Payload, End, ObjectID);
+					auto Iterator = Objects.find(ObjectID);
+					if(Iterator != Objects.end() && Iterator->second.PositionType != 1) {
+						memcpy(Iterator->second.Position, Payload, sizeof(float) * 3);
+						memcpy(Iterator->second.Rotation, Payload + sizeof(float) * 3, sizeof(float) * 3);
+					}
+					Payload += sizeof(float) * 6;
+				}
+			} break;
+			case _Replay::PACKET_ORBDEACTIVATE: {
+				uint16_t ObjectID = 0;
+				float Length = 0.0f;
+				Read(Payload, End, ObjectID);
+				Read(Payload, End, Length);
+				auto Iterator = Objects.find(ObjectID);
+				if(Iterator != Objects.end() && !Iterator->second.Deactivating) {
+					Iterator->second.Deactivating = true;
+					Iterator->second.DeactivateTime = Timestamp;
+					Iterator->second.DeactivateLength = Length;
+				}
+			} break;
+		}
+
+		// Copy event
+		Output.append(Event, (Data - Event) + PayloadSize);
+		Data += PayloadSize;
+	}
+
+	return true;
+}
+
+// Compress a block and add it to the output
+bool _ReplayCodec::FlushBlock(std::string &Block, std::string &Output) {
+	if(Block.empty())
+		return true;
+
+	uLongf CompressedSize = compressBound(Block.size());
+	std::string Compressed(CompressedSize, 0);
+	if(compress2((Bytef *)&Compressed[0], &CompressedSize, (const Bytef *)Block.data(), Block.size(), Z_BEST_COMPRESSION) != Z_OK)
+		return false;
+
+	Append(Output, (uint32_t)Block.size());
+	Append(Output, (uint32_t)CompressedSize);
+	Output.append(Compressed.data(), CompressedSize);
+	Block.clear();
+
+	return true;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <replay.h>
+#include <string>
+#include <vector>
+
+// Constants
+
+// Positions are stored in 1/4096 units, so decoded positions are within 1/8192 of the original
+const float REPLAY_POSITION_QUANTUM = 1.0f / 4096.0f;
+
+// Quaternion components are stored in 1/32767 steps of 1/sqrt(2), an error of at most 1.1e-5 per component.
+// Decoded euler angles describe the same orientation to within 0.1 degrees.
+const float REPLAY_ROTATION_QUANTUM = 0.70710678f / 32767.0f;
+
+// Converts between raw replay event data and the compressed encoding
+class _ReplayCodec {
+
+	public:
+
+		bool Encode(const char *Data, size_t Size, float TimeStep, std::string &Output);
+		bool Decode(const char *Data, size_t Size, float TimeStep, std::string &Output, std::vector<_ReplayKeyframe> &Keyframes);
+		bool InsertKeyframes(const char *Data, size_t Size, std::string &Output, std::vector<_ReplayKeyframe> &Keyframes);
+
+	private:
+
+		bool FlushBlock(std::string &Block, std::string &Output);
+
+};
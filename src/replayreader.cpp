@@ -0,0 +1,244 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <replayreader.h>
+#include <replay.h>
+#include <algorithm>
+
+// Size of the type and timestamp that start every event
+static const size_t REPLAY_EVENT_HEADER_SIZE = sizeof(uint8_t) + sizeof(float);
+
+// Read camera event
+void _ReplayEventView::GetCamera(_ReplayCameraEvent &Event) const {
+	Read(0, Event.Position);
+	Read(sizeof(float) * 3, Event.Target);
+}
+
+// Read create event
+void _ReplayEventView::GetCreate(_ReplayCreateEvent &Event) const {
+	Read(0, Event.TemplateID);
+	Read(2, Event.ObjectID);
+	Read(4, Event.PositionType);
+	size_t Offset = 5;
+	if(Event.PositionType == 1) {
+		Read(Offset, Event.Plane);
+		Offset += sizeof(Event.Plane);
+	}
+	else {
+		Read(Offset, Event.Position);
+		Offset += sizeof(Event.Position);
+	}
+	Read(Offset, Event.Rotation);
+}
+
+// Read delete event
+uint16_t _ReplayEventView::GetDelete() const {
+	uint16_t ObjectID;
+	Read(0, ObjectID);
+
+	return ObjectID;
+}
+
+// Read orb deactivate event
+void _ReplayEventView::GetOrbDeactivate(_ReplayOrbDeactivateEvent &Event) const {
+	Read(0, Event.ObjectID);
+	Read(2, Event.Length);
+}
+
+// Read input event
+void _ReplayEventView::GetInput(_ReplayInputEvent &Event) const {
+	Read(0, Event.PushX);
+	Read(4, Event.PushZ);
+	Read(8, Event.Yaw);
+	Read(12, Event.Pitch);
+	Read(16, Event.Jumped);
+}
+
+// Read player speed event
+float _ReplayEventView::GetPlayerSpeed() const {
+	float Speed;
+	Read(0, Speed);
+
+	return Speed;
+}
+
+// Get number of objects in a movement event
+int _ReplayEventView::GetMovementCount() const {
+	int16_t ObjectCount;
+	Read(0, ObjectCount);
+
+	return std::max(0, (int)ObjectCount);
+}
+
+// Read one object from a movement event
+void _ReplayEventView::GetMovementObject(int Index, _ReplayMovementObject &Object) const {
+	size_t Offset = sizeof(int16_t) + Index * (sizeof(uint16_t) + sizeof(float) * 6);
+	Read(Offset, Object.ObjectID);
+	Read(Offset + 2, Object.Position);
+	Read(Offset + 2 + sizeof(float) * 3, Object.Rotation);
+}
+
+// Get view of current event
+_ReplayEventView _ReplayEventIterator::operator*() const {
+	_ReplayEventView Event;
+	size_t PayloadSize = 0;
+	Event.Type = (uint8_t)Position[0];
+	memcpy(&Event.Timestamp, Position + 1, sizeof(Event.Timestamp));
+	Event.Payload = Position + REPLAY_EVENT_HEADER_SIZE;
+	_ReplayReader::GetPayloadSize(Event.Type, Event.Payload, SIZE_MAX, PayloadSize);
+	Event.PayloadSize = (uint32_t)PayloadSize;
+
+	return Event;
+}
+
+// Move to next event, events are validated when the data is set
+_ReplayEventIterator &_ReplayEventIterator::operator++() {
+	size_t PayloadSize = 0;
+	_ReplayReader::GetPayloadSize((uint8_t)Position[0], Position + REPLAY_EVENT_HEADER_SIZE, SIZE_MAX, PayloadSize);
+	Position += REPLAY_EVENT_HEADER_SIZE + PayloadSize;
+
+	return *this;
+}
+
+// Constructor
+_ReplayReader::_ReplayReader() :
+	Data(nullptr),
+	Size(0),
+	EventStart(nullptr),
+	EventEnd(nullptr) {
+
+}
+
+// Destructor
+_ReplayReader::~_ReplayReader() {
+	Close();
+}
+
+// Map a file into memory
+bool _ReplayReader::Open(const std::string &Path) {
+	Close();
+
+	if(!MappedFile.Open(Path))
+		return false;
+
+	Data = MappedFile.GetData();
+	Size = MappedFile.GetSize();
+
+	return true;
+}
+
+// Release mapped or decoded data
+void _ReplayReader::Close() {
+	MappedFile.Close();
+
+	DecodedData.clear();
+	DecodedData.shrink_to_fit();
+	KeyframeOffsets.clear();
+	Data = nullptr;
+	Size = 0;
+	EventStart = nullptr;
+	EventEnd = nullptr;
+}
+
+// Validate events in a range of the data, any trailing partial event is dropped
+bool _ReplayReader::SetEventData(size_t Offset, size_t EventSize) {
+	KeyframeOffsets.clear();
+	if(Offset > Size)
+		return false;
+
+	EventStart = Data + Offset;
+	const char *End = EventStart + std::min(EventSize, Size - Offset);
+	const char *Position = EventStart;
+	while((size_t)(End - Position) >= REPLAY_EVENT_HEADER_SIZE) {
+		uint8_t Type = (uint8_t)Position[0];
+		size_t PayloadSize;
+		if(!GetPayloadSize(Type, Position + REPLAY_EVENT_HEADER_SIZE, End - Position - REPLAY_EVENT_HEADER_SIZE, PayloadSize))
+			break;
+
+		if(Type == _Replay::PACKET_KEYFRAME)
+			KeyframeOffsets.push_back((uint32_t)(Position - EventStart));
+
+		Position += REPLAY_EVENT_HEADER_SIZE + PayloadSize;
+	}
+	EventEnd = Position;
+
+	return EventEnd == End;
+}
+
+// Replace mapped data with decoded event data
+void _ReplayReader::SetDecodedEventData(std::string &NewData) {
+	MappedFile.Close();
+
+	DecodedData.swap(NewData);
+	Data = DecodedData.data();
+	Size = DecodedData.size();
+	SetEventData(0, Size);
+}
+
+// Determine if an offset points to a keyframe event
+bool _ReplayReader::IsKeyframeOffset(uint32_t Offset) const {
+
+	return std::binary_search(KeyframeOffsets.begin(), KeyframeOffsets.end(), Offset);
+}
+
+// Get the size of an event payload, returns false if it doesn't fit
+bool _ReplayReader::GetPayloadSize(uint8_t Type, const char *Data, size_t Remaining, size_t &Size) {
+	switch(Type) {
+		case _Replay::PACKET_CAMERA:
+			Size = sizeof(float) * 6;
+		break;
+		case _Replay::PACKET_MOVEMENT: {
+			int16_t ObjectCount = 0;
+			if(Remaining < sizeof(ObjectCount))
+				return false;
+
+			memcpy(&ObjectCount, Data, sizeof(ObjectCount));
+			Size = sizeof(ObjectCount) + std::max(0, (int)ObjectCount) * (sizeof(uint16_t) + sizeof(float) * 6);
+		} break;
+		case _Replay::PACKET_CREATE: {
+			if(Remaining < 5)
+				return false;
+
+			int PositionType = Data[4];
+			Size = sizeof(int16_t) * 2 + 1 + sizeof(float) * (PositionType == 1 ? 4 : 3) + sizeof(float) * 3;
+		} break;
+		case _Replay::PACKET_DELETE:
+			Size = sizeof(uint16_t);
+		break;
+		case _Replay::PACKET_ORBDEACTIVATE:
+			Size = sizeof(uint16_t) + sizeof(float);
+		break;
+		case _Replay::PACKET_INPUT:
+			Size = sizeof(float) * 4 + sizeof(bool);
+		break;
+		case _Replay::PACKET_PLAYERSPEED:
+			Size = sizeof(float);
+		break;
+		case _Replay::PACKET_KEYFRAME: {
+			uint32_t KeyframeSize;
+			if(Remaining < sizeof(KeyframeSize))
+				return false;
+
+			memcpy(&KeyframeSize, Data, sizeof(KeyframeSize));
+			Size = sizeof(KeyframeSize) + (size_t)KeyframeSize;
+		} break;
+		default:
+			return false;
+	}
+
+	return Size <= Remaining;
+}
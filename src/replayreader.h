@@ -0,0 +1,141 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <mappedfile.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Decoded event payloads
+struct _ReplayCameraEvent {
+	float Position[3];
+	float Target[3];
+};
+
+struct _ReplayCreateEvent {
+	int16_t TemplateID;
+	uint16_t ObjectID;
+	uint8_t PositionType;
+	float Plane[4];
+	float Position[3];
+	float Rotation[3];
+};
+
+struct _ReplayOrbDeactivateEvent {
+	uint16_t ObjectID;
+	float Length;
+};
+
+struct _ReplayInputEvent {
+	float PushX;
+	float PushZ;
+	float Yaw;
+	float Pitch;
+	bool Jumped;
+};
+
+struct _ReplayMovementObject {
+	uint16_t ObjectID;
+	float Position[3];
+	float Rotation[3];
+};
+
+// View of a single event inside replay data, payloads are read in place
+struct _ReplayEventView {
+	_ReplayEventView() : Type(0), Timestamp(0.0f), Payload(nullptr), PayloadSize(0) { }
+
+	// Read a value at a payload offset
+	template<typename T> void Read(size_t Offset, T &Value) const { memcpy(&Value, Payload + Offset, sizeof(Value)); }
+
+	void GetCamera(_ReplayCameraEvent &Event) const;
+	void GetCreate(_ReplayCreateEvent &Event) const;
+	uint16_t GetDelete() const;
+	void GetOrbDeactivate(_ReplayOrbDeactivateEvent &Event) const;
+	void GetInput(_ReplayInputEvent &Event) const;
+	float GetPlayerSpeed() const;
+	int GetMovementCount() const;
+	void GetMovementObject(int Index, _ReplayMovementObject &Object) const;
+
+	uint8_t Type;
+	float Timestamp;
+	const char *Payload;
+	uint32_t PayloadSize;
+};
+
+// Forward iterator over validated events
+class _ReplayEventIterator {
+
+	public:
+
+		_ReplayEventIterator(const char *Position=nullptr) : Position(Position) { }
+
+		_ReplayEventView operator*() const;
+		_ReplayEventIterator &operator++();
+		bool operator==(const _ReplayEventIterator &Other) const { return Position == Other.Position; }
+		bool operator!=(const _ReplayEventIterator &Other) const { return Position != Other.Position; }
+
+	private:
+
+		const char *Position;
+
+};
+
+// Maps a replay file into memory and validates its event data
+class _ReplayReader {
+
+	public:
+
+		_ReplayReader();
+		~_ReplayReader();
+
+		bool Open(const std::string &Path);
+		void Close();
+		bool IsOpen() const { return Data != nullptr; }
+
+		bool SetEventData(size_t Offset, size_t EventSize);
+		void SetDecodedEventData(std::string &NewData);
+		bool IsKeyframeOffset(uint32_t Offset) const;
+
+		const char *GetData() const { return Data; }
+		size_t GetSize() const { return Size; }
+		const char *GetEventData() const { return EventStart; }
+		size_t GetEventSize() const { return EventEnd - EventStart; }
+
+		_ReplayEventIterator begin() const { return _ReplayEventIterator(EventStart); }
+		_ReplayEventIterator end() const { return _ReplayEventIterator(EventEnd); }
+		_ReplayEventIterator GetIterator(uint32_t Offset) const { return _ReplayEventIterator(EventStart + Offset); }
+
+		static bool GetPayloadSize(uint8_t Type, const char *Data, size_t Remaining, size_t &Size);
+
+	private:
+
+		// Mapped file or decoded data
+		const char *Data;
+		size_t Size;
+		_MappedFile MappedFile;
+		std::string DecodedData;
+
+		// Validated event range
+		const char *EventStart;
+		const char *EventEnd;
+		std::vector<uint32_t> KeyframeOffsets;
+
+};
@@ -0,0 +1,158 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <replaywriter.h>
+
+// Constructor
+_ReplayWriter::_ReplayWriter() :
+	Position(nullptr),
+	BlockEnd(nullptr),
+	CompletedSize(0),
+	SpoolFile(nullptr),
+	Spooling(false),
+	Stopping(false) {
+
+	AddBlock();
+}
+
+// Destructor
+_ReplayWriter::~_ReplayWriter() {
+	Close();
+}
+
+// Start a new buffer and spool it to a file
+bool _ReplayWriter::Open(const std::string &Path) {
+	Close();
+
+	SpoolFile = fopen(Path.c_str(), "wb");
+	if(!SpoolFile)
+		return false;
+
+	this->Path = Path;
+	Stopping = false;
+	SpoolThread = std::thread(&_ReplayWriter::SpoolBlocks, this);
+
+	return true;
+}
+
+// Stop the spool thread and release the buffer
+void _ReplayWriter::Close() {
+	if(SpoolFile) {
+
+		// Wait for completed blocks to be written
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Stopping = true;
+		}
+		Condition.notify_all();
+		SpoolThread.join();
+
+		// Write partial block
+		fwrite(CurrentBlock->Data, 1, Position - CurrentBlock->Data, SpoolFile);
+		fclose(SpoolFile);
+		SpoolFile = nullptr;
+	}
+
+	// Reset buffer
+	CompletedBlocks.clear();
+	FreeBlocks.clear();
+	CompletedSize = 0;
+	Path.clear();
+	CurrentBlock.reset();
+	AddBlock();
+}
+
+// Write everything buffered so far to the spool file so it can be read back
+bool _ReplayWriter::Flush() {
+	if(!SpoolFile)
+		return false;
+
+	// Hand over the partial block, later writes continue in a new one
+	if(Position != CurrentBlock->Data)
+		AddBlock();
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	Condition.wait(Lock, [this]() { return CompletedBlocks.empty() && !Spooling; });
+
+	return fflush(SpoolFile) == 0;
+}
+
+// Fill the current block and continue in new ones
+void _ReplayWriter::WriteSplit(const char *Data, size_t Size) {
+	while(Size) {
+		size_t Count = std::min(Size, (size_t)(BlockEnd - Position));
+		memcpy(Position, Data, Count);
+		Position += Count;
+		Data += Count;
+		Size -= Count;
+		if(Position == BlockEnd)
+			AddBlock();
+	}
+}
+
+// Hand the current block to the spool thread and start a new one
+void _ReplayWriter::AddBlock() {
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		if(CurrentBlock) {
+			CurrentBlock->Size = Position - CurrentBlock->Data;
+			CompletedSize += CurrentBlock->Size;
+
+			// Without a spool file the data has nowhere to go
+			if(SpoolFile)
+				CompletedBlocks.push_back(std::move(CurrentBlock));
+			else
+				FreeBlocks.push_back(std::move(CurrentBlock));
+		}
+
+		// Reuse a written block
+		if(!FreeBlocks.empty()) {
+			CurrentBlock = std::move(FreeBlocks.back());
+			FreeBlocks.pop_back();
+		}
+	}
+	Condition.notify_all();
+
+	if(!CurrentBlock)
+		CurrentBlock.reset(new _ReplayBlock());
+
+	CurrentBlock->Size = 0;
+	Position = CurrentBlock->Data;
+	BlockEnd = CurrentBlock->Data + REPLAY_WRITER_BLOCK_SIZE;
+}
+
+// Write completed blocks to the spool file and return them to the free list
+void _ReplayWriter::SpoolBlocks() {
+	std::unique_lock<std::mutex> Lock(Mutex);
+	while(true) {
+		Condition.wait(Lock, [this]() { return Stopping || !CompletedBlocks.empty(); });
+		if(CompletedBlocks.empty() && Stopping)
+			break;
+
+		// Write block outside the lock
+		std::unique_ptr<_ReplayBlock> Block = std::move(CompletedBlocks.front());
+		CompletedBlocks.pop_front();
+		Spooling = true;
+		Lock.unlock();
+		fwrite(Block->Data, 1, Block->Size, SpoolFile);
+		Lock.lock();
+		Spooling = false;
+
+		FreeBlocks.push_back(std::move(Block));
+		Condition.notify_all();
+	}
+}
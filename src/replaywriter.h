@@ -0,0 +1,93 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Constants
+const size_t REPLAY_WRITER_BLOCK_SIZE = 64 * 1024;
+
+// Fixed size block of event data
+struct _ReplayBlock {
+	_ReplayBlock() : Size(0) { }
+
+	size_t Size;
+	char Data[REPLAY_WRITER_BLOCK_SIZE];
+};
+
+// Append-only event buffer that is spooled to disk by a background thread, blocks are reused once written
+class _ReplayWriter {
+
+	public:
+
+		_ReplayWriter();
+		~_ReplayWriter();
+
+		bool Open(const std::string &Path);
+		void Close();
+		bool Flush();
+		bool IsOpen() const { return SpoolFile != nullptr; }
+		const std::string &GetPath() const { return Path; }
+
+		// Append data to the current block
+		void Write(const char *Data, size_t Size) {
+			if(Size <= (size_t)(BlockEnd - Position)) {
+				memcpy(Position, Data, Size);
+				Position += Size;
+			}
+			else
+				WriteSplit(Data, Size);
+		}
+		void Put(char Value) { Write(&Value, 1); }
+
+		uint32_t GetSize() const { return (uint32_t)(CompletedSize + (Position - CurrentBlock->Data)); }
+
+	private:
+
+		void WriteSplit(const char *Data, size_t Size);
+		void AddBlock();
+		void SpoolBlocks();
+
+		// Blocks
+		std::unique_ptr<_ReplayBlock> CurrentBlock;
+		std::deque<std::unique_ptr<_ReplayBlock>> CompletedBlocks;
+		std::vector<std::unique_ptr<_ReplayBlock>> FreeBlocks;
+		char *Position;
+		char *BlockEnd;
+		size_t CompletedSize;
+
+		// Spool thread
+		std::string Path;
+		FILE *SpoolFile;
+		std::thread SpoolThread;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+		bool Spooling;
+		bool Stopping;
+
+};
@@ -19,15 +19,18 @@
 #include <globals.h>
 #include <log.h>
 #include <database.h>
+#include <replay.h>
+#include <level.h>
+#include <physics.h>
+#include <IFileSystem.h>
+#include <sys/stat.h>
 
-const int STATS_VERSION = 0;
+const int STATS_VERSION = 1;
 const int STATS_MAXSCORES = 10;
 
 #ifdef _WIN32
 	#define WIN32_LEAN_AND_MEAN
 	#include <windows.h>
-#else
-	#include <sys/stat.h>
 #endif
 
 _Save Save;
@@ -92,12 +95,17 @@ int _Save::InitStatsDatabase() {
 	// Open stats database and get file version
 	if(Database->OpenDatabase(StatsFile.c_str())) {
 		int Result = Database->RunDataQuery("SELECT Version from DatabaseInfo");
-		if(Result)
+		if(Result && Database->FetchRow())
 			DatabaseVersion = Database->GetInt(0);
 		Database->CloseQuery();
 
 		// Upgrade old database versions
 		if(DatabaseVersion == 0) {
+			Log.Write("Upgrading stats database to version 1");
+			Database->RunQuery("BEGIN TRANSACTION");
+			CreateReplayCatalog();
+			Database->RunQuery("UPDATE DatabaseInfo SET Version = 1");
+			Database->RunQuery("END TRANSACTION");
 		}
 	}
 
@@ -142,6 +150,9 @@ int _Save::InitStatsDatabase() {
 		// Create indexes
 		Database->RunQuery("CREATE INDEX StatsLevelFile on Stats (LevelFile ASC)");
 
+		// Create replay catalog
+		CreateReplayCatalog();
+
 		// Add version number
 		char Buffer[256];
 		sprintf(Buffer, "INSERT INTO DatabaseInfo(Version) VALUES(%d)", STATS_VERSION);
@@ -305,3 +316,188 @@ void _Save::UnlockLevel(const std::string &Level) {
 		Stats.ID = (int)Database->GetLastInsertID();
 	}
 }
+
+// Create the table that caches replay headers
+void _Save::CreateReplayCatalog() {
+
+	Database->RunQuery(
+		"CREATE TABLE Replays(\n"
+		"File TEXT PRIMARY KEY,\n"
+		"Size INTEGER,\n"
+		"ModifiedTime INTEGER,\n"
+		"Version INTEGER DEFAULT(0),\n"
+		"LevelVersion INTEGER DEFAULT(0),\n"
+		"LevelFile TEXT,\n"
+		"Description TEXT,\n"
+		"FinishTime FLOAT DEFAULT(0),\n"
+		"TimeStep FLOAT DEFAULT(0),\n"
+		"Timestamp INTEGER DEFAULT(0),\n"
+		"Platform INTEGER DEFAULT(0),\n"
+		"Autosave INTEGER DEFAULT(0),\n"
+		"Won INTEGER DEFAULT(0)\n"
+		")");
+
+	Database->RunQuery("CREATE INDEX ReplaysTimestamp on Replays (Timestamp DESC)");
+	Database->RunQuery("CREATE INDEX ReplaysLevelFile on Replays (LevelFile ASC, Timestamp DESC)");
+}
+
+// Sync the replay catalog with the replay directory, only changed files are parsed
+int _Save::UpdateReplayCatalog() {
+
+	// Get cached file stats
+	std::map<std::string, std::pair<int64_t, int64_t>> CachedFiles;
+	Database->RunDataQuery("SELECT File, Size, ModifiedTime FROM Replays");
+	while(Database->FetchRow())
+		CachedFiles[Database->GetString(0)] = std::make_pair(Database->GetInt64(1), Database->GetInt64(2));
+	Database->CloseQuery();
+
+	// Get a list of replays
+	std::string OldWorkingDirectory(irrFile->getWorkingDirectory().c_str());
+	irrFile->changeWorkingDirectoryTo(ReplayPath.c_str());
+	irr::io::IFileList *FileList = irrFile->createFileList();
+	irrFile->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+
+	Database->RunQuery("BEGIN TRANSACTION");
+
+	int ParsedCount = 0;
+	uint32_t FileCount = FileList->getFileCount();
+	for(uint32_t i = 0; i < FileCount; i++) {
+		std::string File = FileList->getFileName(i).c_str();
+		if(FileList->isDirectory(i) || File.find(".replay") == std::string::npos)
+			continue;
+
+		// Get file size and modified time
+		struct stat FileStat;
+		std::string FilePath = ReplayPath + File;
+		if(stat(FilePath.c_str(), &FileStat) != 0)
+			continue;
+
+		// Skip unchanged files
+		auto CachedFile = CachedFiles.find(File);
+		if(CachedFile != CachedFiles.end()) {
+			bool Changed = CachedFile->second.first != (int64_t)FileStat.st_size || CachedFile->second.second != (int64_t)FileStat.st_mtime;
+			CachedFiles.erase(CachedFile);
+			if(!Changed)
+				continue;
+		}
+
+		// Read header, invalid files are cached with version 0 so they aren't parsed again
+		bool Loaded = Replay.LoadReplay(FilePath, true);
+		char *Query = sqlite3_mprintf(
+			"INSERT OR REPLACE INTO Replays(File, Size, ModifiedTime, Version, LevelVersion, LevelFile, Description, FinishTime, TimeStep, Timestamp, Platform, Autosave, Won) "
+			"VALUES(%Q, %lld, %lld, %d, %d, %Q, %Q, %.9g, %.17g, %lld, %d, %d, %d)",
+			File.c_str(),
+			(long long)FileStat.st_size,
+			(long long)FileStat.st_mtime,
+			Loaded ? Replay.GetVersion() : 0,
+			Replay.GetLevelVersion(),
+			Replay.GetLevelName().c_str(),
+			Replay.GetDescription().c_str(),
+			(double)Replay.GetFinishTime(),
+			(double)Replay.GetTimeStep(),
+			(long long)Replay.GetTimestamp(),
+			(int)Replay.GetPlatform(),
+			(int)Replay.GetAutosave(),
+			(int)Replay.GetWon());
+		Database->RunQuery(Query);
+		sqlite3_free(Query);
+
+		ParsedCount++;
+	}
+	FileList->drop();
+
+	// Remove entries for missing files
+	for(const auto &CachedFile : CachedFiles)
+		RemoveReplay(CachedFile.first);
+
+	Database->RunQuery("END TRANSACTION");
+
+	UpdateReplayLevels();
+
+	return ParsedCount;
+}
+
+// Cache the current version and name of each level referenced by the catalog
+void _Save::UpdateReplayLevels() {
+
+	// Level files can change between runs, so this table only lives as long as the connection
+	Database->RunQuery("CREATE TEMP TABLE IF NOT EXISTS ReplayLevels(LevelFile TEXT PRIMARY KEY, Version INTEGER, NiceName TEXT)");
+
+	// Get levels that haven't been looked up yet
+	std::vector<std::string> LevelFiles;
+	Database->RunDataQuery("SELECT DISTINCT LevelFile FROM Replays WHERE LevelFile NOT IN (SELECT LevelFile FROM ReplayLevels)");
+	while(Database->FetchRow())
+		LevelFiles.push_back(Database->GetString(0) ? Database->GetString(0) : "");
+	Database->CloseQuery();
+
+	Database->RunQuery("BEGIN TRANSACTION");
+	for(const auto &LevelFile : LevelFiles) {
+
+		// Missing levels get a null version so their replays are filtered out
+		char *Query;
+		if(!LevelFile.empty() && Level.Init(LevelFile, true))
+			Query = sqlite3_mprintf("INSERT INTO ReplayLevels(LevelFile, Version, NiceName) VALUES(%Q, %d, %Q)", LevelFile.c_str(), Level.LevelVersion, Level.LevelNiceName.c_str());
+		else
+			Query = sqlite3_mprintf("INSERT INTO ReplayLevels(LevelFile, Version, NiceName) VALUES(%Q, NULL, '')", LevelFile.c_str());
+
+		Database->RunQuery(Query);
+		sqlite3_free(Query);
+	}
+	Database->RunQuery("END TRANSACTION");
+}
+
+// Build the filter for replays that can be played with this build
+static std::string GetReplayFilter() {
+	char Buffer[512];
+	snprintf(Buffer, 512,
+		" FROM Replays JOIN ReplayLevels ON Replays.LevelFile = ReplayLevels.LevelFile"
+		" WHERE Replays.Version >= %d AND Replays.Version <= %d AND ABS(Replays.TimeStep - %.17g) < 1e-9 AND Replays.LevelVersion >= ReplayLevels.Version",
+		REPLAY_MIN_VERSION,
+		REPLAY_VERSION,
+		(double)PHYSICS_TIMESTEP);
+
+	return Buffer;
+}
+
+// Get the number of playable replays in the catalog
+int _Save::GetReplayCount() {
+
+	return Database->RunCountQuery(("SELECT COUNT(*)" + GetReplayFilter()).c_str());
+}
+
+// Get one page of playable replays from the catalog
+void _Save::GetReplayPage(bool SortByLevel, uint32_t Offset, uint32_t Count, std::vector<_ReplayCatalogEntry> &Page) {
+	Page.clear();
+
+	char Buffer[128];
+	snprintf(Buffer, 128, " LIMIT %u OFFSET %u", Count, Offset);
+	std::string Query =
+		"SELECT Replays.File, Replays.LevelFile, ReplayLevels.NiceName, Replays.Description, Replays.FinishTime, Replays.Timestamp, Replays.Platform, Replays.Autosave, Replays.Won"
+		+ GetReplayFilter()
+		+ (SortByLevel ? " ORDER BY Replays.LevelFile ASC, Replays.Timestamp DESC" : " ORDER BY Replays.Timestamp DESC")
+		+ Buffer;
+
+	Database->RunDataQuery(Query.c_str());
+	while(Database->FetchRow()) {
+		_ReplayCatalogEntry Entry;
+		Entry.File = Database->GetString(0);
+		Entry.LevelFile = Database->GetString(1);
+		Entry.LevelNiceName = Database->GetString(2) ? Database->GetString(2) : "";
+		Entry.Description = Database->GetString(3) ? Database->GetString(3) : "";
+		Entry.FinishTime = Database->GetFloat(4);
+		Entry.Timestamp = (time_t)Database->GetInt64(5);
+		Entry.Platform = (char)Database->GetInt(6);
+		Entry.Autosave = Database->GetInt(7);
+		Entry.Won = Database->GetInt(8);
+		Page.push_back(Entry);
+	}
+	Database->CloseQuery();
+}
+
+// Remove a replay from the catalog
+void _Save::RemoveReplay(const std::string &File) {
+
+	char *Query = sqlite3_mprintf("DELETE FROM Replays WHERE File = %Q", File.c_str());
+	Database->RunQuery(Query);
+	sqlite3_free(Query);
+}
@@ -19,6 +19,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <cstdint>
 #include <ctime>
 
 // Forward Declarations
@@ -50,6 +51,21 @@ struct _LevelStat {
 	std::vector<_HighScore> HighScores;
 };
 
+// Struct for one cached replay header
+struct _ReplayCatalogEntry {
+	_ReplayCatalogEntry() : FinishTime(0.0f), Timestamp(0), Platform(0), Autosave(false), Won(false) { }
+
+	std::string File;
+	std::string LevelFile;
+	std::string LevelNiceName;
+	std::string Description;
+	float FinishTime;
+	time_t Timestamp;
+	char Platform;
+	bool Autosave;
+	bool Won;
+};
+
 // Classes
 class _Save {
 
@@ -66,6 +82,12 @@ class _Save {
 		int AddScore(const std::string &Level, float Time);
 		void UnlockLevel(const std::string &Level);
 
+		// Replay catalog
+		int UpdateReplayCatalog();
+		int GetReplayCount();
+		void GetReplayPage(bool SortByLevel, uint32_t Offset, uint32_t Count, std::vector<_ReplayCatalogEntry> &Page);
+		void RemoveReplay(const std::string &File);
+
 		// Paths
 		std::string SavePath;
 		std::string ReplayPath;
@@ -80,6 +102,9 @@ class _Save {
 
 	private:
 
+		void CreateReplayCatalog();
+		void UpdateReplayLevels();
+
 		// Database
 		_Database *Database;
 };
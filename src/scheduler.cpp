@@ -0,0 +1,117 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <scheduler.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Orders the heap so the earliest event is on top
+static bool CompareEvents(const _ScheduledEvent &Left, const _ScheduledEvent &Right) {
+	if(Left.Timestamp != Right.Timestamp)
+		return Left.Timestamp > Right.Timestamp;
+
+	return Left.Sequence > Right.Sequence;
+}
+
+// Constructor
+_Scheduler::_Scheduler() :
+	NextSequence(0),
+	NextID(0) {
+}
+
+// Schedules a callback, repeating every period if it's greater than zero. Returns an ID for cancelling.
+int _Scheduler::Add(int Callback, float Timestamp, float Period) {
+	_ScheduledEvent Event;
+	Event.Timestamp = Timestamp;
+	Event.Period = Period;
+	Event.ID = NextID++;
+	Event.Callback = Callback;
+	Push(Event);
+	Active.insert(Event.ID);
+
+	return Event.ID;
+}
+
+// Cancels an event, returns false if it already fired or was cancelled
+bool _Scheduler::Cancel(int ID) {
+	return Active.erase(ID) > 0;
+}
+
+// Removes the next event due at a time, repeating events are scheduled again before returning
+bool _Scheduler::GetNext(float Time, int &Callback) {
+	_ScheduledEvent Event;
+	if(!PopDue(Time, Event))
+		return false;
+
+	// Reschedule past the current time so a repeating event can't fire again in the same update
+	if(Event.Period > 0.0f) {
+		Event.Timestamp = std::max(Event.Timestamp + Event.Period, std::nextafter(Time, std::numeric_limits<float>::max()));
+		Push(Event);
+	}
+	else
+		Active.erase(Event.ID);
+
+	Callback = Event.Callback;
+	return true;
+}
+
+// Holds back the next event due at a time until Restore is called
+void _Scheduler::Defer(float Time) {
+	_ScheduledEvent Event;
+	if(PopDue(Time, Event))
+		Deferred.push_back(Event);
+}
+
+// Puts deferred events back in their original order
+void _Scheduler::Restore() {
+	for(const auto &Event : Deferred) {
+		Events.push_back(Event);
+		std::push_heap(Events.begin(), Events.end(), CompareEvents);
+	}
+	Deferred.clear();
+}
+
+// Removes all events
+void _Scheduler::Clear() {
+	Events.clear();
+	Deferred.clear();
+	Active.clear();
+	NextSequence = 0;
+	NextID = 0;
+}
+
+// Adds an event to the heap
+void _Scheduler::Push(const _ScheduledEvent &Event) {
+	Events.push_back(Event);
+	Events.back().Sequence = NextSequence++;
+	std::push_heap(Events.begin(), Events.end(), CompareEvents);
+}
+
+// Removes the next event due at a time, dropping cancelled events on the way
+bool _Scheduler::PopDue(float Time, _ScheduledEvent &Event) {
+	while(!Events.empty() && Time >= Events.front().Timestamp) {
+		std::pop_heap(Events.begin(), Events.end(), CompareEvents);
+		Event = Events.back();
+		Events.pop_back();
+
+		if(Active.count(Event.ID))
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+// Event waiting in the scheduler
+struct _ScheduledEvent {
+	float Timestamp;
+	float Period;
+	uint32_t Sequence;
+	int ID;
+	int Callback;
+};
+
+// Timed events kept in a binary heap, fired in order of timestamp then the order they were scheduled
+class _Scheduler {
+
+	public:
+
+		_Scheduler();
+
+		int Add(int Callback, float Timestamp, float Period=0.0f);
+		bool Cancel(int ID);
+		bool GetNext(float Time, int &Callback);
+		void Defer(float Time);
+		void Restore();
+		void Clear();
+
+		size_t GetCount() const { return Active.size(); }
+
+	private:
+
+		void Push(const _ScheduledEvent &Event);
+		bool PopDue(float Time, _ScheduledEvent &Event);
+
+		// Heap of events, cancelled events are dropped when they reach the top
+		std::vector<_ScheduledEvent> Events;
+		std::vector<_ScheduledEvent> Deferred;
+		std::unordered_set<int> Active;
+		uint32_t NextSequence;
+		int NextID;
+
+};
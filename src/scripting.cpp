@@ -31,6 +31,8 @@
 #include <audio.h>
 #include <framework.h>
 #include <menu.h>
+#include <profiler.h>
+#include <algorithm>
 #include <random>
 
 _Scripting Scripting;
@@ -106,6 +108,7 @@ luaL_Reg _Scripting::RandomFunctions[] = {
 luaL_Reg _Scripting::TimerFunctions[] = {
 	{"Stamp", &_Scripting::TimerStamp},
 	{"Callback", &_Scripting::TimerCallback},
+	{"Cancel", &_Scripting::TimerCancel},
 	{nullptr, nullptr}
 };
 
@@ -152,8 +155,13 @@ int luaopen_Timer(lua_State *State) {
 
 // Constructor
 _Scripting::_Scripting() :
+	LegacyTimerOrder(false),
+	CollisionList(LUA_NOREF),
+	CollisionListSize(0),
 	LuaObject(nullptr) {
 
+	MousePressCallback = GetCallback("OnMousePress");
+	CollisionsCallback = GetCallback("OnCollisions");
 }
 
 // Initializes the scripting interface
@@ -201,7 +209,12 @@ void _Scripting::Reset() {
 
 	// Clean up
 	KeyCallbacks.clear();
-	TimedCallbacks.clear();
+	TimedCallbacks.Clear();
+	QueuedCollisions.clear();
+	CollisionList = LUA_NOREF;
+	CollisionListSize = 0;
+	for(auto &Callback : Callbacks)
+		Callback.Reference = LUA_NOREF;
 }
 
 // Loads a Lua file
@@ -216,6 +229,21 @@ int _Scripting::LoadFile(const std::string &FilePath) {
 		return 0;
 	}
 
+	// Look up callbacks again since the script may have defined them
+	ClearCallbackReferences();
+
+	return 1;
+}
+
+// Runs a string of Lua code
+int _Scripting::RunString(const std::string &Code) {
+	if(luaL_dostring(LuaObject, Code.c_str()) != 0) {
+		Log.Write("Failed to run script: %s", lua_tostring(LuaObject, -1));
+		return 0;
+	}
+
+	ClearCallbackReferences();
+
 	return 1;
 }
 
@@ -244,44 +272,149 @@ bool _Scripting::CheckArguments(lua_State *LuaObject, int Required) {
 	return true;
 }
 
-// Calls a Lua function by name
-void _Scripting::CallFunction(const std::string &FunctionName) {
+// Gets a handle for a Lua function name, -1 for no function
+int _Scripting::GetCallback(const std::string &FunctionName) {
+	if(FunctionName == "")
+		return -1;
 
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
-	if(!lua_isfunction(LuaObject, -1)) {
-		lua_pop(LuaObject, 1);
-		return;
+	auto Iterator = CallbackHandles.find(FunctionName);
+	if(Iterator != CallbackHandles.end())
+		return Iterator->second;
+
+	_ScriptCallback Callback;
+	Callback.Name = FunctionName;
+	Callback.Reference = LUA_NOREF;
+	Callbacks.push_back(Callback);
+
+	int Handle = (int)Callbacks.size() - 1;
+	CallbackHandles[FunctionName] = Handle;
+
+	return Handle;
+}
+
+// Determines if a callback's function exists, looking it up the first time it's used after scripts load
+bool _Scripting::IsDefined(int Callback) {
+	if(Callback < 0 || !LuaObject)
+		return false;
+
+	_ScriptCallback &ScriptCallback = Callbacks[Callback];
+	if(ScriptCallback.Reference == LUA_NOREF) {
+		lua_getglobal(LuaObject, ScriptCallback.Name.c_str());
+		if(lua_isfunction(LuaObject, -1))
+			ScriptCallback.Reference = luaL_ref(LuaObject, LUA_REGISTRYINDEX);
+		else {
+			lua_pop(LuaObject, 1);
+			ScriptCallback.Reference = LUA_REFNIL;
+		}
+	}
+
+	return ScriptCallback.Reference != LUA_REFNIL;
+}
+
+// Pushes a callback's function onto the stack
+bool _Scripting::PushCallback(int Callback) {
+	if(!IsDefined(Callback))
+		return false;
+
+	lua_rawgeti(LuaObject, LUA_REGISTRYINDEX, Callbacks[Callback].Reference);
+
+	return true;
+}
+
+// Releases callback references so they are looked up again
+void _Scripting::ClearCallbackReferences() {
+	for(auto &Callback : Callbacks) {
+		luaL_unref(LuaObject, LUA_REGISTRYINDEX, Callback.Reference);
+		Callback.Reference = LUA_NOREF;
 	}
+}
+
+// Calls a Lua function
+void _Scripting::CallFunction(int Callback) {
+	if(!PushCallback(Callback))
+		return;
+
+	_ProfileScope Scope(_Profiler::LUA);
 
 	lua_call(LuaObject, 0, 0);
 }
 
 // Passes collision events to Lua
-void _Scripting::CallCollisionHandler(const std::string &FunctionName, _Object *BaseObject, _Object *OtherObject) {
-
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
-	if(!lua_isfunction(LuaObject, -1)) {
-		lua_pop(LuaObject, 1);
+void _Scripting::CallCollisionHandler(int Callback, _Object *BaseObject, _Object *OtherObject) {
+	if(!PushCallback(Callback))
 		return;
-	}
+
+	_ProfileScope Scope(_Profiler::LUA);
 
 	lua_pushlightuserdata(LuaObject, BaseObject);
 	lua_pushlightuserdata(LuaObject, OtherObject);
 	lua_call(LuaObject, 2, 0);
 }
 
-// Calls a zone enter/exit event
-void _Scripting::CallZoneHandler(const std::string &FunctionName, int Type, _Object *Zone, _Object *Object) {
+// Passes the step's queued collisions to OnCollisions as a list of tables
+void _Scripting::FlushCollisions() {
+	if(QueuedCollisions.empty())
+		return;
 
-	// Check for the function name
-	lua_getglobal(LuaObject, FunctionName.c_str());
-	if(!lua_isfunction(LuaObject, -1)) {
-		lua_pop(LuaObject, 1);
+	// Handlers can cause more collisions to be queued
+	BatchedCollisions.swap(QueuedCollisions);
+	QueuedCollisions.clear();
+	if(!PushCallback(CollisionsCallback))
 		return;
+
+	_ProfileScope Scope(_Profiler::LUA);
+
+	// Reuse the list and its entries from earlier steps
+	if(CollisionList == LUA_NOREF) {
+		lua_newtable(LuaObject);
+		CollisionList = luaL_ref(LuaObject, LUA_REGISTRYINDEX);
+		CollisionListSize = 0;
+	}
+	lua_rawgeti(LuaObject, LUA_REGISTRYINDEX, CollisionList);
+
+	for(size_t i = 0; i < BatchedCollisions.size(); i++) {
+		const _ObjectCollision &ObjectCollision = BatchedCollisions[i];
+
+		if(lua_rawgeti(LuaObject, -1, (lua_Integer)i + 1) != LUA_TTABLE) {
+			lua_pop(LuaObject, 1);
+			lua_createtable(LuaObject, 0, 6);
+			lua_pushvalue(LuaObject, -1);
+			lua_rawseti(LuaObject, -3, (lua_Integer)i + 1);
+		}
+
+		lua_pushlightuserdata(LuaObject, ObjectCollision.Object);
+		lua_setfield(LuaObject, -2, "Object");
+		lua_pushlightuserdata(LuaObject, ObjectCollision.OtherObject);
+		lua_setfield(LuaObject, -2, "OtherObject");
+		lua_pushinteger(LuaObject, ObjectCollision.ContactCount);
+		lua_setfield(LuaObject, -2, "Contacts");
+		lua_pushnumber(LuaObject, ObjectCollision.AverageNormal[0]);
+		lua_setfield(LuaObject, -2, "NormalX");
+		lua_pushnumber(LuaObject, ObjectCollision.AverageNormal[1]);
+		lua_setfield(LuaObject, -2, "NormalY");
+		lua_pushnumber(LuaObject, ObjectCollision.AverageNormal[2]);
+		lua_setfield(LuaObject, -2, "NormalZ");
+		lua_pop(LuaObject, 1);
 	}
 
+	// Trim entries left over from a longer list
+	for(size_t i = BatchedCollisions.size(); i < CollisionListSize; i++) {
+		lua_pushnil(LuaObject);
+		lua_rawseti(LuaObject, -2, (lua_Integer)i + 1);
+	}
+	CollisionListSize = BatchedCollisions.size();
+	BatchedCollisions.clear();
+
+	lua_call(LuaObject, 1, 0);
+}
+
+// Calls a zone enter/exit event
+void _Scripting::CallZoneHandler(int Callback, int Type, _Object *Zone, _Object *Object) {
+	if(!PushCallback(Callback))
+		return;
+
+	_ProfileScope Scope(_Profiler::LUA);
+
 	// Set parameters
 	lua_pushinteger(LuaObject, Type);
 	lua_pushlightuserdata(LuaObject, Zone);
@@ -313,11 +446,10 @@ bool _Scripting::HandleKeyPress(int Key) {
 void _Scripting::HandleMousePress(int Button, int MouseX, int MouseY) {
 
 	// Get Lua function
-	lua_getglobal(LuaObject, "OnMousePress");
-	if(!lua_isfunction(LuaObject, -1)) {
-		lua_pop(LuaObject, 1);
+	if(!PushCallback(MousePressCallback))
 		return;
-	}
+
+	_ProfileScope Scope(_Profiler::LUA);
 
 	// Pass parameters and call function
 	lua_pushnumber(LuaObject, Button);
@@ -331,7 +463,7 @@ int _Scripting::AudioPlay(lua_State *LuaObject) {
 
 	// Validate arguments
 	int ArgumentCount = lua_gettop(LuaObject);
-	if(ArgumentCount < 4 || ArgumentCount > 9)
+	if(ArgumentCount < 4 || ArgumentCount > 10)
 		return 0;
 
 	// Get parameters
@@ -360,12 +492,16 @@ int _Scripting::AudioPlay(lua_State *LuaObject) {
 	if(ArgumentCount > 8)
 		RollOff = (float)lua_tonumber(LuaObject, 9);
 
+	// Looping sounds never restart once stolen, so keep them over one-shots by default
+	int Priority = Looping ? 1 : 0;
+	if(ArgumentCount > 9)
+		Priority = (int)lua_tonumber(LuaObject, 10);
+
 	// Play sound
-	_AudioSource *Source = new _AudioSource(Audio.GetBuffer(File), Looping, MinGain, MaxGain, ReferenceDistance, RollOff);
-	Audio.Play(Source, PositionX, PositionY, PositionZ);
+	uint32_t Handle = Audio.Play(Audio.GetBuffer(File), PositionX, PositionY, PositionZ, Looping, MinGain, MaxGain, ReferenceDistance, RollOff, Priority);
 
-	// Return audio source
-	lua_pushlightuserdata(LuaObject, Source);
+	// Return voice handle
+	lua_pushnumber(LuaObject, Handle);
 
 	return 1;
 }
@@ -379,9 +515,8 @@ int _Scripting::AudioStop(lua_State *LuaObject) {
 		return 0;
 
 	// Get parameters
-	_AudioSource *Source = (_AudioSource *)lua_touserdata(LuaObject, 1);
-	if(Source)
-		Source->Stop();
+	uint32_t Handle = (uint32_t)lua_tonumber(LuaObject, 1);
+	Audio.Stop(Handle);
 
 	return 0;
 }
@@ -933,19 +1068,33 @@ int _Scripting::RandomSeed(lua_State *LuaObject) {
 	return 0;
 }
 
-// Adds a timed callback
+// Adds a timed callback, optionally repeating, and returns its ID
 int _Scripting::TimerCallback(lua_State *LuaObject) {
 
 	// Validate arguments
-	if(!CheckArguments(LuaObject, 2))
+	int ArgumentCount = lua_gettop(LuaObject);
+	if(ArgumentCount != 3 && !CheckArguments(LuaObject, 2))
 		return 0;
 
 	// Get parameters
 	std::string FunctionName = lua_tostring(LuaObject, 1);
 	float Time = (float)lua_tonumber(LuaObject, 2);
+	bool Repeat = ArgumentCount == 3 && lua_toboolean(LuaObject, 3);
 
 	// Add function to list
-	Scripting.AddTimedCallback(FunctionName, Time);
+	lua_pushinteger(LuaObject, Scripting.AddTimedCallback(FunctionName, Time, Repeat));
+
+	return 1;
+}
+
+// Cancels a timed callback by ID
+int _Scripting::TimerCancel(lua_State *LuaObject) {
+
+	// Validate arguments
+	if(!CheckArguments(LuaObject, 1))
+		return 0;
+
+	Scripting.TimedCallbacks.Cancel((int)lua_tointeger(LuaObject, 1));
 
 	return 0;
 }
@@ -958,44 +1107,30 @@ int _Scripting::TimerStamp(lua_State *LuaObject) {
 	return 1;
 }
 
-// Adds a timed callback function to the list
-void _Scripting::AddTimedCallback(const std::string &FunctionName, float Time) {
+// Schedules a timed callback, returns -1 for an invalid time
+int _Scripting::AddTimedCallback(const std::string &FunctionName, float Time, bool Repeat) {
 
 	// Check time
 	if(Time <= 0.0)
-		return;
+		return -1;
 
-	// Create callback structure
-	_TimedCallback Callback;
-	Callback.Timestamp = PlayState.GetTimer() + Time;
-	Callback.Function = FunctionName;
-
-	// Insert in order
-	auto Iterator = TimedCallbacks.begin();
-	for(; Iterator != TimedCallbacks.end(); ++Iterator) {
-		if(Callback.Timestamp < (*Iterator).Timestamp)
-			break;
-	}
-
-	// Add callback
-	TimedCallbacks.insert(Iterator, Callback);
+	// Repeating timers fire at most once per step
+	return TimedCallbacks.Add(GetCallback(FunctionName), PlayState.GetTimer() + Time, Repeat ? std::max(Time, PHYSICS_TIMESTEP) : 0.0f);
 }
 
-// Updates the timed callback functions
+// Calls the timed callbacks that are due
 void _Scripting::UpdateTimedCallbacks() {
+	_ProfileScope Scope(_Profiler::TIMERS);
 
-	for(auto Iterator = TimedCallbacks.begin(); Iterator != TimedCallbacks.end(); ++Iterator) {
-		if(PlayState.GetTimer() >= (*Iterator).Timestamp) {
-			Scripting.CallFunction((*Iterator).Function);
+	int Callback;
+	while(TimedCallbacks.GetNext(PlayState.GetTimer(), Callback)) {
+		CallFunction(Callback);
 
-			// Remove callback
-			Iterator = TimedCallbacks.erase(Iterator);
-			if(Iterator == TimedCallbacks.end())
-				break;
-		}
-		else
-			return;
+		// Older replays were recorded with a loop that skipped the timer after each one it fired
+		if(LegacyTimerOrder)
+			TimedCallbacks.Defer(PlayState.GetTimer());
 	}
+	TimedCallbacks.Restore();
 }
 
 // Attaches a key to a Lua function
@@ -1004,5 +1139,5 @@ void _Scripting::AttachKeyToFunction(int Key, const std::string &FunctionName) {
 	// Install callback
 	auto KeyCallbacksIterator = KeyCallbacks.find(Key);
 	if(KeyCallbacksIterator == KeyCallbacks.end())
-		KeyCallbacks.insert(std::pair<int, std::string>(Key, FunctionName));
+		KeyCallbacks.insert(std::pair<int, int>(Key, GetCallback(FunctionName)));
 }
@@ -16,15 +16,19 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 #pragma once
+#include <physics.h>
+#include <scheduler.h>
 #include <lua/lua.hpp>
-#include <list>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 // Structures
-struct _TimedCallback {
-	float Timestamp;
-	std::string Function;
+// Lua function found by name, kept as a registry reference until scripts are loaded again
+struct _ScriptCallback {
+	std::string Name;
+	int Reference;
 };
 
 // Forward Declarations
@@ -43,16 +47,25 @@ class _Scripting {
 
 		void Reset();
 		int LoadFile(const std::string &FilePath);
+		int RunString(const std::string &Code);
 
 		void DefineLuaVariable(const char *VariableName, const char *Value);
 
-		void CallFunction(const std::string &FunctionName);
-		void CallCollisionHandler(const std::string &FunctionName, _Object *BaseObject, _Object *OtherObject);
-		void CallZoneHandler(const std::string &FunctionName, int Type, _Object *Zone, _Object *Object);
+		int GetCallback(const std::string &FunctionName);
+		void CallFunction(int Callback);
+		void CallCollisionHandler(int Callback, _Object *BaseObject, _Object *OtherObject);
+		void CallZoneHandler(int Callback, int Type, _Object *Zone, _Object *Object);
+
+		// Collision events are passed to OnCollisions once per step when a level defines it
+		bool IsBatchingCollisions() { return IsDefined(CollisionsCallback); }
+		void QueueCollision(const _ObjectCollision &ObjectCollision) { QueuedCollisions.push_back(ObjectCollision); }
+		void FlushCollisions();
+		lua_State *GetState() { return LuaObject; }
 
 		bool HandleKeyPress(int Key);
 		void HandleMousePress(int Button, int MouseX, int MouseY);
 		void UpdateTimedCallbacks();
+		void SetLegacyTimerOrder(bool Value) { LegacyTimerOrder = Value; }
 
 		static luaL_Reg CameraFunctions[], ObjectFunctions[], OrbFunctions[], TimerFunctions[], LevelFunctions[],
 						GUIFunctions[], AudioFunctions[], RandomFunctions[], ZoneFunctions[];
@@ -100,14 +113,33 @@ class _Scripting {
 		static int RandomSeed(lua_State *LuaObject);
 
 		static int TimerCallback(lua_State *LuaObject);
+		static int TimerCancel(lua_State *LuaObject);
 		static int TimerStamp(lua_State *LuaObject);
 
-		void AddTimedCallback(const std::string &FunctionName, float Time);
+		int AddTimedCallback(const std::string &FunctionName, float Time, bool Repeat);
 		void AttachKeyToFunction(int Key, const std::string &FunctionName);
+		bool IsDefined(int Callback);
+		bool PushCallback(int Callback);
+		void ClearCallbackReferences();
+
+		_Scheduler TimedCallbacks;
+		bool LegacyTimerOrder;
+
+		std::map<int, int> KeyCallbacks;
+
+		// Callbacks by handle, handles stay valid across resets
+		std::vector<_ScriptCallback> Callbacks;
+		std::unordered_map<std::string, int> CallbackHandles;
+		int MousePressCallback;
+		int CollisionsCallback;
 
-		std::list<_TimedCallback> TimedCallbacks;
+		// Collisions waiting for OnCollisions
+		std::vector<_ObjectCollision> QueuedCollisions;
+		std::vector<_ObjectCollision> BatchedCollisions;
 
-		std::map<int, std::string> KeyCallbacks;
+		// Registry reference to the list passed to OnCollisions
+		int CollisionList;
+		size_t CollisionListSize;
 
 		lua_State *LuaObject;
 
@@ -35,6 +35,9 @@
 #include <save.h>
 #include <objects/player.h>
 #include <menu.h>
+#include <profiler.h>
+#include <validator.h>
+#include <benchmark.h>
 #include <states/viewreplay.h>
 #include <states/null.h>
 #include <ISceneManager.h>
@@ -71,6 +74,9 @@ int _PlayState::Init() {
 		TestLevel = InputReplay->GetLevelName();
 	}
 
+	// Fire timers the way the replay was recorded
+	Scripting.SetLegacyTimerOrder(ReplayInputs && InputReplay->GetVersion() < REPLAY_TIMER_ORDER_VERSION);
+
 	// Get level name
 	std::string LevelFile;
 	if(TestLevel != "") {
@@ -165,8 +171,9 @@ void _PlayState::ResetLevel() {
 	ObjectManager.ClearObjects();
 	Physics.Reset();
 
-	// Start replay recording
-	Replay.StartRecording();
+	// Start replay recording, headless workers share the replay directory so skip it
+	if(!Framework.IsHeadless())
+		Replay.StartRecording();
 
 	// Load level objects
 	Level.SpawnEntities();
@@ -304,6 +311,15 @@ bool _PlayState::HandleKeyPress(int Key) {
 			case KEY_F5:
 				Framework.ChangeState(&PlayState);
 			break;
+			case KEY_F6:
+				Profiler.ShowOverlay = !Profiler.ShowOverlay;
+				if(Profiler.ShowOverlay)
+					Profiler.SetEnabled(true);
+			break;
+			case KEY_F7:
+				if(Profiler.ExportTrace(Save.SavePath + "profile.json"))
+					Interface.SetShortMessage("Profile saved", INTERFACE_SHORTMESSAGE_X, INTERFACE_SHORTMESSAGE_Y);
+			break;
 			case KEY_F10:
 				Config.SoundVolume = !Config.SoundVolume;
 				Audio.SetGain(Config.SoundVolume);
@@ -435,8 +451,13 @@ void _PlayState::Draw() {
 	Interface.RenderHUD(Timer, FirstLoad);
 
 	// Draw fps
-	if(Config.ShowFPS)
+	if(Config.ShowFPS) {
 		Interface.RenderFPS(irrDriver->getScreenSize().Width - 140 * Interface.GetUIScale(), 10 * Interface.GetUIScale());
+		Interface.RenderObjectCount(irrDriver->getScreenSize().Width - 140 * Interface.GetUIScale(), 35 * Interface.GetUIScale());
+	}
+
+	// Draw profiler
+	Interface.RenderProfiler(10 * Interface.GetUIScale(), 100 * Interface.GetUIScale());
 
 	// Darken the screen
 	if(IsPaused())
@@ -464,7 +485,15 @@ void _PlayState::StartReset() {
 // Win the level and update stats
 void _PlayState::WinLevel(bool HideNextLevel) {
 
+	// Benchmarks only need to know the level ended
+	if(Benchmark.EndLevel())
+		return;
+
 	Log.Write("Won %s %fs", Level.LevelName.c_str(), PlayState.Timer);
+	if(ReplayInputs && Framework.IsHeadless()) {
+		Validator.ReportResult(_ValidateResult::STATUS_WON, Timer, InputReplay->GetFinishTime(), InputReplay->GetWon());
+		return;
+	}
 
 	// Skip stats if just testing a level
 	if(PlayState.TestLevel == "") {
@@ -498,7 +527,15 @@ void _PlayState::WinLevel(bool HideNextLevel) {
 // Lose the level and update stats
 void _PlayState::LoseLevel() {
 
+	// Benchmarks only need to know the level ended
+	if(Benchmark.EndLevel())
+		return;
+
 	Log.Write("Lose %s %fs", Level.LevelName.c_str(), PlayState.Timer);
+	if(ReplayInputs && Framework.IsHeadless()) {
+		Validator.ReportResult(_ValidateResult::STATUS_LOST, Timer, InputReplay->GetFinishTime(), InputReplay->GetWon());
+		return;
+	}
 
 	// Skip stats if just testing a level
 	if(PlayState.TestLevel == "") {
@@ -528,13 +565,13 @@ void _PlayState::RecordInput() {
 	float Pitch = Camera->GetPitch();
 
 	// Write replay event
-	std::fstream &ReplayFile = Replay.GetFile();
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
 	Replay.WriteEvent(_Replay::PACKET_INPUT);
-	ReplayFile.write((char *)&Push.X, sizeof(Push.X));
-	ReplayFile.write((char *)&Push.Z, sizeof(Push.Z));
-	ReplayFile.write((char *)&Yaw, sizeof(Yaw));
-	ReplayFile.write((char *)&Pitch, sizeof(Pitch));
-	ReplayFile.write((char *)&Jumped, sizeof(Jumped));
+	ReplayWriter.Write((char *)&Push.X, sizeof(Push.X));
+	ReplayWriter.Write((char *)&Push.Z, sizeof(Push.Z));
+	ReplayWriter.Write((char *)&Yaw, sizeof(Yaw));
+	ReplayWriter.Write((char *)&Pitch, sizeof(Pitch));
+	ReplayWriter.Write((char *)&Jumped, sizeof(Jumped));
 }
 
 // Record player speed to replay
@@ -546,9 +583,9 @@ void _PlayState::RecordPlayerSpeed() {
 	float Speed = glm::length(Player->GetLinearVelocity()) + glm::length(Player->GetAngularVelocity());
 
 	// Write replay event
-	std::fstream &ReplayFile = Replay.GetFile();
+	_ReplayWriter &ReplayWriter = Replay.GetWriter();
 	Replay.WriteEvent(_Replay::PACKET_PLAYERSPEED);
-	ReplayFile.write((char *)&Speed, sizeof(Speed));
+	ReplayWriter.Write((char *)&Speed, sizeof(Speed));
 }
 
 // Control game from replay inputs
@@ -556,71 +593,35 @@ void _PlayState::GetInputFromReplay() {
 	if(!ReplayInputs)
 		return;
 
-	char Buffer[1024];
-	std::fstream &ReplayFile = InputReplay->GetFile();
 	while(!InputReplay->ReplayStopped() && Timer >= NextEvent.Timestamp) {
 		//printf("Processing header packet: type=%d time=%f\n", NextEvent.Type, NextEvent.Timestamp);
 
-		switch(NextEvent.Type) {
-			case _Replay::PACKET_MOVEMENT: {
-				int16_t ObjectCount;
-				ReplayFile.read((char *)&ObjectCount, sizeof(ObjectCount));
-				for(int i = 0; i < ObjectCount; i++)
-					ReplayFile.read(Buffer, 2 + 4 * 3 + 4 * 3);
-			} break;
-			case _Replay::PACKET_CREATE: {
-				ReplayFile.read(Buffer, 2 + 2);
-				int PositionType = ReplayFile.get();
-				if(PositionType == 1)
-					ReplayFile.read(Buffer, 4 * 4);
-				else
-					ReplayFile.read(Buffer, 4 * 3);
-				ReplayFile.read(Buffer, 4 * 3);
-			} break;
-			case _Replay::PACKET_DELETE:
-				ReplayFile.read(Buffer, 2);
-			break;
-			case _Replay::PACKET_CAMERA:
-				ReplayFile.read(Buffer, 4 * 3 + 4 * 3);
-			break;
-			case _Replay::PACKET_ORBDEACTIVATE:
-				ReplayFile.read(Buffer, 2 + 4);
-			break;
-			case _Replay::PACKET_INPUT: {
-
-				// Read replay
-				core::vector3df Push(0.0f, 0.0f, 0.0f);
-				bool Jumping;
-				float Yaw;
-				float Pitch;
-				ReplayFile.read((char *)&Push.X, sizeof(Push.X));
-				ReplayFile.read((char *)&Push.Z, sizeof(Push.Z));
-				ReplayFile.read((char *)&Yaw, sizeof(Yaw));
-				ReplayFile.read((char *)&Pitch, sizeof(Pitch));
-				ReplayFile.read((char *)&Jumping, sizeof(Jumping));
-
-				// Inject input
-				Camera->SetYaw(Yaw);
-				Camera->SetPitch(Pitch);
-				Player->HandlePush(Push);
-				if(Jumping)
-					Player->Jump();
+		// Only inputs are needed, other events are skipped by the reader
+		if(NextEvent.Type == _Replay::PACKET_INPUT) {
+			_ReplayInputEvent Event;
+			NextEvent.GetInput(Event);
+			core::vector3df Push(Event.PushX, 0.0f, Event.PushZ);
 
-				//printf("t=%f x=%f z=%f yaw=%f pitch=%f jumping=%d\n", NextEvent.Timestamp, Push.X, Push.Z, Yaw, Pitch, Jumping);
-			}
-			break;
-			case _Replay::PACKET_PLAYERSPEED:
-				ReplayFile.read(Buffer, 4);
-			break;
-			default:
-			break;
+			// Inject input
+			Camera->SetYaw(Event.Yaw);
+			Camera->SetPitch(Event.Pitch);
+			Player->HandlePush(Push);
+			if(Event.Jumped)
+				Player->Jump();
+
+			//printf("t=%f x=%f z=%f yaw=%f pitch=%f jumping=%d\n", NextEvent.Timestamp, Event.PushX, Event.PushZ, Event.Yaw, Event.Pitch, Event.Jumped);
 		}
 
 		InputReplay->ReadEvent(NextEvent);
 	}
 
-	if(InputReplay->ReplayStopped()) {
+	// The last recorded step may have no events, so run until the finish time
+	if(InputReplay->ReplayStopped() && Timer >= InputReplay->GetFinishTime() - PHYSICS_TIMESTEP * 0.5f) {
 		Log.Write("Validation stopped %fs", PlayState.Timer);
+		if(Framework.IsHeadless()) {
+			Validator.ReportResult(_ValidateResult::STATUS_STOPPED, Timer, InputReplay->GetFinishTime(), InputReplay->GetWon());
+			return;
+		}
 
 		Menu.InitPause();
 	}
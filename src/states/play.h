@@ -62,6 +62,7 @@ class _PlayState : public _State {
 
 		_Camera *GetCamera() { return Camera; }
 		float GetTimer() { return Timer; }
+		void SetTimer(float Value) { Timer = Value; }
 
 	private:
 
@@ -89,7 +90,7 @@ class _PlayState : public _State {
 		std::string InputReplayFilename;
 		bool ReplayInputs;
 		_Replay *InputReplay;
-		_ReplayEvent NextEvent;
+		_ReplayEventView NextEvent;
 };
 
 extern _PlayState PlayState;
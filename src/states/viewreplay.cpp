@@ -28,16 +28,22 @@
 #include <audio.h>
 #include <framework.h>
 #include <interface.h>
+#include <log.h>
 #include <objects/orb.h>
 #include <objects/player.h>
 #include <objects/template.h>
 #include <font/CGUITTFont.h>
 #include <states/play.h>
 #include <menu.h>
+#include <profiler.h>
+#include <save.h>
 #include <states/null.h>
 #include <ISceneManager.h>
+#include <IGUIScrollBar.h>
+#include <cstring>
 
 const float REPLAY_TIME_INCREMENT = 0.1f;
+const float TIMELINE_SCALE = 100.0f;
 
 using namespace irr;
 
@@ -50,6 +56,7 @@ int _ViewReplayState::Init() {
 	Layout->drop();
 	Camera = nullptr;
 	Player = nullptr;
+	Timeline = nullptr;
 	FreeCamera = false;
 
 	// Set up state
@@ -121,6 +128,14 @@ bool _ViewReplayState::HandleKeyPress(int Key) {
 			NullState.State = _Menu::STATE_REPLAYS;
 			Framework.ChangeState(&NullState);
 		break;
+		case KEY_F6:
+			Profiler.ShowOverlay = !Profiler.ShowOverlay;
+			if(Profiler.ShowOverlay)
+				Profiler.SetEnabled(true);
+		break;
+		case KEY_F7:
+			Profiler.ExportTrace(Save.SavePath + "profile.json");
+		break;
 		case KEY_F11:
 			ShowHUD = !ShowHUD;
 		break;
@@ -133,6 +148,9 @@ bool _ViewReplayState::HandleKeyPress(int Key) {
 		case KEY_RIGHT:
 			Skip(1.0f);
 		break;
+		case KEY_LEFT:
+			Skip(-1.0f);
+		break;
 		case KEY_KEY_1:
 			Framework.SetTimeScale(0.5);
 		break;
@@ -258,6 +276,10 @@ void _ViewReplayState::HandleGUI(irr::gui::EGUI_EVENT_TYPE EventType, gui::IGUIE
 				break;
 			}
 		break;
+		case gui::EGET_SCROLL_BAR_CHANGED:
+			if(Element == Timeline)
+				Seek(Timeline->getPos() / TIMELINE_SCALE);
+		break;
 		default:
 		break;
 	}
@@ -268,40 +290,42 @@ void _ViewReplayState::Update(float FrameTime) {
 
 	// Update the replay
 	Timer += FrameTime;
+	ProcessEvents();
+
+	ObjectManager.UpdateReplay(FrameTime);
+	Interface.Update(FrameTime);
+
+	// Update timeline unless the user is dragging it
+	if(Timeline && irrGUI->getFocus() != Timeline)
+		Timeline->setPos((int)(Timer * TIMELINE_SCALE));
+}
+
+// Process all events up to the current time
+void _ViewReplayState::ProcessEvents() {
 	while(!Replay.ReplayStopped() && Timer >= NextEvent.Timestamp) {
 		//printf("Processing header packet: type=%d time=%f\n", NextEvent.Type, NextEvent.Timestamp);
 
 		switch(NextEvent.Type) {
 			case _Replay::PACKET_MOVEMENT:
-				ObjectManager.UpdateFromReplay();
+				ObjectManager.UpdateFromReplay(NextEvent);
 			break;
 			case _Replay::PACKET_CREATE: {
-				_ObjectSpawn Spawn;
-
-				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-
-				// Get template
-				int16_t TemplateID;
-				ReplayFile.read((char *)&TemplateID, sizeof(TemplateID));
-				Spawn.Template = Level.GetTemplateFromID(TemplateID);
-
-				// Get object id
-				int16_t ObjectID;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
+				_ReplayCreateEvent Event;
+				NextEvent.GetCreate(Event);
 
-				// Get orientation
-				int PositionType = ReplayFile.get();
-				if(PositionType == 1)
-					ReplayFile.read((char *)&Spawn.Plane, sizeof(float) * 4);
+				// Get spawn orientation
+				_ObjectSpawn Spawn;
+				Spawn.Template = Level.GetTemplateFromID(Event.TemplateID);
+				if(Event.PositionType == 1)
+					memcpy(&Spawn.Plane, Event.Plane, sizeof(float) * 4);
 				else
-					ReplayFile.read((char *)&Spawn.Position, sizeof(float) * 3);
-				ReplayFile.read((char *)&Spawn.Rotation, sizeof(float) * 3);
+					memcpy(&Spawn.Position, Event.Position, sizeof(float) * 3);
+				memcpy(&Spawn.Rotation, Event.Rotation, sizeof(float) * 3);
 
 				// Create spawn object
 				if(Spawn.Template != nullptr) {
 					_Object *NewObject = Level.CreateObject(Spawn);
-					NewObject->SetID(ObjectID);
+					ObjectManager.SetObjectID(NewObject, Event.ObjectID);
 
 					// Get player
 					if(NewObject->GetType() == _Object::PLAYER)
@@ -314,22 +338,15 @@ void _ViewReplayState::Update(float FrameTime) {
 			break;
 			case _Replay::PACKET_DELETE: {
 
-				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				int16_t ObjectID;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-
 				// Delete object
-				ObjectManager.DeleteObjectByID(ObjectID);
+				ObjectManager.DeleteObjectByID(NextEvent.GetDelete());
 			}
 			break;
 			case _Replay::PACKET_CAMERA: {
-
-				// Read replay
-				core::vector3df Position, LookAt;
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Position.X, sizeof(float) * 3);
-				ReplayFile.read((char *)&LookAt.X, sizeof(float) * 3);
+				_ReplayCameraEvent Event;
+				NextEvent.GetCamera(Event);
+				core::vector3df Position(Event.Position[0], Event.Position[1], Event.Position[2]);
+				core::vector3df LookAt(Event.Target[0], Event.Target[1], Event.Target[2]);
 
 				// Update audio
 				Audio.SetPosition(LookAt.X, LookAt.Y, LookAt.Z);
@@ -350,50 +367,24 @@ void _ViewReplayState::Update(float FrameTime) {
 			}
 			break;
 			case _Replay::PACKET_ORBDEACTIVATE: {
-
-				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				int16_t ObjectID;
-				float Length;
-				ReplayFile.read((char *)&ObjectID, sizeof(ObjectID));
-				ReplayFile.read((char *)&Length, sizeof(Length));
+				_ReplayOrbDeactivateEvent Event;
+				NextEvent.GetOrbDeactivate(Event);
 
 				// Deactivate orb
-				_Orb *Orb = static_cast<_Orb *>(ObjectManager.GetObjectByID(ObjectID));
-				Orb->StartDeactivation("", Length);
+				_Object *Object = ObjectManager.GetObjectByID(Event.ObjectID);
+				if(Object && Object->GetType() == _Object::ORB)
+					static_cast<_Orb *>(Object)->StartDeactivation("", Event.Length);
 
 				// Update number of lights
 				Graphics.SetLightCount();
 			}
 			break;
-			case _Replay::PACKET_INPUT: {
-				core::vector3df Push(0.0f, 0.0f, 0.0f);
-				bool Jumping;
-				float Yaw;
-				float Pitch;
-
-				// Read replay
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Push.X, sizeof(Push.X));
-				ReplayFile.read((char *)&Push.Z, sizeof(Push.Z));
-				ReplayFile.read((char *)&Yaw, sizeof(Yaw));
-				ReplayFile.read((char *)&Pitch, sizeof(Pitch));
-				ReplayFile.read((char *)&Jumping, sizeof(Jumping));
-
-				//printf("x=%f z=%f yaw=%f pitch=%f jumping=%d\n", Push.X, Push.Z, Yaw, Pitch, Jumping);
-			}
-			break;
 			case _Replay::PACKET_PLAYERSPEED: {
 
-				// Read replay
-				float Speed;
-				std::fstream &ReplayFile = Replay.GetFile();
-				ReplayFile.read((char *)&Speed, sizeof(Speed));
-
 				// Update player audio
 				if(Player) {
 					core::vector3df Position = Player->GetNode()->getPosition();
-					Player->UpdateAudio(glm::vec3(Position.X, Position.Y, Position.Z), Speed);
+					Player->UpdateAudio(glm::vec3(Position.X, Position.Y, Position.Z), NextEvent.GetPlayerSpeed());
 				}
 			}
 			break;
@@ -403,9 +394,48 @@ void _ViewReplayState::Update(float FrameTime) {
 
 		Replay.ReadEvent(NextEvent);
 	}
+}
 
-	ObjectManager.UpdateReplay(FrameTime);
-	Interface.Update(FrameTime);
+// Jump to a time in the replay starting from the closest keyframe
+void _ViewReplayState::Seek(float Time) {
+	if(Time < 0.0f)
+		Time = 0.0f;
+	else if(Time > Replay.GetFinishTime())
+		Time = Replay.GetFinishTime();
+
+	// Rebuild world unless playing forward from the current time is closer
+	const _ReplayKeyframe *Keyframe = Replay.FindKeyframe(Time);
+	if(Time < Timer || (Keyframe && Keyframe->Timestamp > Timer)) {
+		if(Keyframe) {
+			Replay.SeekToKeyframe(*Keyframe);
+			Replay.ReadEvent(NextEvent);
+			if(ObjectManager.LoadKeyframe(NextEvent))
+				Timer = Keyframe->Timestamp;
+			else {
+				Log.Write("Invalid replay keyframe at %fs", Keyframe->Timestamp);
+				Keyframe = nullptr;
+			}
+		}
+
+		// Replay from the start
+		if(!Keyframe) {
+			ObjectManager.ClearObjects();
+			Replay.SeekToStart();
+			Timer = 0.0f;
+		}
+
+		Player = static_cast<_Player *>(ObjectManager.GetObjectByType(_Object::PLAYER));
+		Graphics.SetLightCount();
+		Replay.ReadEvent(NextEvent);
+	}
+
+	// Play events up to the new time
+	float TimeStep = Framework.GetTimeStep();
+	while(Timer + TimeStep <= Time && !Replay.ReplayStopped()) {
+		Timer += TimeStep;
+		ProcessEvents();
+		ObjectManager.UpdateReplay(TimeStep);
+	}
 }
 
 // Draws the current state
@@ -449,7 +479,11 @@ void _ViewReplayState::Draw() {
 	if(Config.ShowFPS)
 		Interface.RenderFPS(10 * Interface.GetUIScale(), irrDriver->getScreenSize().Height - 50 * Interface.GetUIScale());
 
+	// Draw profiler
+	Interface.RenderProfiler(10 * Interface.GetUIScale(), 100 * Interface.GetUIScale());
+
 	// Draw buttons
+	_ProfileScope Scope(_Profiler::GUI_DRAW);
 	irrGUI->drawAll();
 }
 
@@ -511,6 +545,15 @@ void _ViewReplayState::SetupGUI() {
 	ButtonDecrease->setUseAlphaChannel(true);
 	ButtonDecrease->setDrawBorder(false);
 	ButtonDecrease->setScaleImage(true);
+
+	// Timeline
+	int Left = 10 * Interface.GetUIScale();
+	int ScreenWidth = irrDriver->getScreenSize().Width;
+	int ScreenHeight = irrDriver->getScreenSize().Height;
+	Timeline = irrGUI->addScrollBar(true, core::recti(Left, ScreenHeight - 40 * Interface.GetUIScale(), ScreenWidth - Left, ScreenHeight - 16 * Interface.GetUIScale()), Layout, MAIN_TIMELINE);
+	Timeline->setMax((int)(Replay.GetFinishTime() * TIMELINE_SCALE));
+	Timeline->setSmallStep((int)TIMELINE_SCALE);
+	Timeline->setLargeStep((int)(REPLAY_KEYFRAME_INTERVAL * TIMELINE_SCALE));
 }
 
 // Change replay speed
@@ -539,9 +582,9 @@ void _ViewReplayState::Pause() {
 	}
 }
 
-// Skip ahead
+// Skip ahead or back
 void _ViewReplayState::Skip(float Amount) {
-	Framework.UpdateTimeStepAccumulator(Amount);
+	Seek(Timer + Amount);
 }
 
 // Get how much time to adjust replay speed
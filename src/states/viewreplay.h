@@ -27,6 +27,12 @@ class _Object;
 class _Player;
 class _Camera;
 
+namespace irr {
+	namespace gui {
+		class IGUIScrollBar;
+	}
+}
+
 // Classes
 class _ViewReplayState : public _State {
 
@@ -39,6 +45,7 @@ class _ViewReplayState : public _State {
 			MAIN_INCREASE,
 			MAIN_DECREASE,
 			MAIN_EXIT,
+			MAIN_TIMELINE,
 		};
 
 		_ViewReplayState() : ShowHUD(true) {}
@@ -64,6 +71,8 @@ class _ViewReplayState : public _State {
 		void ChangeReplaySpeed(float Amount);
 		void Pause();
 		void Skip(float Amount);
+		void Seek(float Time);
+		void ProcessEvents();
 		float GetTimeIncrement();
 
 		// States
@@ -77,7 +86,7 @@ class _ViewReplayState : public _State {
 		_Player *Player;
 
 		// Replay information
-		_ReplayEvent NextEvent;
+		_ReplayEventView NextEvent;
 		float PauseSpeed;
 
 		// Events
@@ -85,6 +94,7 @@ class _ViewReplayState : public _State {
 
 		// GUI
 		irr::gui::IGUIElement *Layout;
+		irr::gui::IGUIScrollBar *Timeline;
 };
 
 extern _ViewReplayState ViewReplayState;
@@ -0,0 +1,294 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <transformbuffer.h>
+#include <objects/object.h>
+#include <objectmanager.h>
+#include <ode/collision.h>
+#include <ode/objects.h>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// Number of objects interpolated at once
+static const size_t TRANSFORM_LANES = 4;
+
+// Marks a body's object as stepped by ODE
+static void BodyMoved(dBodyID Body) {
+	_Object *Object = (_Object *)dBodyGetData(Body);
+	ObjectManager.GetTransforms().SetStepped(Object->GetTransformIndex());
+}
+
+// Constructor
+_TransformBuffer::_TransformBuffer() :
+	ActiveCount(0),
+	Capacity(0) {
+}
+
+// Add an object with a body and scene node, starting from its current transform
+void _TransformBuffer::Add(_Object *Object) {
+	size_t Index = Objects.size();
+	if(Index == Capacity)
+		Reserve(Capacity ? Capacity * 2 : 64);
+
+	Objects.push_back(Object);
+	Object->SetTransformIndex((int)Index);
+	Gather(Index);
+	for(int i = 0; i < COMPONENT_COUNT; i++)
+		Last[i * Capacity + Index] = Current[i * Capacity + Index];
+
+	// New objects start active and go to sleep after a step without moving
+	Stepped[Index] = 0;
+	dBodySetMovedCallback(Object->GetBody(), BodyMoved);
+	Activate(Index);
+}
+
+// Remove an object by moving the last object into its slot
+void _TransformBuffer::Remove(_Object *Object) {
+	int Index = Object->GetTransformIndex();
+	if(Index < 0)
+		return;
+
+	// Keep active objects together
+	size_t RemoveIndex = Index;
+	if(RemoveIndex < ActiveCount) {
+		ActiveCount--;
+		Swap(RemoveIndex, ActiveCount);
+		RemoveIndex = ActiveCount;
+	}
+
+	Swap(RemoveIndex, Objects.size() - 1);
+	Objects.pop_back();
+	dBodySetMovedCallback(Object->GetBody(), nullptr);
+	Object->SetTransformIndex(-1);
+}
+
+// Remove all objects
+void _TransformBuffer::Clear() {
+	for(auto &Object : Objects) {
+		dBodySetMovedCallback(Object->GetBody(), nullptr);
+		Object->SetTransformIndex(-1);
+	}
+
+	Objects.clear();
+	ActiveCount = 0;
+}
+
+// Current transforms become the ones to interpolate from
+void _TransformBuffer::BeginStep() {
+	for(int i = 0; i < COMPONENT_COUNT; i++)
+		memcpy(&Last[i * Capacity], &Current[i * Capacity], ActiveCount * sizeof(float));
+}
+
+// Copy transforms from the physics step, flag objects that moved and update the active set
+void _TransformBuffer::EndStep() {
+
+	// Wake objects that ODE stepped
+	for(size_t i = ActiveCount; i < Objects.size(); i++) {
+		if(Stepped[i])
+			Activate(i);
+	}
+	memset(Stepped.data(), 0, Objects.size());
+
+	for(size_t i = 0; i < ActiveCount; ) {
+		Gather(i);
+
+		bool Moved = false;
+		for(int j = 0; j < COMPONENT_COUNT; j++)
+			Moved |= Last[j * Capacity + i] != Current[j * Capacity + i];
+
+		if(Moved) {
+			Objects[i]->SetMoved();
+			i++;
+		}
+		else if(!dBodyIsEnabled(Objects[i]->GetBody())) {
+
+			// Leave the node at its final transform and stop updating it
+			const float *C = Current.data();
+			glm::vec3 Position(C[POSITION_X * Capacity + i], C[POSITION_Y * Capacity + i], C[POSITION_Z * Capacity + i]);
+			glm::quat Rotation(C[ROTATION_W * Capacity + i], C[ROTATION_X * Capacity + i], C[ROTATION_Y * Capacity + i], C[ROTATION_Z * Capacity + i]);
+			Objects[i]->SetDrawTransform(Position, Rotation);
+
+			ActiveCount--;
+			Swap(i, ActiveCount);
+		}
+		else
+			i++;
+	}
+}
+
+// Blend positions linearly and rotations with a normalized lerp along the shortest path
+void _TransformBuffer::Interpolate(float BlendFactor) {
+	size_t Count = ActiveCount;
+	const float *L = Last.data();
+	const float *C = Current.data();
+	float *D = Draw.data();
+
+#ifdef __SSE__
+	__m128 Blend = _mm_set1_ps(BlendFactor);
+	__m128 One = _mm_set1_ps(1.0f);
+	__m128 SignMask = _mm_set1_ps(-0.0f);
+	for(size_t i = 0; i < Count; i += TRANSFORM_LANES) {
+
+		// Positions
+		for(int j = POSITION_X; j <= POSITION_Z; j++) {
+			size_t Offset = j * Capacity + i;
+			__m128 From = _mm_loadu_ps(L + Offset);
+			__m128 To = _mm_loadu_ps(C + Offset);
+			_mm_storeu_ps(D + Offset, _mm_add_ps(From, _mm_mul_ps(_mm_sub_ps(To, From), Blend)));
+		}
+
+		// Flip the target rotation when it's in the opposite hemisphere
+		__m128 From[4], To[4];
+		__m128 Dot = _mm_setzero_ps();
+		for(int j = 0; j < 4; j++) {
+			size_t Offset = (ROTATION_W + j) * Capacity + i;
+			From[j] = _mm_loadu_ps(L + Offset);
+			To[j] = _mm_loadu_ps(C + Offset);
+			Dot = _mm_add_ps(Dot, _mm_mul_ps(From[j], To[j]));
+		}
+		__m128 Sign = _mm_and_ps(Dot, SignMask);
+
+		// Blend and normalize rotations
+		__m128 Rotation[4];
+		__m128 LengthSquared = _mm_setzero_ps();
+		for(int j = 0; j < 4; j++) {
+			To[j] = _mm_xor_ps(To[j], Sign);
+			Rotation[j] = _mm_add_ps(From[j], _mm_mul_ps(_mm_sub_ps(To[j], From[j]), Blend));
+			LengthSquared = _mm_add_ps(LengthSquared, _mm_mul_ps(Rotation[j], Rotation[j]));
+		}
+		__m128 Scale = _mm_div_ps(One, _mm_sqrt_ps(LengthSquared));
+		for(int j = 0; j < 4; j++)
+			_mm_storeu_ps(D + (ROTATION_W + j) * Capacity + i, _mm_mul_ps(Rotation[j], Scale));
+	}
+#else
+	for(size_t i = 0; i < Count; i++) {
+		for(int j = POSITION_X; j <= POSITION_Z; j++) {
+			size_t Offset = j * Capacity + i;
+			D[Offset] = L[Offset] + (C[Offset] - L[Offset]) * BlendFactor;
+		}
+
+		float Dot = 0.0f;
+		for(int j = ROTATION_W; j <= ROTATION_Z; j++)
+			Dot += L[j * Capacity + i] * C[j * Capacity + i];
+		float Sign = Dot < 0.0f ? -1.0f : 1.0f;
+
+		float LengthSquared = 0.0f;
+		for(int j = ROTATION_W; j <= ROTATION_Z; j++) {
+			size_t Offset = j * Capacity + i;
+			D[Offset] = L[Offset] + (C[Offset] * Sign - L[Offset]) * BlendFactor;
+			LengthSquared += D[Offset] * D[Offset];
+		}
+
+		float Scale = 1.0f / std::sqrt(LengthSquared);
+		for(int j = ROTATION_W; j <= ROTATION_Z; j++)
+			D[j * Capacity + i] *= Scale;
+	}
+#endif
+}
+
+// Write interpolated transforms to scene nodes
+void _TransformBuffer::Scatter() {
+	const float *D = Draw.data();
+	for(size_t i = 0; i < ActiveCount; i++) {
+		glm::vec3 Position(D[POSITION_X * Capacity + i], D[POSITION_Y * Capacity + i], D[POSITION_Z * Capacity + i]);
+		glm::quat Rotation(D[ROTATION_W * Capacity + i], D[ROTATION_X * Capacity + i], D[ROTATION_Y * Capacity + i], D[ROTATION_Z * Capacity + i]);
+		Objects[i]->SetDrawTransform(Position, Rotation);
+	}
+}
+
+// Set position of an object, waking it so its node is updated
+void _TransformBuffer::SetPosition(_Object *Object, const glm::vec3 &Position) {
+	Activate(Object->GetTransformIndex());
+	size_t Index = Object->GetTransformIndex();
+	for(int i = 0; i < 3; i++) {
+		Last[(POSITION_X + i) * Capacity + Index] = Position[i];
+		Current[(POSITION_X + i) * Capacity + Index] = Position[i];
+	}
+}
+
+// Set rotation of an object, waking it so its node is updated
+void _TransformBuffer::SetRotation(_Object *Object, const glm::quat &Rotation) {
+	Activate(Object->GetTransformIndex());
+	size_t Index = Object->GetTransformIndex();
+	float Values[4] = { Rotation.w, Rotation.x, Rotation.y, Rotation.z };
+	for(int i = 0; i < 4; i++) {
+		Last[(ROTATION_W + i) * Capacity + Index] = Values[i];
+		Current[(ROTATION_W + i) * Capacity + Index] = Values[i];
+	}
+}
+
+// Copy the transform of an object's geometry into the current arrays
+void _TransformBuffer::Gather(size_t Index) {
+	dGeomID Geometry = Objects[Index]->GetGeometry();
+	const dReal *Position = dGeomGetPosition(Geometry);
+	dQuaternion Rotation;
+	dGeomGetQuaternion(Geometry, Rotation);
+
+	for(int i = 0; i < 3; i++)
+		Current[(POSITION_X + i) * Capacity + Index] = (float)Position[i];
+	for(int i = 0; i < 4; i++)
+		Current[(ROTATION_W + i) * Capacity + Index] = (float)Rotation[i];
+}
+
+// Move an object into the active set
+void _TransformBuffer::Activate(size_t Index) {
+	if(Index < ActiveCount)
+		return;
+
+	Swap(Index, ActiveCount);
+	ActiveCount++;
+}
+
+// Swap the slots of two objects
+void _TransformBuffer::Swap(size_t Index, size_t OtherIndex) {
+	if(Index == OtherIndex)
+		return;
+
+	std::swap(Objects[Index], Objects[OtherIndex]);
+	std::swap(Stepped[Index], Stepped[OtherIndex]);
+	Objects[Index]->SetTransformIndex((int)Index);
+	Objects[OtherIndex]->SetTransformIndex((int)OtherIndex);
+	for(int i = 0; i < COMPONENT_COUNT; i++) {
+		std::swap(Last[i * Capacity + Index], Last[i * Capacity + OtherIndex]);
+		std::swap(Current[i * Capacity + Index], Current[i * Capacity + OtherIndex]);
+	}
+}
+
+// Grow the component arrays, keeping padding lanes at the identity transform
+void _TransformBuffer::Reserve(size_t Count) {
+	Count = (Count + TRANSFORM_LANES - 1) / TRANSFORM_LANES * TRANSFORM_LANES;
+
+	std::vector<float> *Arrays[3] = { &Last, &Current, &Draw };
+	for(auto &Array : Arrays) {
+		std::vector<float> Resized(COMPONENT_COUNT * Count, 0.0f);
+		for(size_t i = 0; i < Count; i++)
+			Resized[ROTATION_W * Count + i] = 1.0f;
+
+		for(int i = 0; i < COMPONENT_COUNT; i++) {
+			for(size_t j = 0; j < Objects.size(); j++)
+				Resized[i * Count + j] = (*Array)[i * Capacity + j];
+		}
+		Array->swap(Resized);
+	}
+	Stepped.resize(Count, 0);
+
+	Capacity = Count;
+}
@@ -0,0 +1,90 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+// Forward Declarations
+class _Object;
+
+// Packed transforms of moving objects, stored as one array per component so interpolation runs four objects at a time.
+// Objects with enabled bodies are kept at the front, sleeping objects after them are skipped until ODE steps them again.
+class _TransformBuffer {
+
+	public:
+
+		enum ComponentType {
+			POSITION_X,
+			POSITION_Y,
+			POSITION_Z,
+			ROTATION_W,
+			ROTATION_X,
+			ROTATION_Y,
+			ROTATION_Z,
+			COMPONENT_COUNT,
+		};
+
+		_TransformBuffer();
+
+		void Add(_Object *Object);
+		void Remove(_Object *Object);
+		void Clear();
+
+		// Updates
+		void BeginStep();
+		void EndStep();
+		void Interpolate(float BlendFactor);
+		void Scatter();
+
+		// Teleport an object so it isn't interpolated from its old transform
+		void SetPosition(_Object *Object, const glm::vec3 &Position);
+		void SetRotation(_Object *Object, const glm::quat &Rotation);
+
+		// Called from the physics step, possibly on a worker thread
+		void SetStepped(int Index) { Stepped[Index] = 1; }
+
+		size_t GetCount() const { return Objects.size(); }
+		size_t GetActiveCount() const { return ActiveCount; }
+		_Object *GetObject(size_t Index) const { return Objects[Index]; }
+		const float *GetDraw(int Component) const { return &Draw[Component * Capacity]; }
+
+	private:
+
+		void Gather(size_t Index);
+		void Activate(size_t Index);
+		void Swap(size_t Index, size_t OtherIndex);
+		void Reserve(size_t Count);
+
+		// Objects in buffer order, active objects first
+		std::vector<_Object *> Objects;
+		size_t ActiveCount;
+
+		// Flags set for bodies that moved during the physics step
+		std::vector<uint8_t> Stepped;
+
+		// Component arrays, each padded to a multiple of four
+		std::vector<float> Last;
+		std::vector<float> Current;
+		std::vector<float> Draw;
+		size_t Capacity;
+
+};
@@ -0,0 +1,349 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#include <validator.h>
+#include <framework.h>
+#include <config.h>
+#include <physics.h>
+#include <irrlicht.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <signal.h>
+	#include <spawn.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+	extern char **environ;
+#endif
+
+using namespace irr;
+
+// Line prefix used by workers to report results back to the batch process
+static const char *VALIDATE_RESULT_PREFIX = "@validate";
+
+// Allowed difference between the recorded and validated finish time, covers float rounding only
+static const float VALIDATE_TIME_TOLERANCE = PHYSICS_TIMESTEP * 0.5f;
+
+// Serializes pipe creation and process spawning so workers don't inherit each other's pipes
+static std::mutex SpawnMutex;
+
+_Validator Validator;
+
+// Get the path of the running executable, falls back to the name it was started with
+static std::string GetExecutablePath(const std::string &Fallback) {
+#ifdef _WIN32
+	char Path[MAX_PATH];
+	DWORD Length = GetModuleFileNameA(nullptr, Path, sizeof(Path));
+	if(Length > 0 && Length < sizeof(Path))
+		return std::string(Path, Length);
+#else
+	char Path[4096];
+	ssize_t Length = readlink("/proc/self/exe", Path, sizeof(Path));
+	if(Length > 0 && Length < (ssize_t)sizeof(Path))
+		return std::string(Path, (size_t)Length);
+#endif
+
+	return Fallback;
+}
+
+// Run a process without a shell and capture its standard output, the process is killed after Timeout seconds
+static bool RunProcess(const std::vector<std::string> &Arguments, float Timeout, std::string &Output, bool &TimedOut) {
+	Output.clear();
+	TimedOut = false;
+	auto Deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(Timeout));
+
+#ifdef _WIN32
+
+	// Build command line, file names can't contain quotes on windows
+	std::string CommandLine;
+	for(const auto &Argument : Arguments) {
+		if(!CommandLine.empty())
+			CommandLine += ' ';
+		CommandLine += "\"" + Argument + "\"";
+	}
+
+	SECURITY_ATTRIBUTES Attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE ReadHandle, WriteHandle;
+	PROCESS_INFORMATION ProcessInfo;
+	{
+		std::lock_guard<std::mutex> Lock(SpawnMutex);
+		if(!CreatePipe(&ReadHandle, &WriteHandle, &Attributes, 0))
+			return false;
+		SetHandleInformation(ReadHandle, HANDLE_FLAG_INHERIT, 0);
+
+		STARTUPINFOA StartupInfo = { sizeof(STARTUPINFOA) };
+		StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+		StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+		StartupInfo.hStdOutput = WriteHandle;
+		StartupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+		BOOL Created = CreateProcessA(Arguments[0].c_str(), &CommandLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &StartupInfo, &ProcessInfo);
+		CloseHandle(WriteHandle);
+		if(!Created) {
+			CloseHandle(ReadHandle);
+			return false;
+		}
+	}
+
+	// Read until the child closes its output or runs out of time
+	char Buffer[4096];
+	DWORD BytesRead, BytesAvailable;
+	while(PeekNamedPipe(ReadHandle, nullptr, 0, nullptr, &BytesAvailable, nullptr)) {
+		if(BytesAvailable) {
+			if(!ReadFile(ReadHandle, Buffer, std::min((DWORD)sizeof(Buffer), BytesAvailable), &BytesRead, nullptr) || BytesRead == 0)
+				break;
+
+			Output.append(Buffer, BytesRead);
+			continue;
+		}
+
+		if(std::chrono::steady_clock::now() >= Deadline) {
+			TerminateProcess(ProcessInfo.hProcess, 1);
+			TimedOut = true;
+			break;
+		}
+
+		Sleep(10);
+	}
+
+	CloseHandle(ReadHandle);
+	WaitForSingleObject(ProcessInfo.hProcess, INFINITE);
+	CloseHandle(ProcessInfo.hThread);
+	CloseHandle(ProcessInfo.hProcess);
+#else
+
+	std::vector<char *> Argv;
+	for(const auto &Argument : Arguments)
+		Argv.push_back(const_cast<char *>(Argument.c_str()));
+	Argv.push_back(nullptr);
+
+	int Pipe[2];
+	pid_t ProcessID;
+	{
+		std::lock_guard<std::mutex> Lock(SpawnMutex);
+		if(pipe(Pipe) != 0)
+			return false;
+		fcntl(Pipe[0], F_SETFD, FD_CLOEXEC);
+		fcntl(Pipe[1], F_SETFD, FD_CLOEXEC);
+
+		// Send the child's stdout to the pipe, search PATH in case the executable couldn't be resolved
+		posix_spawn_file_actions_t Actions;
+		posix_spawn_file_actions_init(&Actions);
+		posix_spawn_file_actions_adddup2(&Actions, Pipe[1], STDOUT_FILENO);
+		int Error = posix_spawnp(&ProcessID, Argv[0], &Actions, nullptr, Argv.data(), environ);
+		posix_spawn_file_actions_destroy(&Actions);
+		close(Pipe[1]);
+		if(Error) {
+			close(Pipe[0]);
+			return false;
+		}
+	}
+
+	// Read until the child closes its output or runs out of time
+	char Buffer[4096];
+	while(true) {
+		auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - std::chrono::steady_clock::now()).count();
+		if(Remaining <= 0) {
+			kill(ProcessID, SIGKILL);
+			TimedOut = true;
+			break;
+		}
+
+		struct pollfd PollInfo = { Pipe[0], POLLIN, 0 };
+		int Ready = poll(&PollInfo, 1, (int)std::min<long long>(Remaining, 1000));
+		if(Ready == 0 || (Ready < 0 && errno == EINTR))
+			continue;
+		else if(Ready < 0)
+			break;
+
+		ssize_t BytesRead = read(Pipe[0], Buffer, sizeof(Buffer));
+		if(BytesRead == 0)
+			break;
+		else if(BytesRead < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		Output.append(Buffer, (size_t)BytesRead);
+	}
+
+	close(Pipe[0]);
+	int Status;
+	while(waitpid(ProcessID, &Status, 0) == -1 && errno == EINTR);
+#endif
+
+	return true;
+}
+
+// Validate all replays in a directory using a pool of headless processes
+int _Validator::RunBatch(const std::string &Executable, const std::string &Path, int Jobs, float Timeout) {
+
+	// Get list of replays
+	IrrlichtDevice *Device = createDevice(video::EDT_NULL);
+	if(!Device)
+		return 1;
+
+	io::IFileSystem *FileSystem = Device->getFileSystem();
+	std::string OldWorkingDirectory(FileSystem->getWorkingDirectory().c_str());
+	if(!FileSystem->changeWorkingDirectoryTo(Path.c_str())) {
+		std::cout << "Cannot open directory: " << Path << std::endl;
+		Device->drop();
+		return 1;
+	}
+
+	std::vector<_ValidateResult> Results;
+	io::IFileList *FileList = FileSystem->createFileList();
+	for(uint32_t i = 0; i < FileList->getFileCount(); i++) {
+		if(!FileList->isDirectory(i) && FileList->getFileName(i).find(".replay") != -1) {
+			_ValidateResult Result;
+			Result.File = FileList->getFullFileName(i).c_str();
+			Results.push_back(Result);
+		}
+	}
+	FileList->drop();
+
+	FileSystem->changeWorkingDirectoryTo(OldWorkingDirectory.c_str());
+	Device->drop();
+
+	// Sort by file name so reports are stable
+	std::sort(Results.begin(), Results.end(), [](const _ValidateResult &Left, const _ValidateResult &Right) {
+		return Left.File < Right.File;
+	});
+
+	// Get worker count
+	if(Jobs <= 0)
+		Jobs = std::max(1u, std::thread::hardware_concurrency());
+	Jobs = std::min(Jobs, (int)Results.size());
+
+	std::cout << "Validating " << Results.size() << " replays with " << Jobs << " jobs" << std::endl;
+
+	// Workers run the same binary, which may have been found through PATH
+	std::string WorkerPath = GetExecutablePath(Executable);
+
+	// Start workers
+	auto StartTime = std::chrono::high_resolution_clock::now();
+	std::atomic<size_t> NextIndex(0);
+	std::mutex OutputMutex;
+	std::vector<std::thread> Workers;
+	for(int i = 0; i < Jobs; i++) {
+		Workers.push_back(std::thread([&]() {
+			for(size_t Index = NextIndex++; Index < Results.size(); Index = NextIndex++) {
+				_ValidateResult &Result = Results[Index];
+				RunWorker(WorkerPath, Timeout, Result);
+				CheckResult(Result);
+
+				// Print report line
+				static const char *StatusNames[] = { "error", "won", "lost", "stopped", "timeout" };
+				char Buffer[1024];
+				snprintf(Buffer, sizeof(Buffer), "%s %-8s time=%.3f expected=%.3f delta=%+.3f %s",
+					Result.Passed ? "PASS" : "FAIL",
+					StatusNames[Result.Status],
+					Result.Time,
+					Result.FinishTime,
+					Result.Time - Result.FinishTime,
+					Result.File.c_str());
+
+				std::lock_guard<std::mutex> Lock(OutputMutex);
+				std::cout << Buffer << std::endl;
+			}
+		}));
+	}
+
+	for(auto &Worker : Workers)
+		Worker.join();
+
+	// Print summary
+	std::chrono::duration<float> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+	size_t PassCount = std::count_if(Results.begin(), Results.end(), [](const _ValidateResult &Result) { return Result.Passed; });
+	std::cout << PassCount << " passed, " << Results.size() - PassCount << " failed in " << Elapsed.count() << "s" << std::endl;
+
+	return PassCount == Results.size() ? 0 : 1;
+}
+
+// Called by a headless worker when validation of its replay finishes
+void _Validator::ReportResult(_ValidateResult::StatusType Status, float Time, float FinishTime, bool ReplayWon) {
+	char Buffer[256];
+	snprintf(Buffer, sizeof(Buffer), "%s %d %f %f %d", VALIDATE_RESULT_PREFIX, Status, Time, FinishTime, ReplayWon);
+	std::cout << Buffer << std::endl;
+
+	Framework.SetDone(true);
+}
+
+// Run one replay in a separate headless process and collect its result
+void _Validator::RunWorker(const std::string &Executable, float Timeout, _ValidateResult &Result) {
+	std::string Output;
+	bool TimedOut;
+	if(!RunProcess({ Executable, "-headless", "-physicsthreads", std::to_string(Config.PhysicsThreads), "-validate", Result.File }, Timeout, Output, TimedOut))
+		return;
+
+	// Runs that don't finish in time fail even if they reported a result
+	if(TimedOut) {
+		Result.Status = _ValidateResult::STATUS_TIMEOUT;
+		return;
+	}
+
+	size_t PrefixLength = strlen(VALIDATE_RESULT_PREFIX);
+	for(size_t Start = 0, End; Start < Output.size(); Start = End + 1) {
+		End = Output.find('\n', Start);
+		if(End == std::string::npos)
+			End = Output.size();
+
+		std::string Line = Output.substr(Start, End - Start);
+		if(Line.compare(0, PrefixLength, VALIDATE_RESULT_PREFIX) || Result.Status != _ValidateResult::STATUS_ERROR)
+			continue;
+
+		// Workers only report finished runs, anything else is an error
+		int Status, ReplayWon;
+		if(sscanf(Line.c_str() + PrefixLength, "%d %f %f %d", &Status, &Result.Time, &Result.FinishTime, &ReplayWon) == 4) {
+			if(Status < _ValidateResult::STATUS_ERROR || Status > _ValidateResult::STATUS_STOPPED)
+				Status = _ValidateResult::STATUS_ERROR;
+			Result.Status = (_ValidateResult::StatusType)Status;
+			Result.ReplayWon = ReplayWon;
+		}
+	}
+}
+
+// Determine if the validated run matches the recorded one
+void _Validator::CheckResult(_ValidateResult &Result) {
+	if(Result.Status == _ValidateResult::STATUS_ERROR || Result.Status == _ValidateResult::STATUS_TIMEOUT)
+		return;
+
+	// Every run must end at the recorded finish time
+	if(std::abs(Result.Time - Result.FinishTime) > VALIDATE_TIME_TOLERANCE)
+		return;
+
+	// Winning replays must win again, others must lose or run out of inputs without winning
+	if(Result.ReplayWon)
+		Result.Passed = Result.Status == _ValidateResult::STATUS_WON;
+	else
+		Result.Passed = Result.Status == _ValidateResult::STATUS_LOST || Result.Status == _ValidateResult::STATUS_STOPPED;
+}
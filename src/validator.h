@@ -0,0 +1,64 @@
+/******************************************************************************
+* irrlamb - https://github.com/jazztickets/irrlamb
+* Copyright (C) 2019  Alan Witkowski
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+#pragma once
+
+// Libraries
+#include <string>
+
+// Constants
+
+// Seconds a batch worker can run before it is killed
+const float VALIDATE_TIMEOUT = 300.0f;
+
+// Result of a single replay validation
+struct _ValidateResult {
+	_ValidateResult() : Status(STATUS_ERROR), Time(0.0f), FinishTime(0.0f), ReplayWon(false), Passed(false) { }
+
+	enum StatusType {
+		STATUS_ERROR,
+		STATUS_WON,
+		STATUS_LOST,
+		STATUS_STOPPED,
+		STATUS_TIMEOUT,
+	};
+
+	std::string File;
+	StatusType Status;
+	float Time;
+	float FinishTime;
+	bool ReplayWon;
+	bool Passed;
+};
+
+// Validates replays headlessly in a pool of worker processes
+class _Validator {
+
+	public:
+
+		int RunBatch(const std::string &Executable, const std::string &Path, int Jobs, float Timeout);
+		void ReportResult(_ValidateResult::StatusType Status, float Time, float FinishTime, bool ReplayWon);
+
+	private:
+
+		void RunWorker(const std::string &Executable, float Timeout, _ValidateResult &Result);
+		void CheckResult(_ValidateResult &Result);
+
+};
+
+// Singletons
+extern _Validator Validator;
@@ -0,0 +1,40 @@
+/*************************************************************************************
+*	irrlamb - https://github.com/jazztickets/irrlamb
+*	Copyright (C) 2019  Alan Witkowski
+*
+*	This program is free software: you can redistribute it and/or modify
+*	it under the terms of the GNU General Public License as published by
+*	the Free Software Foundation, either version 3 of the License, or
+*	(at your option) any later version.
+*
+*	This program is distributed in the hope that it will be useful,
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*	GNU General Public License for more details.
+*
+*	You should have received a copy of the GNU General Public License
+*	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************************/
+#include <framework.h>
+#include <vector>
+
+// Runs the headless level benchmark suite, extra arguments are passed to the engine
+int main(int ArgumentCount, char **Arguments) {
+
+	// Put the benchmark first so it can be overridden
+	std::vector<char *> EngineArguments;
+	EngineArguments.push_back(Arguments[0]);
+	EngineArguments.push_back((char *)"-benchmark");
+	EngineArguments.push_back((char *)"levels");
+	for(int i = 1; i < ArgumentCount; i++)
+		EngineArguments.push_back(Arguments[i]);
+
+	// Initialize the engine and run the benchmark
+	if(!Framework.Init((int)EngineArguments.size(), EngineArguments.data()))
+		return Framework.GetExitCode();
+
+	// Shut down the system
+	Framework.Close();
+
+	return Framework.GetExitCode();
+}
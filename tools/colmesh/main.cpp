@@ -15,12 +15,18 @@
 *	You should have received a copy of the GNU General Public License
 *	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************************/
+#include <colmesh.h>
+#include <Opcode.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <array>
 #include <map>
+#include <cstring>
+#include <tuple>
+
+static_assert(sizeof(Opcode::AABBNoLeafNodeData) == COLMESH_NODE_SIZE, "Unexpected OPCODE node size");
 
 // Face struct
 struct _Face {
@@ -47,19 +53,25 @@ static std::vector<_Face> Faces;
 
 // Functions
 static bool ReadObjFile(const char *Filename);
+static bool ReadColFile(const char *Filename, bool &Precooked);
 static bool WriteColFile(const char *Filename);
 
 int main(int ArgumentCount, char **Arguments) {
 
 	// Parse arguments
 	if(ArgumentCount != 2) {
-		std::cout << "Needs 1 argument: .obj file" << std::endl;
+		std::cout << "Needs 1 argument: .obj or .col file" << std::endl;
 		return EXIT_FAILURE;
 	}
 
 	// Parse file
 	std::string File = Arguments[1];
 	size_t Extension = File.rfind(".obj");
+	bool Convert = false;
+	if(Extension == std::string::npos) {
+		Extension = File.rfind(".col");
+		Convert = true;
+	}
 	if(Extension == std::string::npos) {
 		std::cout << "Bad argument: " << Arguments[1] << std::endl;
 		return EXIT_FAILURE;
@@ -71,7 +83,17 @@ int main(int ArgumentCount, char **Arguments) {
 	std::string ColFilename = BaseName + std::string(".col");
 
 	// Read file
-	if(!ReadObjFile(ObjFilename.c_str())) {
+	if(Convert) {
+		bool Precooked;
+		if(!ReadColFile(ColFilename.c_str(), Precooked))
+			return EXIT_FAILURE;
+
+		if(Precooked) {
+			std::cout << ColFilename << " is already precooked" << std::endl;
+			return EXIT_SUCCESS;
+		}
+	}
+	else if(!ReadObjFile(ObjFilename.c_str())) {
 		return EXIT_FAILURE;
 	}
 
@@ -152,38 +174,125 @@ bool ReadObjFile(const char *Filename) {
 	return true;
 }
 
-// Write vertices/faces to a binary file
-bool WriteColFile(const char *Filename) {
+// Read an unprocessed .col file from older versions
+bool ReadColFile(const char *Filename, bool &Precooked) {
 
 	// Open file
-	std::ofstream File;
-	File.open(Filename, std::ios::out | std::ios::binary);
-	if(!File.is_open()) {
-		std::cout << "Error opening '" << Filename << "' for writing" << std::endl;
+	std::ifstream InputFile(Filename, std::ios::binary);
+	if(!InputFile.is_open()) {
+		std::cout << "Error opening '" << Filename << "' for reading" << std::endl;
 
 		return false;
 	}
 
-	// Write header
+	// Check for new format
+	char Magic[sizeof(COLMESH_MAGIC)];
+	InputFile.read(Magic, sizeof(Magic));
+	Precooked = InputFile && !memcmp(Magic, COLMESH_MAGIC, sizeof(COLMESH_MAGIC));
+	if(Precooked)
+		return true;
+
+	// Read header
+	int VertCount = 0, FaceCount = 0;
+	InputFile.seekg(0);
+	InputFile.read((char *)&VertCount, sizeof(int));
+	InputFile.read((char *)&FaceCount, sizeof(int));
+
+	// Read lists
+	Vertices.resize(VertCount);
+	Faces.resize(FaceCount);
+	InputFile.read((char *)Vertices.data(), VertCount * sizeof(_Vertex));
+	InputFile.read((char *)Faces.data(), FaceCount * sizeof(_Face));
+	if(!InputFile) {
+		std::cout << "Error reading '" << Filename << "'" << std::endl;
+
+		return false;
+	}
+
+	return true;
+}
+
+// Get the next aligned offset
+static uint32_t Align(uint32_t Offset) {
+	return (Offset + COLMESH_ALIGNMENT - 1) / COLMESH_ALIGNMENT * COLMESH_ALIGNMENT;
+}
+
+// Write a section at an aligned offset
+static void WriteSection(std::ofstream &File, uint32_t Offset, const void *Data, size_t Size) {
+	File.seekp(Offset);
+	File.write((const char *)Data, Size);
+}
+
+// Write vertices/faces in engine order with a prebuilt collision tree
+bool WriteColFile(const char *Filename) {
+
+	// Flip z axis and winding order for the engine
 	int VertCount = Vertices.size();
 	int FaceCount = Faces.size();
-	File.write((char *)&VertCount, sizeof(int));
-	File.write((char *)&FaceCount, sizeof(int));
-
-	// Write vertices
+	std::vector<float> VertexList(VertCount * 3);
+	std::vector<udword> FaceList(FaceCount * 3);
 	for(int i = 0; i < VertCount; i++) {
-		File.write((char *)&Vertices[i].Data[0], sizeof(float));
-		File.write((char *)&Vertices[i].Data[1], sizeof(float));
-		File.write((char *)&Vertices[i].Data[2], sizeof(float));
+		VertexList[i * 3 + 0] = Vertices[i][0];
+		VertexList[i * 3 + 1] = Vertices[i][1];
+		VertexList[i * 3 + 2] = -Vertices[i][2];
 	}
-
-	// Write faces
 	for(int i = 0; i < FaceCount; i++) {
-		File.write((char *)&Faces[i].Data[0], sizeof(int));
-		File.write((char *)&Faces[i].Data[1], sizeof(int));
-		File.write((char *)&Faces[i].Data[2], sizeof(int));
+		FaceList[i * 3 + 0] = Faces[i][2];
+		FaceList[i * 3 + 1] = Faces[i][1];
+		FaceList[i * 3 + 2] = Faces[i][0];
+	}
+
+	// Build the tree the same way ODE does
+	Opcode::MeshInterface Mesh;
+	Mesh.SetNbTriangles(FaceCount);
+	Mesh.SetNbVertices(VertCount);
+	Mesh.SetPointers((const IndexedTriangle *)FaceList.data(), (const Point *)VertexList.data());
+	Mesh.SetStrides(3 * sizeof(udword), 3 * sizeof(float));
+	Mesh.SetSingle(true);
+
+	Opcode::BuildSettings Settings(Opcode::SPLIT_BEST_AXIS | Opcode::SPLIT_SPLATTER_POINTS | Opcode::SPLIT_GEOM_CENTER);
+	Opcode::OPCODECREATE TreeBuilder(&Mesh, Settings, true, false);
+	Opcode::Model Model;
+	if(!Model.Build(TreeBuilder)) {
+		std::cout << "Error building collision tree" << std::endl;
+
+		return false;
+	}
+
+	// Get tree nodes, single triangle meshes don't have a tree
+	std::vector<Opcode::AABBNoLeafNodeData> Nodes;
+	if(Model.GetTree()) {
+		const Opcode::AABBNoLeafTree *Tree = (const Opcode::AABBNoLeafTree *)Model.GetTree();
+		Nodes.resize(Tree->GetNbNodes());
+		Tree->Export(Nodes.data());
 	}
 
+	// Build header
+	_ColMeshHeader Header;
+	memcpy(Header.Magic, COLMESH_MAGIC, sizeof(Header.Magic));
+	Header.Version = COLMESH_VERSION;
+	Header.VertexCount = VertCount;
+	Header.FaceCount = FaceCount;
+	Header.NodeCount = Nodes.size();
+	Header.VertexOffset = Align(sizeof(Header));
+	Header.FaceOffset = Align(Header.VertexOffset + VertexList.size() * sizeof(float));
+	Header.NodeOffset = Nodes.size() ? Align(Header.FaceOffset + FaceList.size() * sizeof(udword)) : 0;
+
+	// Open file
+	std::ofstream File;
+	File.open(Filename, std::ios::out | std::ios::binary);
+	if(!File.is_open()) {
+		std::cout << "Error opening '" << Filename << "' for writing" << std::endl;
+
+		return false;
+	}
+
+	// Write sections
+	File.write((char *)&Header, sizeof(Header));
+	WriteSection(File, Header.VertexOffset, VertexList.data(), VertexList.size() * sizeof(float));
+	WriteSection(File, Header.FaceOffset, FaceList.data(), FaceList.size() * sizeof(udword));
+	WriteSection(File, Header.NodeOffset, Nodes.data(), Nodes.size() * sizeof(Opcode::AABBNoLeafNodeData));
+
 	// Close file
 	File.close();
 
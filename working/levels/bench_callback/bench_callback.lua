@@ -0,0 +1,20 @@
+-- Set up templates
+tPaddle = Level.GetTemplate("paddle")
+tBall = Level.GetTemplate("ball")
+
+-- Spin a paddle through a field of balls
+oPaddle = Level.CreateObject("paddle", tPaddle, 0, 0.5, 0)
+Object.SetAngularVelocity(oPaddle, 0, 1, 0)
+
+Size = 20
+for i = 0, Size - 1 do
+	for j = 0, Size - 1 do
+		Level.CreateObject("ball", tBall, (i - Size / 2) * 1.2 + 0.6, 0.5, (j - Size / 2) * 1.2 + 0.6)
+	end
+end
+
+-- Count collisions
+Hits = 0
+function OnHitBall(Object, OtherObject)
+	Hits = Hits + 1
+end
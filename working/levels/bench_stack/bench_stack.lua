@@ -0,0 +1,13 @@
+-- Set up templates
+tBox = Level.GetTemplate("box")
+
+-- Build a grid of box towers
+Size = 8
+Height = 10
+for i = 0, Size - 1 do
+	for j = 0, Size - 1 do
+		for k = 0, Height - 1 do
+			Level.CreateObject("box", tBox, (i - Size / 2) * 2, k + 0.5, j * 2)
+		end
+	end
+end